@@ -123,7 +123,7 @@ usage (void)
            "  -x, --execute; -e, --command=%s; -T, --title=%s;\n"
            "  --dynamic-title-mode=%s ('replace', 'before', 'after', 'none');\n"
            "  --initial-title=%s; --working-directory=%s; -H, --hold;\n"
-           "  --active-tab; --color-text=%s; --color-bg=%s\n\n",
+           "  --active-tab; --color-text=%s; --color-bg=%s; --log=%s\n\n",
            _("Tab Options"),
            /* parameter of --command */
            _("command"),
@@ -138,7 +138,9 @@ usage (void)
            /* parameter of --color-text */
            _("color"),
            /* parameter of --color-bg */
-           _("color"));
+           _("color"),
+           /* parameter of --log */
+           _("file"));
 
   g_print ("%s:\n"
            "  --display=%s; --geometry=%s; --role=%s; --drop-down;\n"
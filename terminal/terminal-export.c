@@ -0,0 +1,706 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The encoder turns the html vte produces for a range of rows into one of
+ * two compact formats, with one set of attributes per run of text:
+ *
+ * ANSI: the text with an SGR escape sequence where the attributes change
+ * and CRLF line ends, so it shows as it was with cat or less -R. The
+ * attributes are reset before each line end, so a background color does
+ * not fill the rest of the line where it is shown.
+ *
+ * Cell runs: the magic CELL_RUNS_MAGIC, followed by runs of a header of
+ * RUN_HEADER_SIZE bytes, attribute flags, foreground rgb, background rgb
+ * and the text length as 32 bit little endian, and the utf-8 text.
+ *
+ * The replayer turns either format, or plain text, into what
+ * vte_terminal_feed() expects.
+ *
+ * VTE has no other way to get the attributes of a range of rows since
+ * 0.72, and its html is not a stable format: the encoder depends on the
+ * <br> line breaks, the <b>, <i>, <u>, <blink> and <strike> or <s> tags,
+ * <font color="#rrggbb"> and style="background-color:#rrggbb". Any tag it
+ * does not know keeps the attributes. tests/export-test.c checks this
+ * against the html of the vte it is built with.
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "terminal-export.h"
+
+#define CELL_RUNS_MAGIC "XFTRUNS1"
+#define CELL_RUNS_MAGIC_SIZE 8
+#define RUN_HEADER_SIZE 11
+
+/* text bytes after which a cell run is written, even if it continues */
+#define MAX_RUN_LENGTH (64 * 1024)
+
+/* longest html tag or entity that is parsed */
+#define MAX_TOKEN_LENGTH 256
+
+
+
+typedef enum
+{
+  ATTR_BOLD = 1 << 0,
+  ATTR_ITALIC = 1 << 1,
+  ATTR_UNDERLINE = 1 << 2,
+  ATTR_BLINK = 1 << 3,
+  ATTR_STRIKETHROUGH = 1 << 4,
+  ATTR_FOREGROUND = 1 << 5,
+  ATTR_BACKGROUND = 1 << 6,
+} ExportAttrFlags;
+
+typedef enum
+{
+  MODE_ENCODE_ANSI,
+  MODE_ENCODE_CELL_RUNS,
+  MODE_REPLAY,
+} ExportMode;
+
+typedef enum
+{
+  PARSE_TEXT,
+  PARSE_TAG,
+  PARSE_ENTITY,
+} ExportParseState;
+
+typedef enum
+{
+  REPLAY_DETECT,
+  REPLAY_TEXT,
+  REPLAY_RUN_HEADER,
+  REPLAY_RUN_TEXT,
+} ExportReplayState;
+
+typedef struct
+{
+  guint8 flags;
+  guint8 foreground[3];
+  guint8 background[3];
+} ExportAttr;
+
+
+
+static void
+terminal_export_converter_iface_init (GConverterIface *iface);
+static void
+terminal_export_converter_finalize (GObject *object);
+static GConverterResult
+terminal_export_converter_convert (GConverter *converter,
+                                   const void *inbuf,
+                                   gsize inbuf_size,
+                                   void *outbuf,
+                                   gsize outbuf_size,
+                                   GConverterFlags flags,
+                                   gsize *bytes_read,
+                                   gsize *bytes_written,
+                                   GError **error);
+static void
+terminal_export_converter_reset (GConverter *converter);
+static void
+terminal_export_converter_encode (TerminalExportConverter *export,
+                                  guchar c);
+static void
+terminal_export_converter_replay (TerminalExportConverter *export,
+                                  guchar c);
+static void
+terminal_export_converter_finish (TerminalExportConverter *export);
+
+
+
+struct _TerminalExportConverter
+{
+  GObject parent_instance;
+
+  ExportMode mode;
+  gboolean html;
+
+  /* output that did not fit in the buffer of the last call */
+  GString *pending;
+  gboolean finished;
+
+  /* html input, with the attributes of each open tag on a stack */
+  ExportParseState parse_state;
+  GString *token;
+  gboolean after_break;
+  GArray *stack;
+  ExportAttr attr;
+
+  /* attributes of the ansi output so far */
+  ExportAttr emitted;
+
+  /* cell run output */
+  gboolean magic_written;
+  GString *run;
+  ExportAttr run_attr;
+
+  /* replay input */
+  ExportReplayState replay_state;
+  guchar header[RUN_HEADER_SIZE];
+  guint header_length;
+  guint32 remaining;
+  guchar previous;
+};
+
+
+
+G_DEFINE_TYPE_WITH_CODE (TerminalExportConverter, terminal_export_converter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER, terminal_export_converter_iface_init))
+
+
+
+static void
+terminal_export_converter_class_init (TerminalExportConverterClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_export_converter_finalize;
+}
+
+
+
+static void
+terminal_export_converter_iface_init (GConverterIface *iface)
+{
+  iface->convert = terminal_export_converter_convert;
+  iface->reset = terminal_export_converter_reset;
+}
+
+
+
+static void
+terminal_export_converter_init (TerminalExportConverter *export)
+{
+  export->pending = g_string_new (NULL);
+  export->token = g_string_new (NULL);
+  export->run = g_string_new (NULL);
+  export->stack = g_array_new (FALSE, TRUE, sizeof (ExportAttr));
+}
+
+
+
+static void
+terminal_export_converter_finalize (GObject *object)
+{
+  TerminalExportConverter *export = TERMINAL_EXPORT_CONVERTER (object);
+
+  g_string_free (export->pending, TRUE);
+  g_string_free (export->token, TRUE);
+  g_string_free (export->run, TRUE);
+  g_array_free (export->stack, TRUE);
+
+  (*G_OBJECT_CLASS (terminal_export_converter_parent_class)->finalize) (object);
+}
+
+
+
+static void
+terminal_export_converter_reset (GConverter *converter)
+{
+  TerminalExportConverter *export = TERMINAL_EXPORT_CONVERTER (converter);
+
+  g_string_truncate (export->pending, 0);
+  g_string_truncate (export->token, 0);
+  g_string_truncate (export->run, 0);
+  g_array_set_size (export->stack, 0);
+
+  export->finished = FALSE;
+  export->parse_state = PARSE_TEXT;
+  export->after_break = FALSE;
+  export->magic_written = FALSE;
+  export->replay_state = REPLAY_DETECT;
+  export->header_length = 0;
+  export->remaining = 0;
+  export->previous = 0;
+
+  memset (&export->attr, 0, sizeof (ExportAttr));
+  memset (&export->emitted, 0, sizeof (ExportAttr));
+  memset (&export->run_attr, 0, sizeof (ExportAttr));
+}
+
+
+
+static GConverterResult
+terminal_export_converter_convert (GConverter *converter,
+                                   const void *inbuf,
+                                   gsize inbuf_size,
+                                   void *outbuf,
+                                   gsize outbuf_size,
+                                   GConverterFlags flags,
+                                   gsize *bytes_read,
+                                   gsize *bytes_written,
+                                   GError **error)
+{
+  TerminalExportConverter *export = TERMINAL_EXPORT_CONVERTER (converter);
+  const guchar *input = inbuf;
+  gsize n_read = 0;
+  gsize n_written;
+
+  if (G_UNLIKELY (outbuf_size == 0))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE, "No space in the output buffer");
+      return G_CONVERTER_ERROR;
+    }
+
+  /* only take as much input as fits, the internal state keeps tags,
+   * entities and headers that are split over several calls */
+  while (n_read < inbuf_size && export->pending->len < outbuf_size)
+    {
+      if (export->mode == MODE_REPLAY)
+        terminal_export_converter_replay (export, input[n_read++]);
+      else
+        terminal_export_converter_encode (export, input[n_read++]);
+    }
+
+  if (n_read == inbuf_size && (flags & G_CONVERTER_INPUT_AT_END) != 0 && !export->finished)
+    {
+      terminal_export_converter_finish (export);
+      export->finished = TRUE;
+    }
+
+  n_written = MIN (export->pending->len, outbuf_size);
+  memcpy (outbuf, export->pending->str, n_written);
+  g_string_erase (export->pending, 0, n_written);
+
+  *bytes_read = n_read;
+  *bytes_written = n_written;
+
+  if (export->pending->len > 0 || n_read < inbuf_size)
+    return G_CONVERTER_CONVERTED;
+
+  if (export->finished)
+    return G_CONVERTER_FINISHED;
+
+  if ((flags & G_CONVERTER_FLUSH) != 0)
+    return G_CONVERTER_FLUSHED;
+
+  if (n_read == 0 && n_written == 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, "Need more input");
+      return G_CONVERTER_ERROR;
+    }
+
+  return G_CONVERTER_CONVERTED;
+}
+
+
+
+static void
+terminal_export_converter_append_sgr (TerminalExportConverter *export)
+{
+  const ExportAttr *attr = &export->attr;
+
+  /* reset and set all, there are no partial resets for colors */
+  g_string_append (export->pending, "\033[0");
+  if ((attr->flags & ATTR_BOLD) != 0)
+    g_string_append (export->pending, ";1");
+  if ((attr->flags & ATTR_ITALIC) != 0)
+    g_string_append (export->pending, ";3");
+  if ((attr->flags & ATTR_UNDERLINE) != 0)
+    g_string_append (export->pending, ";4");
+  if ((attr->flags & ATTR_BLINK) != 0)
+    g_string_append (export->pending, ";5");
+  if ((attr->flags & ATTR_STRIKETHROUGH) != 0)
+    g_string_append (export->pending, ";9");
+  if ((attr->flags & ATTR_FOREGROUND) != 0)
+    g_string_append_printf (export->pending, ";38;2;%u;%u;%u",
+                            attr->foreground[0], attr->foreground[1], attr->foreground[2]);
+  if ((attr->flags & ATTR_BACKGROUND) != 0)
+    g_string_append_printf (export->pending, ";48;2;%u;%u;%u",
+                            attr->background[0], attr->background[1], attr->background[2]);
+  g_string_append_c (export->pending, 'm');
+
+  export->emitted = export->attr;
+}
+
+
+
+static void
+terminal_export_converter_append_ansi (TerminalExportConverter *export,
+                                       guchar c)
+{
+  if (c == '\r' || c == '\n')
+    {
+      /* the terminal erases the rest of the line with the current
+       * background, so the attributes are set again after it */
+      if (export->emitted.flags != 0)
+        {
+          g_string_append (export->pending, "\033[0m");
+          memset (&export->emitted, 0, sizeof (ExportAttr));
+        }
+    }
+  else if (memcmp (&export->attr, &export->emitted, sizeof (ExportAttr)) != 0)
+    terminal_export_converter_append_sgr (export);
+
+  /* a line feed alone only moves down in a terminal */
+  if (c == '\n' && export->previous != '\r')
+    g_string_append_c (export->pending, '\r');
+  g_string_append_c (export->pending, c);
+
+  export->previous = c;
+}
+
+
+
+static void
+terminal_export_converter_flush_run (TerminalExportConverter *export)
+{
+  guchar header[RUN_HEADER_SIZE];
+  guint32 length = export->run->len;
+
+  if (!export->magic_written)
+    {
+      g_string_append_len (export->pending, CELL_RUNS_MAGIC, CELL_RUNS_MAGIC_SIZE);
+      export->magic_written = TRUE;
+    }
+
+  if (length == 0)
+    return;
+
+  header[0] = export->run_attr.flags;
+  memcpy (header + 1, export->run_attr.foreground, 3);
+  memcpy (header + 4, export->run_attr.background, 3);
+  header[7] = length & 0xff;
+  header[8] = (length >> 8) & 0xff;
+  header[9] = (length >> 16) & 0xff;
+  header[10] = (length >> 24) & 0xff;
+
+  g_string_append_len (export->pending, (const gchar *) header, RUN_HEADER_SIZE);
+  g_string_append_len (export->pending, export->run->str, length);
+  g_string_truncate (export->run, 0);
+}
+
+
+
+static void
+terminal_export_converter_append_text (TerminalExportConverter *export,
+                                       guchar c)
+{
+  if (export->mode == MODE_ENCODE_ANSI)
+    {
+      terminal_export_converter_append_ansi (export, c);
+      return;
+    }
+
+  if (memcmp (&export->attr, &export->run_attr, sizeof (ExportAttr)) != 0)
+    {
+      terminal_export_converter_flush_run (export);
+      export->run_attr = export->attr;
+    }
+
+  g_string_append_c (export->run, c);
+  if (export->run->len >= MAX_RUN_LENGTH)
+    terminal_export_converter_flush_run (export);
+}
+
+
+
+static gboolean
+terminal_export_converter_parse_color (const gchar *tag,
+                                       const gchar *prefix,
+                                       guint8 *rgb)
+{
+  const gchar *p;
+  guint n;
+
+  p = strstr (tag, prefix);
+  if (p == NULL)
+    return FALSE;
+
+  p += strlen (prefix);
+  for (n = 0; n < 6; n++)
+    if (!g_ascii_isxdigit (p[n]))
+      return FALSE;
+
+  for (n = 0; n < 3; n++)
+    rgb[n] = g_ascii_xdigit_value (p[n * 2]) << 4 | g_ascii_xdigit_value (p[n * 2 + 1]);
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_export_converter_handle_tag (TerminalExportConverter *export,
+                                      const gchar *tag)
+{
+  gsize length;
+
+  length = strcspn (tag, " \t/>");
+
+  /* a closing tag restores the attributes before its opening tag */
+  if (tag[0] == '/')
+    {
+      if (strncmp (tag + 1, "pre", 3) != 0 && export->stack->len > 0)
+        {
+          export->attr = g_array_index (export->stack, ExportAttr, export->stack->len - 1);
+          g_array_set_size (export->stack, export->stack->len - 1);
+        }
+      return;
+    }
+
+  if (length == 2 && strncmp (tag, "br", 2) == 0)
+    {
+      terminal_export_converter_append_text (export, '\n');
+      export->after_break = TRUE;
+      return;
+    }
+
+  if (length == 3 && strncmp (tag, "pre", 3) == 0)
+    return;
+
+  g_array_append_val (export->stack, export->attr);
+
+  if (length == 1 && tag[0] == 'b')
+    export->attr.flags |= ATTR_BOLD;
+  else if (length == 1 && tag[0] == 'i')
+    export->attr.flags |= ATTR_ITALIC;
+  else if (length == 1 && tag[0] == 'u')
+    export->attr.flags |= ATTR_UNDERLINE;
+  else if (length == 5 && strncmp (tag, "blink", 5) == 0)
+    export->attr.flags |= ATTR_BLINK;
+  else if ((length == 6 && strncmp (tag, "strike", 6) == 0)
+           || (length == 1 && tag[0] == 's'))
+    export->attr.flags |= ATTR_STRIKETHROUGH;
+  else if (terminal_export_converter_parse_color (tag, "background-color:#", export->attr.background))
+    export->attr.flags |= ATTR_BACKGROUND;
+  else if (terminal_export_converter_parse_color (tag, "color=\"#", export->attr.foreground))
+    export->attr.flags |= ATTR_FOREGROUND;
+}
+
+
+
+static void
+terminal_export_converter_handle_entity (TerminalExportConverter *export,
+                                         const gchar *entity)
+{
+  gchar utf8[6];
+  gunichar c = 0;
+  gint length;
+  gint n;
+
+  if (strcmp (entity, "lt") == 0)
+    c = '<';
+  else if (strcmp (entity, "gt") == 0)
+    c = '>';
+  else if (strcmp (entity, "amp") == 0)
+    c = '&';
+  else if (strcmp (entity, "quot") == 0)
+    c = '"';
+  else if (strcmp (entity, "apos") == 0)
+    c = '\'';
+  else if (entity[0] == '#' && (entity[1] == 'x' || entity[1] == 'X'))
+    c = g_ascii_strtoull (entity + 2, NULL, 16);
+  else if (entity[0] == '#')
+    c = g_ascii_strtoull (entity + 1, NULL, 10);
+
+  if (c == 0 || !g_unichar_validate (c))
+    return;
+
+  length = g_unichar_to_utf8 (c, utf8);
+  for (n = 0; n < length; n++)
+    terminal_export_converter_append_text (export, utf8[n]);
+}
+
+
+
+static void
+terminal_export_converter_encode (TerminalExportConverter *export,
+                                  guchar c)
+{
+  gboolean after_break = export->after_break;
+
+  export->after_break = FALSE;
+
+  if (!export->html)
+    {
+      terminal_export_converter_append_text (export, c);
+      return;
+    }
+
+  switch (export->parse_state)
+    {
+    case PARSE_TEXT:
+      if (c == '<')
+        {
+          g_string_truncate (export->token, 0);
+          export->parse_state = PARSE_TAG;
+        }
+      else if (c == '&')
+        {
+          g_string_truncate (export->token, 0);
+          export->parse_state = PARSE_ENTITY;
+        }
+      else if (c != '\n' || !after_break)
+        {
+          /* vte writes line breaks as <br>, maybe followed by a newline */
+          terminal_export_converter_append_text (export, c);
+        }
+      break;
+
+    case PARSE_TAG:
+      if (c == '>')
+        {
+          terminal_export_converter_handle_tag (export, export->token->str);
+          export->parse_state = PARSE_TEXT;
+        }
+      else if (export->token->len < MAX_TOKEN_LENGTH)
+        g_string_append_c (export->token, c);
+      break;
+
+    case PARSE_ENTITY:
+      if (c == ';')
+        {
+          terminal_export_converter_handle_entity (export, export->token->str);
+          export->parse_state = PARSE_TEXT;
+        }
+      else if (export->token->len < MAX_TOKEN_LENGTH)
+        g_string_append_c (export->token, c);
+      break;
+    }
+}
+
+
+
+static void
+terminal_export_converter_replay (TerminalExportConverter *export,
+                                  guchar c)
+{
+  guint n;
+
+  switch (export->replay_state)
+    {
+    case REPLAY_DETECT:
+      /* look for the magic of cell runs, anything else is text */
+      export->header[export->header_length++] = c;
+      if (c != (guchar) CELL_RUNS_MAGIC[export->header_length - 1])
+        {
+          export->replay_state = REPLAY_TEXT;
+          for (n = 0; n < export->header_length; n++)
+            terminal_export_converter_append_ansi (export, export->header[n]);
+        }
+      else if (export->header_length == CELL_RUNS_MAGIC_SIZE)
+        {
+          export->replay_state = REPLAY_RUN_HEADER;
+          export->header_length = 0;
+        }
+      break;
+
+    case REPLAY_TEXT:
+      terminal_export_converter_append_ansi (export, c);
+      break;
+
+    case REPLAY_RUN_HEADER:
+      export->header[export->header_length++] = c;
+      if (export->header_length == RUN_HEADER_SIZE)
+        {
+          export->attr.flags = export->header[0];
+          memcpy (export->attr.foreground, export->header + 1, 3);
+          memcpy (export->attr.background, export->header + 4, 3);
+          export->remaining = export->header[7]
+                              | (guint32) export->header[8] << 8
+                              | (guint32) export->header[9] << 16
+                              | (guint32) export->header[10] << 24;
+          export->header_length = 0;
+
+          if (export->remaining > 0)
+            export->replay_state = REPLAY_RUN_TEXT;
+        }
+      break;
+
+    case REPLAY_RUN_TEXT:
+      terminal_export_converter_append_ansi (export, c);
+      if (--export->remaining == 0)
+        export->replay_state = REPLAY_RUN_HEADER;
+      break;
+    }
+}
+
+
+
+static void
+terminal_export_converter_finish (TerminalExportConverter *export)
+{
+  guint n;
+
+  if (export->mode == MODE_ENCODE_CELL_RUNS)
+    {
+      terminal_export_converter_flush_run (export);
+      return;
+    }
+
+  /* a file shorter than the magic */
+  if (export->mode == MODE_REPLAY && export->replay_state == REPLAY_DETECT)
+    for (n = 0; n < export->header_length; n++)
+      terminal_export_converter_append_ansi (export, export->header[n]);
+
+  /* leave the terminal with the default attributes */
+  if (export->emitted.flags != 0)
+    {
+      memset (&export->attr, 0, sizeof (ExportAttr));
+      terminal_export_converter_append_sgr (export);
+    }
+}
+
+
+
+/**
+ * terminal_export_encoder_new:
+ * @format : The format to write, either %TERMINAL_EXPORT_FORMAT_ANSI or
+ *           %TERMINAL_EXPORT_FORMAT_CELL_RUNS.
+ * @html   : Whether the input is html from vte or plain text.
+ *
+ * Return value: A #GConverter that writes terminal contents in @format.
+ **/
+GConverter *
+terminal_export_encoder_new (TerminalExportFormat format,
+                             gboolean html)
+{
+  TerminalExportConverter *export;
+
+  g_return_val_if_fail (format == TERMINAL_EXPORT_FORMAT_ANSI || format == TERMINAL_EXPORT_FORMAT_CELL_RUNS, NULL);
+
+  export = g_object_new (TERMINAL_TYPE_EXPORT_CONVERTER, NULL);
+  export->mode = (format == TERMINAL_EXPORT_FORMAT_ANSI) ? MODE_ENCODE_ANSI : MODE_ENCODE_CELL_RUNS;
+  export->html = html;
+
+  return G_CONVERTER (export);
+}
+
+
+
+/**
+ * terminal_export_replayer_new:
+ *
+ * Return value: A #GConverter that turns saved terminal contents in any
+ *               format into input for vte_terminal_feed().
+ **/
+GConverter *
+terminal_export_replayer_new (void)
+{
+  TerminalExportConverter *export;
+
+  export = g_object_new (TERMINAL_TYPE_EXPORT_CONVERTER, NULL);
+  export->mode = MODE_REPLAY;
+
+  return G_CONVERTER (export);
+}
@@ -0,0 +1,44 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_EXPORT_H
+#define TERMINAL_EXPORT_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_EXPORT_CONVERTER (terminal_export_converter_get_type ())
+G_DECLARE_FINAL_TYPE (TerminalExportConverter, terminal_export_converter, TERMINAL, EXPORT_CONVERTER, GObject)
+
+typedef enum
+{
+  TERMINAL_EXPORT_FORMAT_TEXT,
+  TERMINAL_EXPORT_FORMAT_ANSI,
+  TERMINAL_EXPORT_FORMAT_CELL_RUNS,
+} TerminalExportFormat;
+
+GConverter *
+terminal_export_encoder_new (TerminalExportFormat format,
+                             gboolean html);
+
+GConverter *
+terminal_export_replayer_new (void);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_EXPORT_H */
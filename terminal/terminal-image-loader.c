@@ -18,43 +18,119 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib/gstdio.h>
+
 #include "terminal-image-loader.h"
+#include "terminal-image-resampler.h"
 #include "terminal-private.h"
 
 /* max image resolution is 8K */
 #define MAX_IMAGE_WIDTH 7680
 #define MAX_IMAGE_HEIGHT 4320
-#define CACHE_SIZE 10
+
+/* time without new sizes before the interim image is re-rendered */
+#define RESIZE_TIMEOUT 250
+
+/* decoded images are kept in this directory below $XDG_CACHE_HOME */
+#define CACHE_DIRECTORY "xfce4-terminal/"
+#define CACHE_MAGIC "XFTIMG02"
+
+
+
+/* Signal identifiers */
+enum
+{
+  CHANGED,
+  LAST_SIGNAL,
+};
+
+
+
+typedef struct _TerminalImageCacheEntry TerminalImageCacheEntry;
+typedef struct _TerminalImageCacheHeader TerminalImageCacheHeader;
+typedef struct _TerminalImageDecodeData TerminalImageDecodeData;
+typedef struct _TerminalImageRenderData TerminalImageRenderData;
 
 
 
 static void
 terminal_image_loader_finalize (GObject *object);
 static void
+terminal_image_loader_invalidate (TerminalImageLoader *loader);
+static void
+terminal_image_loader_cache_size_changed (TerminalImageLoader *loader);
+static void
 terminal_image_loader_check (TerminalImageLoader *loader);
 static void
-terminal_image_loader_tile (TerminalImageLoader *loader,
-                            GdkPixbuf *target,
-                            gint width,
-                            gint height);
+terminal_image_loader_cache_insert (TerminalImageLoader *loader,
+                                    TerminalImageCacheEntry *entry);
 static void
-terminal_image_loader_center (TerminalImageLoader *loader,
-                              GdkPixbuf *target,
+terminal_image_loader_cache_remove (TerminalImageLoader *loader,
+                                    TerminalImageCacheEntry *entry);
+static void
+terminal_image_loader_cache_trim (TerminalImageLoader *loader);
+static void
+terminal_image_loader_cache_clear (TerminalImageLoader *loader);
+static void
+terminal_image_loader_render (TerminalImageLoader *loader,
                               gint width,
-                              gint height);
+                              gint height,
+                              gint scale_factor);
+static gboolean
+terminal_image_loader_render_timeout (gpointer user_data);
+static cairo_surface_t *
+terminal_image_loader_file_read (const gchar *filename,
+                                 const TerminalImageCacheHeader *expected);
+static void
+terminal_image_loader_file_write (const gchar *filename,
+                                  const TerminalImageCacheHeader *header,
+                                  cairo_surface_t *surface,
+                                  GCancellable *cancellable);
+static cairo_surface_t *
+terminal_image_loader_surface_new (GdkPixbuf *pixbuf);
+static void
+terminal_image_loader_decode_thread (GTask *task,
+                                     gpointer source_object,
+                                     gpointer task_data,
+                                     GCancellable *cancellable);
 static void
-terminal_image_loader_scale (TerminalImageLoader *loader,
-                             GdkPixbuf *target,
+terminal_image_loader_decode_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data);
+static void
+terminal_image_loader_render_thread (GTask *task,
+                                     gpointer source_object,
+                                     gpointer task_data,
+                                     GCancellable *cancellable);
+static void
+terminal_image_loader_render_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data);
+static void
+terminal_image_loader_draw_pattern (TerminalImageLoader *loader,
+                                    cairo_t *cr,
+                                    gint width,
+                                    gint height);
+static void
+terminal_image_loader_scale (cairo_surface_t *source,
+                             cairo_surface_t *target,
+                             const GdkRGBA *bgcolor,
                              gint width,
                              gint height);
 static void
-terminal_image_loader_stretch (TerminalImageLoader *loader,
-                               GdkPixbuf *target,
+terminal_image_loader_stretch (cairo_surface_t *source,
+                               cairo_surface_t *target,
+                               const GdkRGBA *bgcolor,
                                gint width,
                                gint height);
 static void
-terminal_image_loader_fill (TerminalImageLoader *loader,
-                            GdkPixbuf *target,
+terminal_image_loader_fill (cairo_surface_t *source,
+                            cairo_surface_t *target,
+                            const GdkRGBA *bgcolor,
                             gint width,
                             gint height);
 
@@ -64,20 +140,171 @@ struct _TerminalImageLoader
   GObject parent_instance;
   TerminalPreferences *preferences;
 
-  /* the cached image data */
+  /* the cached image data, rendered images are looked up by size in
+   * the table and kept in the queue with the most recently used first */
   gchar *path;
-  GSList *cache;
+  GHashTable *cache;
+  GQueue lru;
+  gsize cache_bytes;
+  gsize cache_limit;
   GdkRGBA bgcolor;
-  GdkPixbuf *pixbuf;
+  TerminalBackgroundStyle style;
+
+  /* the decoded image, RGB24 for opaque images and ARGB32 otherwise;
+   * tiled and centered images are painted from it directly */
+  cairo_surface_t *image;
+  gboolean image_downscaled;
+  gint image_max_width;
+  gint image_max_height;
+
+  /* bumped on relevant preference changes, compared on each load */
+  guint generation;
+  guint checked_generation;
+
+  /* cancelled when the decoded image or the rendered images become stale */
+  GCancellable *cancellable;
+
+  /* the last size drawn from an interim image, rendered once resizing stopped */
+  guint render_timeout_id;
+  gint render_width;
+  gint render_height;
+  gint render_scale_factor;
+};
+
+struct _TerminalImageCacheEntry
+{
+  gint width;
+  gint height;
+  gint scale_factor;
+  TerminalBackgroundStyle style;
+
+  /* link in the lru queue */
+  GList link;
+
+  /* rendered image, %NULL while the entry is being rendered */
+  cairo_surface_t *surface;
+};
+
+/* layout of the files in the cache directory, followed by the
+ * pixel data as found in a cairo image surface */
+struct _TerminalImageCacheHeader
+{
+  gchar magic[8];
+
+  /* the source file */
+  guint64 mtime;
+  guint64 size;
+
+  /* the largest monitor if the image was downscaled to it, 0 otherwise */
+  guint32 max_width;
+  guint32 max_height;
+
+  /* the background style the image was decoded for */
+  guint32 style;
+
+  /* the pixel data */
+  guint32 format;
+  guint32 width;
+  guint32 height;
+  guint32 stride;
+};
+
+struct _TerminalImageDecodeData
+{
+  gchar *path;
+  gchar *cache_path;
+  gint max_width;
+  gint max_height;
   TerminalBackgroundStyle style;
 };
 
+struct _TerminalImageRenderData
+{
+  cairo_surface_t *source;
+  GdkRGBA bgcolor;
+  TerminalBackgroundStyle style;
+  gint width;
+  gint height;
+  gint scale_factor;
+};
+
+
+
+static guint loader_signals[LAST_SIGNAL];
+static cairo_user_data_key_t mapped_file_key;
+
 
 
 G_DEFINE_TYPE (TerminalImageLoader, terminal_image_loader, G_TYPE_OBJECT)
 
 
 
+static void
+terminal_image_cache_entry_free (gpointer data)
+{
+  TerminalImageCacheEntry *entry = data;
+
+  if (entry->surface != NULL)
+    cairo_surface_destroy (entry->surface);
+  g_slice_free (TerminalImageCacheEntry, entry);
+}
+
+
+
+static guint
+terminal_image_cache_entry_hash (gconstpointer data)
+{
+  const TerminalImageCacheEntry *entry = data;
+  guint hash;
+
+  hash = entry->width;
+  hash = hash * 31 + entry->height;
+  hash = hash * 31 + entry->scale_factor;
+  hash = hash * 31 + entry->style;
+
+  return hash;
+}
+
+
+
+static gboolean
+terminal_image_cache_entry_equal (gconstpointer a,
+                                  gconstpointer b)
+{
+  const TerminalImageCacheEntry *entry_a = a;
+  const TerminalImageCacheEntry *entry_b = b;
+
+  return entry_a->width == entry_b->width
+         && entry_a->height == entry_b->height
+         && entry_a->scale_factor == entry_b->scale_factor
+         && entry_a->style == entry_b->style;
+}
+
+
+
+static void
+terminal_image_decode_data_free (gpointer data)
+{
+  TerminalImageDecodeData *decode = data;
+
+  g_free (decode->path);
+  g_free (decode->cache_path);
+  g_slice_free (TerminalImageDecodeData, decode);
+}
+
+
+
+static void
+terminal_image_render_data_free (gpointer data)
+{
+  TerminalImageRenderData *render = data;
+
+  cairo_surface_destroy (render->source);
+  g_slice_free (TerminalImageRenderData, render);
+}
+
+
+
 static void
 terminal_image_loader_class_init (TerminalImageLoaderClass *klass)
 {
@@ -85,6 +312,20 @@ terminal_image_loader_class_init (TerminalImageLoaderClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = terminal_image_loader_finalize;
+
+  /**
+   * TerminalImageLoader::changed:
+   * @loader : A #TerminalImageLoader.
+   *
+   * Emitted on the main thread once an image finished decoding or
+   * rendering in the background, so the screens can redraw.
+   **/
+  loader_signals[CHANGED] = g_signal_new (I_ ("changed"),
+                                          G_TYPE_FROM_CLASS (gobject_class),
+                                          G_SIGNAL_RUN_LAST,
+                                          0, NULL, NULL,
+                                          g_cclosure_marshal_VOID__VOID,
+                                          G_TYPE_NONE, 0);
 }
 
 
@@ -93,6 +334,22 @@ static void
 terminal_image_loader_init (TerminalImageLoader *loader)
 {
   loader->preferences = terminal_preferences_get ();
+  loader->cancellable = g_cancellable_new ();
+  loader->cache = g_hash_table_new (terminal_image_cache_entry_hash, terminal_image_cache_entry_equal);
+  terminal_image_loader_cache_size_changed (loader);
+
+  /* make sure the first load checks the preferences */
+  loader->generation = 1;
+
+  /* only look at the preferences again once they changed */
+  g_signal_connect_swapped (G_OBJECT (loader->preferences), "notify::background-image-file",
+                            G_CALLBACK (terminal_image_loader_invalidate), loader);
+  g_signal_connect_swapped (G_OBJECT (loader->preferences), "notify::background-image-style",
+                            G_CALLBACK (terminal_image_loader_invalidate), loader);
+  g_signal_connect_swapped (G_OBJECT (loader->preferences), "notify::color-background",
+                            G_CALLBACK (terminal_image_loader_invalidate), loader);
+  g_signal_connect_swapped (G_OBJECT (loader->preferences), "notify::misc-image-cache-size",
+                            G_CALLBACK (terminal_image_loader_cache_size_changed), loader);
 }
 
 
@@ -102,12 +359,23 @@ terminal_image_loader_finalize (GObject *object)
 {
   TerminalImageLoader *loader = TERMINAL_IMAGE_LOADER (object);
 
-  g_slist_free_full (loader->cache, g_object_unref);
+  /* pending tasks hold a reference on the loader, so there are none left */
+  g_object_unref (G_OBJECT (loader->cancellable));
+
+  if (loader->render_timeout_id != 0)
+    g_source_remove (loader->render_timeout_id);
+
+  terminal_image_loader_cache_clear (loader);
+  g_hash_table_destroy (loader->cache);
 
+  g_signal_handlers_disconnect_by_func (G_OBJECT (loader->preferences),
+                                        G_CALLBACK (terminal_image_loader_invalidate), loader);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (loader->preferences),
+                                        G_CALLBACK (terminal_image_loader_cache_size_changed), loader);
   g_object_unref (G_OBJECT (loader->preferences));
 
-  if (G_LIKELY (loader->pixbuf != NULL))
-    g_object_unref (G_OBJECT (loader->pixbuf));
+  if (G_LIKELY (loader->image != NULL))
+    cairo_surface_destroy (loader->image);
   g_free (loader->path);
 
   (*G_OBJECT_CLASS (terminal_image_loader_parent_class)->finalize) (object);
@@ -115,169 +383,662 @@ terminal_image_loader_finalize (GObject *object)
 
 
 
+static void
+terminal_image_loader_invalidate (TerminalImageLoader *loader)
+{
+  loader->generation++;
+}
+
+
+
+static void
+terminal_image_loader_cache_size_changed (TerminalImageLoader *loader)
+{
+  guint size;
+
+  g_object_get (G_OBJECT (loader->preferences), "misc-image-cache-size", &size, NULL);
+  loader->cache_limit = (gsize) size * 1024 * 1024;
+
+  terminal_image_loader_cache_trim (loader);
+}
+
+
+
 static void
 terminal_image_loader_check (TerminalImageLoader *loader)
 {
   TerminalBackgroundStyle selected_style;
-  GdkRGBA selected_color;
+  TerminalImageDecodeData *decode;
+  const TerminalColorSet *colors;
+  GdkRectangle geometry;
+  GdkDisplay *display;
+  GdkMonitor *monitor;
   gboolean invalidate = FALSE;
-  gchar *selected_color_spec;
+  gboolean downscale;
   gchar *selected_path;
+  gchar *checksum;
+  gchar *directory;
+  gchar *key;
+  gint max_width = 0;
+  gint max_height = 0;
+  gint scale_factor;
+  gint n;
+  GTask *task;
 
   g_return_if_fail (TERMINAL_IS_IMAGE_LOADER (loader));
 
   g_object_get (G_OBJECT (loader->preferences),
                 "background-image-file", &selected_path,
                 "background-image-style", &selected_style,
-                "color-background", &selected_color_spec,
                 NULL);
 
-  if (g_strcmp0 (selected_path, loader->path) != 0)
+  if (selected_style != loader->style)
+    {
+      loader->style = selected_style;
+      invalidate = TRUE;
+    }
+
+  colors = terminal_preferences_get_colors (loader->preferences);
+  if (!gdk_rgba_equal (&colors->background, &loader->bgcolor))
     {
-      gint width, height;
+      loader->bgcolor = colors->background;
+      invalidate = TRUE;
+    }
 
+  /* images that are scaled anyway are decoded no larger than needed
+   * to cover the largest monitor */
+  downscale = (loader->style != TERMINAL_BACKGROUND_STYLE_TILED
+               && loader->style != TERMINAL_BACKGROUND_STYLE_CENTERED);
+  display = gdk_display_get_default ();
+  if (downscale && display != NULL)
+    {
+      for (n = 0; n < gdk_display_get_n_monitors (display); ++n)
+        {
+          monitor = gdk_display_get_monitor (display, n);
+          gdk_monitor_get_geometry (monitor, &geometry);
+          scale_factor = gdk_monitor_get_scale_factor (monitor);
+          max_width = MAX (max_width, geometry.width * scale_factor);
+          max_height = MAX (max_height, geometry.height * scale_factor);
+        }
+    }
+
+  if (g_strcmp0 (selected_path, loader->path) != 0
+      || downscale != loader->image_downscaled
+      || max_width != loader->image_max_width
+      || max_height != loader->image_max_height)
+    {
       g_free (loader->path);
       loader->path = g_strdup (selected_path);
+      loader->image_downscaled = downscale;
+      loader->image_max_width = max_width;
+      loader->image_max_height = max_height;
+
+      /* the background color is drawn until the new image is decoded */
+      g_clear_pointer (&loader->image, cairo_surface_destroy);
+
+      invalidate = TRUE;
+    }
+
+  if (invalidate)
+    {
+      /* drop the results of workers that are still busy with the old settings */
+      g_cancellable_cancel (loader->cancellable);
+      g_object_unref (G_OBJECT (loader->cancellable));
+      loader->cancellable = g_cancellable_new ();
+
+      terminal_image_loader_cache_clear (loader);
+
+      /* the decode was cancelled as well, so restart it */
+      if (loader->image == NULL && loader->path != NULL)
+        {
+          decode = g_slice_new0 (TerminalImageDecodeData);
+          decode->path = g_strdup (loader->path);
+          decode->max_width = max_width;
+          decode->max_height = max_height;
+          decode->style = loader->style;
+
+          /* one file per image and style, replaced when the image or the
+           * monitors change */
+          directory = xfce_resource_save_location (XFCE_RESOURCE_CACHE, CACHE_DIRECTORY, TRUE);
+          if (G_LIKELY (directory != NULL))
+            {
+              key = g_strdup_printf ("%s:%d", loader->path, loader->style);
+              checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+              decode->cache_path = g_build_filename (directory, checksum, NULL);
+              g_free (checksum);
+              g_free (key);
+              g_free (directory);
+            }
+
+          task = g_task_new (loader, loader->cancellable, terminal_image_loader_decode_ready, NULL);
+          g_task_set_source_tag (task, terminal_image_loader_check);
+          g_task_set_task_data (task, decode, terminal_image_decode_data_free);
+          g_task_run_in_thread (task, terminal_image_loader_decode_thread);
+          g_object_unref (G_OBJECT (task));
+        }
+    }
+
+  g_free (selected_path);
+
+  loader->checked_generation = loader->generation;
+}
+
+
+
+static cairo_surface_t *
+terminal_image_loader_file_read (const gchar *filename,
+                                 const TerminalImageCacheHeader *expected)
+{
+  const TerminalImageCacheHeader *header;
+  cairo_surface_t *surface;
+  GMappedFile *mapped;
+  gchar *contents;
+  gsize length;
+
+  mapped = g_mapped_file_new (filename, TRUE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  contents = g_mapped_file_get_contents (mapped);
+  length = g_mapped_file_get_length (mapped);
+  header = (const TerminalImageCacheHeader *) contents;
+
+  if (length < sizeof (*header)
+      || memcmp (header->magic, CACHE_MAGIC, sizeof (header->magic)) != 0
+      || header->mtime != expected->mtime
+      || header->size != expected->size
+      || header->max_width != expected->max_width
+      || header->max_height != expected->max_height
+      || header->style != expected->style
+      || (header->format != CAIRO_FORMAT_RGB24 && header->format != CAIRO_FORMAT_ARGB32)
+      || header->width == 0 || header->width > MAX_IMAGE_WIDTH
+      || header->height == 0 || header->height > MAX_IMAGE_HEIGHT
+      || (gint) header->stride != cairo_format_stride_for_width ((cairo_format_t) header->format, header->width)
+      || length != sizeof (*header) + (gsize) header->stride * header->height)
+    {
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  /* the mapping is private, so nothing ever ends up in the file */
+  surface = cairo_image_surface_create_for_data ((guchar *) contents + sizeof (*header),
+                                                 (cairo_format_t) header->format,
+                                                 header->width, header->height,
+                                                 header->stride);
+  if (cairo_surface_set_user_data (surface, &mapped_file_key, mapped,
+                                   (cairo_destroy_func_t) g_mapped_file_unref)
+      != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (surface);
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  return surface;
+}
 
-      if (GDK_IS_PIXBUF (loader->pixbuf))
-        g_object_unref (G_OBJECT (loader->pixbuf));
 
-      if (gdk_pixbuf_get_file_info (loader->path, &width, &height) == NULL)
+
+static void
+terminal_image_loader_file_write (const gchar *filename,
+                                  const TerminalImageCacheHeader *header,
+                                  cairo_surface_t *surface,
+                                  GCancellable *cancellable)
+{
+  GFileOutputStream *stream;
+  GCancellable *discard;
+  GError *error = NULL;
+  GFile *file;
+
+  file = g_file_new_for_path (filename);
+  stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_PRIVATE, cancellable, &error);
+  if (G_LIKELY (stream != NULL))
+    {
+      cairo_surface_flush (surface);
+      if (g_output_stream_write_all (G_OUTPUT_STREAM (stream), header, sizeof (*header),
+                                     NULL, cancellable, &error)
+          && g_output_stream_write_all (G_OUTPUT_STREAM (stream), cairo_image_surface_get_data (surface),
+                                        (gsize) header->stride * header->height,
+                                        NULL, cancellable, &error))
         {
-          g_warning ("Unable to load background image file \"%s\"", loader->path);
-          loader->pixbuf = NULL;
+          g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, &error);
         }
-      else if (width <= MAX_IMAGE_WIDTH && height <= MAX_IMAGE_HEIGHT)
-        loader->pixbuf = gdk_pixbuf_new_from_file (loader->path, NULL);
       else
-        loader->pixbuf = gdk_pixbuf_new_from_file_at_size (loader->path,
-                                                           MAX_IMAGE_WIDTH, MAX_IMAGE_WIDTH,
-                                                           NULL);
+        {
+          /* a cancelled close leaves the previous file in place */
+          discard = g_cancellable_new ();
+          g_cancellable_cancel (discard);
+          g_output_stream_close (G_OUTPUT_STREAM (stream), discard, NULL);
+          g_object_unref (G_OBJECT (discard));
+        }
+      g_object_unref (G_OBJECT (stream));
+    }
 
-      invalidate = TRUE;
+  if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("Unable to write image cache \"%s\": %s", filename, error->message);
+      g_error_free (error);
     }
 
-  if (selected_style != loader->style)
+  g_object_unref (G_OBJECT (file));
+}
+
+
+
+static cairo_surface_t *
+terminal_image_loader_surface_new (GdkPixbuf *pixbuf)
+{
+  cairo_surface_t *surface;
+  const guchar *pixels;
+  const guchar *p;
+  gboolean has_alpha;
+  guint32 *q;
+  guchar *data;
+  guint r, g, b, a;
+  gint n_channels;
+  gint rowstride;
+  gint stride;
+  gint width;
+  gint height;
+  gint x;
+  gint y;
+
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+  has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+  n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  pixels = gdk_pixbuf_read_pixels (pixbuf);
+
+  /* gdk_cairo_surface_create_from_pixbuf() is not meant to be used from a thread */
+  surface = cairo_image_surface_create (has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24, width, height);
+  if (G_UNLIKELY (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS))
+    return surface;
+
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < height; ++y)
     {
-      loader->style = selected_style;
-      invalidate = TRUE;
+      p = pixels + (gsize) y * rowstride;
+      q = (guint32 *) (data + (gsize) y * stride);
+
+      for (x = 0; x < width; ++x, p += n_channels)
+        {
+          r = p[0];
+          g = p[1];
+          b = p[2];
+          a = has_alpha ? p[3] : 0xff;
+
+          /* cairo expects premultiplied alpha */
+          if (a != 0xff)
+            {
+              r = (r * a + 127) / 255;
+              g = (g * a + 127) / 255;
+              b = (b * a + 127) / 255;
+            }
+
+          q[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
     }
 
-  gdk_rgba_parse (&selected_color, selected_color_spec);
-  if (!gdk_rgba_equal (&selected_color, &loader->bgcolor))
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+
+
+static void
+terminal_image_loader_decode_thread (GTask *task,
+                                     gpointer source_object,
+                                     gpointer task_data,
+                                     GCancellable *cancellable)
+{
+  TerminalImageDecodeData *decode = task_data;
+  TerminalImageCacheHeader header;
+  cairo_surface_t *surface;
+  GdkPixbuf *pixbuf;
+  GStatBuf info;
+  GError *error = NULL;
+  gdouble factor = 1.0;
+  gint width, height;
+
+  if (g_stat (decode->path, &info) != 0)
     {
-      loader->bgcolor = selected_color;
-      invalidate = TRUE;
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Unable to load background image file \"%s\"", decode->path);
+      return;
     }
 
-  if (invalidate)
+  /* the header fields are the key of the cached file */
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+  header.mtime = info.st_mtime;
+  header.size = info.st_size;
+  header.max_width = decode->max_width;
+  header.max_height = decode->max_height;
+  header.style = decode->style;
+
+  if (decode->cache_path != NULL)
     {
-      g_clear_slist (&loader->cache, g_object_unref);
+      surface = terminal_image_loader_file_read (decode->cache_path, &header);
+      if (surface != NULL)
+        {
+          g_task_return_pointer (task, surface, (GDestroyNotify) cairo_surface_destroy);
+          return;
+        }
     }
 
-  g_free (selected_color_spec);
-  g_free (selected_path);
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (gdk_pixbuf_get_file_info (decode->path, &width, &height) == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Unable to load background image file \"%s\"", decode->path);
+      return;
+    }
+
+  if (width > MAX_IMAGE_WIDTH || height > MAX_IMAGE_HEIGHT)
+    factor = MIN ((gdouble) MAX_IMAGE_WIDTH / width, (gdouble) MAX_IMAGE_HEIGHT / height);
+  if (decode->max_width > 0 && decode->max_height > 0)
+    factor = MIN (factor, MAX ((gdouble) decode->max_width / width, (gdouble) decode->max_height / height));
+
+  /* loaders like jpeg can decode at a reduced size directly */
+  if (factor < 1.0)
+    pixbuf = gdk_pixbuf_new_from_file_at_size (decode->path,
+                                               MAX (1, (gint) (width * factor + 0.5)),
+                                               MAX (1, (gint) (height * factor + 0.5)),
+                                               &error);
+  else
+    pixbuf = gdk_pixbuf_new_from_file (decode->path, &error);
+
+  if (G_UNLIKELY (pixbuf == NULL))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  surface = terminal_image_loader_surface_new (pixbuf);
+  g_object_unref (G_OBJECT (pixbuf));
+
+  if (G_UNLIKELY (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS))
+    {
+      cairo_surface_destroy (surface);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                               "Unable to allocate background image \"%s\"", decode->path);
+      return;
+    }
+
+  /* hand out the image before it is written to the cache */
+  g_task_return_pointer (task, cairo_surface_reference (surface), (GDestroyNotify) cairo_surface_destroy);
+
+  if (decode->cache_path != NULL)
+    {
+      header.format = cairo_image_surface_get_format (surface);
+      header.width = cairo_image_surface_get_width (surface);
+      header.height = cairo_image_surface_get_height (surface);
+      header.stride = cairo_image_surface_get_stride (surface);
+      terminal_image_loader_file_write (decode->cache_path, &header, surface, cancellable);
+    }
+
+  cairo_surface_destroy (surface);
 }
 
 
 
 static void
-terminal_image_loader_tile (TerminalImageLoader *loader,
-                            GdkPixbuf *target,
-                            gint width,
-                            gint height)
+terminal_image_loader_decode_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data)
 {
-  GdkRectangle area;
-  gint source_width;
-  gint source_height;
-  gint i;
-  gint j;
-
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
-
-  for (i = 0; (i * source_width) < width; ++i)
-    for (j = 0; (j * source_height) < height; ++j)
-      {
-        area.x = i * source_width;
-        area.y = j * source_height;
-        area.width = source_width;
-        area.height = source_height;
-
-        if (area.x + area.width > width)
-          area.width = width - area.x;
-        if (area.y + area.height > height)
-          area.height = height - area.y;
-
-        gdk_pixbuf_copy_area (loader->pixbuf, 0, 0,
-                              area.width, area.height,
-                              target, area.x, area.y);
-      }
+  TerminalImageLoader *loader = TERMINAL_IMAGE_LOADER (object);
+  cairo_surface_t *image;
+  GError *error = NULL;
+
+  /* a cancelled task reports an error, even if the worker finished */
+  image = g_task_propagate_pointer (G_TASK (result), &error);
+  if (G_UNLIKELY (image == NULL))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  loader->image = image;
+
+  g_signal_emit (G_OBJECT (loader), loader_signals[CHANGED], 0);
+}
+
+
+
+static void
+terminal_image_loader_render_thread (GTask *task,
+                                     gpointer source_object,
+                                     gpointer task_data,
+                                     GCancellable *cancellable)
+{
+  TerminalImageRenderData *render = task_data;
+  cairo_surface_t *surface;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  surface = cairo_image_surface_create (cairo_image_surface_get_format (render->source),
+                                        render->width, render->height);
+  if (G_UNLIKELY (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS))
+    {
+      cairo_surface_destroy (surface);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                               "Unable to allocate a %dx%d background image",
+                               render->width, render->height);
+      return;
+    }
+
+  switch (render->style)
+    {
+    case TERMINAL_BACKGROUND_STYLE_SCALED:
+      terminal_image_loader_scale (render->source, surface, &render->bgcolor, render->width, render->height);
+      break;
+
+    case TERMINAL_BACKGROUND_STYLE_STRETCHED:
+      terminal_image_loader_stretch (render->source, surface, &render->bgcolor, render->width, render->height);
+      break;
+
+    case TERMINAL_BACKGROUND_STYLE_FILLED:
+      terminal_image_loader_fill (render->source, surface, &render->bgcolor, render->width, render->height);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_task_return_pointer (task, surface, (GDestroyNotify) cairo_surface_destroy);
+}
+
+
+
+static void
+terminal_image_loader_render_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data)
+{
+  TerminalImageLoader *loader = TERMINAL_IMAGE_LOADER (object);
+  TerminalImageRenderData *render = g_task_get_task_data (G_TASK (result));
+  TerminalImageCacheEntry *entry;
+  TerminalImageCacheEntry key;
+  cairo_surface_t *surface;
+  GError *error = NULL;
+
+  surface = g_task_propagate_pointer (G_TASK (result), &error);
+  if (G_UNLIKELY (surface == NULL))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  /* the entry may have been pushed out of the cache in the meantime */
+  key.width = render->width;
+  key.height = render->height;
+  key.scale_factor = render->scale_factor;
+  key.style = render->style;
+  entry = g_hash_table_lookup (loader->cache, &key);
+  if (entry != NULL && entry->surface == NULL)
+    {
+      entry->surface = cairo_surface_reference (surface);
+      g_signal_emit (G_OBJECT (loader), loader_signals[CHANGED], 0);
+    }
+
+  cairo_surface_destroy (surface);
+}
+
+
+
+static void
+terminal_image_loader_cache_insert (TerminalImageLoader *loader,
+                                    TerminalImageCacheEntry *entry)
+{
+  entry->link.data = entry;
+  g_queue_push_head_link (&loader->lru, &entry->link);
+  g_hash_table_add (loader->cache, entry);
+  loader->cache_bytes += (gsize) entry->width * entry->height * 4;
+
+  terminal_image_loader_cache_trim (loader);
+
+  g_debug ("Image Loader Memory Status: %u images using %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes",
+           loader->lru.length, loader->cache_bytes, loader->cache_limit);
+}
+
+
+
+static void
+terminal_image_loader_cache_remove (TerminalImageLoader *loader,
+                                    TerminalImageCacheEntry *entry)
+{
+  g_queue_unlink (&loader->lru, &entry->link);
+  g_hash_table_remove (loader->cache, entry);
+  loader->cache_bytes -= (gsize) entry->width * entry->height * 4;
+
+  terminal_image_cache_entry_free (entry);
+}
+
+
+
+static void
+terminal_image_loader_cache_trim (TerminalImageLoader *loader)
+{
+  /* always keep the most recent image, even if it exceeds the limit */
+  while (loader->cache_bytes > loader->cache_limit && loader->lru.length > 1)
+    terminal_image_loader_cache_remove (loader, loader->lru.tail->data);
 }
 
 
 
 static void
-terminal_image_loader_center (TerminalImageLoader *loader,
-                              GdkPixbuf *target,
+terminal_image_loader_cache_clear (TerminalImageLoader *loader)
+{
+  while (loader->lru.head != NULL)
+    terminal_image_loader_cache_remove (loader, loader->lru.head->data);
+}
+
+
+
+static void
+terminal_image_loader_render (TerminalImageLoader *loader,
                               gint width,
-                              gint height)
+                              gint height,
+                              gint scale_factor)
 {
-  guint32 rgba;
-  gint source_width;
-  gint source_height;
-  gint dx;
-  gint dy;
-  gint x0;
-  gint y0;
-
-  /* fill with background color */
-  rgba = ((((guint) (loader->bgcolor.red * 65535) & 0xff00) << 8)
-          | (((guint) (loader->bgcolor.green * 65535) & 0xff00))
-          | (((guint) (loader->bgcolor.blue * 65535) & 0xff00) >> 8))
-         << 8;
-  gdk_pixbuf_fill (target, rgba);
-
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
-
-  dx = MAX ((width - source_width) / 2, 0);
-  dy = MAX ((height - source_height) / 2, 0);
-  x0 = MIN ((width - source_width) / 2, dx);
-  y0 = MIN ((height - source_height) / 2, dy);
-
-  gdk_pixbuf_composite (loader->pixbuf, target, dx, dy,
-                        MIN (width, source_width),
-                        MIN (height, source_height),
-                        x0, y0, 1.0, 1.0,
-                        GDK_INTERP_BILINEAR, 255);
+  TerminalImageCacheEntry *entry;
+  TerminalImageRenderData *render;
+  GTask *task;
+
+  /* add a placeholder, so the size is only rendered once */
+  entry = g_slice_new0 (TerminalImageCacheEntry);
+  entry->width = width;
+  entry->height = height;
+  entry->scale_factor = scale_factor;
+  entry->style = loader->style;
+  terminal_image_loader_cache_insert (loader, entry);
+
+  render = g_slice_new (TerminalImageRenderData);
+  render->source = cairo_surface_reference (loader->image);
+  render->bgcolor = loader->bgcolor;
+  render->style = loader->style;
+  render->width = width;
+  render->height = height;
+  render->scale_factor = scale_factor;
+
+  task = g_task_new (loader, loader->cancellable, terminal_image_loader_render_ready, NULL);
+  g_task_set_source_tag (task, terminal_image_loader_render);
+  g_task_set_task_data (task, render, terminal_image_render_data_free);
+  g_task_run_in_thread (task, terminal_image_loader_render_thread);
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static gboolean
+terminal_image_loader_render_timeout (gpointer user_data)
+{
+  TerminalImageLoader *loader = TERMINAL_IMAGE_LOADER (user_data);
+  TerminalImageCacheEntry key;
+
+  loader->render_timeout_id = 0;
+
+  /* the settings may have changed while waiting */
+  if (G_UNLIKELY (loader->checked_generation != loader->generation))
+    terminal_image_loader_check (loader);
+  if (G_UNLIKELY (loader->image == NULL
+                  || loader->style == TERMINAL_BACKGROUND_STYLE_TILED
+                  || loader->style == TERMINAL_BACKGROUND_STYLE_CENTERED))
+    return FALSE;
+
+  key.width = loader->render_width;
+  key.height = loader->render_height;
+  key.scale_factor = loader->render_scale_factor;
+  key.style = loader->style;
+  if (g_hash_table_lookup (loader->cache, &key) == NULL)
+    terminal_image_loader_render (loader, key.width, key.height, key.scale_factor);
+
+  return FALSE;
 }
 
 
 
 static void
-terminal_image_loader_scale (TerminalImageLoader *loader,
-                             GdkPixbuf *target,
+terminal_image_loader_scale (cairo_surface_t *source,
+                             cairo_surface_t *target,
+                             const GdkRGBA *bgcolor,
                              gint width,
                              gint height)
 {
+  cairo_rectangle_int_t area;
   gdouble xscale;
   gdouble yscale;
-  guint32 rgba;
   gint source_width;
   gint source_height;
   gint x;
   gint y;
+  cairo_t *cr;
 
-  /* fill with background color */
-  rgba = ((((guint) (loader->bgcolor.red * 65535) & 0xff00) << 8)
-          | (((guint) (loader->bgcolor.green * 65535) & 0xff00))
-          | (((guint) (loader->bgcolor.blue * 65535) & 0xff00) >> 8))
-         << 8;
-  gdk_pixbuf_fill (target, rgba);
+  /* fill with background color, images with an alpha channel are
+   * composited on a transparent background */
+  cr = cairo_create (target);
+  cairo_set_source_rgba (cr, bgcolor->red, bgcolor->green, bgcolor->blue,
+                         cairo_image_surface_get_format (source) == CAIRO_FORMAT_ARGB32 ? 0.0 : 1.0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
 
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
+  source_width = cairo_image_surface_get_width (source);
+  source_height = cairo_image_surface_get_height (source);
 
   xscale = (gdouble) width / source_width;
   yscale = (gdouble) height / source_height;
@@ -295,46 +1056,53 @@ terminal_image_loader_scale (TerminalImageLoader *loader,
       y = 0;
     }
 
-  gdk_pixbuf_composite (loader->pixbuf, target, x, y,
-                        source_width * xscale,
-                        source_height * yscale,
-                        x, y, xscale, yscale,
-                        GDK_INTERP_BILINEAR, 255);
+  /* the image area is replaced, the background stays around it */
+  area.x = x;
+  area.y = y;
+  area.width = MIN (width - x, (gint) (source_width * xscale + 0.5));
+  area.height = MIN (height - y, (gint) (source_height * yscale + 0.5));
+  if (area.width > 0 && area.height > 0)
+    terminal_image_resample (source, target, &area, x, y, xscale, yscale);
 }
 
 
 
 static void
-terminal_image_loader_stretch (TerminalImageLoader *loader,
-                               GdkPixbuf *target,
+terminal_image_loader_stretch (cairo_surface_t *source,
+                               cairo_surface_t *target,
+                               const GdkRGBA *bgcolor,
                                gint width,
                                gint height)
 {
+  cairo_rectangle_int_t area;
   gdouble xscale;
   gdouble yscale;
   gint source_width;
   gint source_height;
 
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
+  source_width = cairo_image_surface_get_width (source);
+  source_height = cairo_image_surface_get_height (source);
 
   xscale = (gdouble) width / source_width;
   yscale = (gdouble) height / source_height;
 
-  gdk_pixbuf_composite (loader->pixbuf, target,
-                        0, 0, width, height,
-                        0, 0, xscale, yscale,
-                        GDK_INTERP_BILINEAR, 255);
+  area.x = 0;
+  area.y = 0;
+  area.width = width;
+  area.height = height;
+  terminal_image_resample (source, target, &area, 0.0, 0.0, xscale, yscale);
 }
 
 
 
 static void
-terminal_image_loader_fill (TerminalImageLoader *loader,
-                            GdkPixbuf *target,
+terminal_image_loader_fill (cairo_surface_t *source,
+                            cairo_surface_t *target,
+                            const GdkRGBA *bgcolor,
                             gint width,
                             gint height)
 {
+  cairo_rectangle_int_t area;
   gdouble xscale;
   gdouble yscale;
   gdouble scale;
@@ -343,8 +1111,8 @@ terminal_image_loader_fill (TerminalImageLoader *loader,
   gint source_width;
   gint source_height;
 
-  source_width = gdk_pixbuf_get_width (loader->pixbuf);
-  source_height = gdk_pixbuf_get_height (loader->pixbuf);
+  source_width = cairo_image_surface_get_width (source);
+  source_height = cairo_image_surface_get_height (source);
 
   xscale = (gdouble) width / source_width;
   yscale = (gdouble) height / source_height;
@@ -360,12 +1128,46 @@ terminal_image_loader_fill (TerminalImageLoader *loader,
       xoff = 0;
       yoff = ((scale - yscale) * source_height) * -0.5;
     }
-  scale = MAX (xscale, yscale);
 
-  gdk_pixbuf_scale (loader->pixbuf, target,
-                    0, 0, width, height,
-                    xoff, yoff, scale, scale,
-                    GDK_INTERP_BILINEAR);
+  area.x = 0;
+  area.y = 0;
+  area.width = width;
+  area.height = height;
+  terminal_image_resample (source, target, &area, xoff, yoff, scale, scale);
+}
+
+
+
+static void
+terminal_image_loader_draw_pattern (TerminalImageLoader *loader,
+                                    cairo_t *cr,
+                                    gint width,
+                                    gint height)
+{
+  gint x;
+  gint y;
+
+  if (loader->style == TERMINAL_BACKGROUND_STYLE_TILED)
+    {
+      cairo_set_source_surface (cr, loader->image, 0, 0);
+      cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_REPEAT);
+      cairo_paint (cr);
+    }
+  else
+    {
+      /* fill with background color, images with an alpha channel are
+       * composited on a transparent background */
+      cairo_set_source_rgba (cr, loader->bgcolor.red, loader->bgcolor.green, loader->bgcolor.blue,
+                             cairo_image_surface_get_format (loader->image) == CAIRO_FORMAT_ARGB32 ? 0.0 : 1.0);
+      cairo_paint (cr);
+
+      x = (width - cairo_image_surface_get_width (loader->image)) / 2;
+      y = (height - cairo_image_surface_get_height (loader->image)) / 2;
+
+      cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+      cairo_set_source_surface (cr, loader->image, x, y);
+      cairo_paint (cr);
+    }
 }
 
 
@@ -400,87 +1202,135 @@ terminal_image_loader_get (void)
 
 
 /**
- * terminal_image_loader_load:
- * @loader      : A #TerminalImageLoader.
- * @width       : The image width.
- * @height      : The image height.
+ * terminal_image_loader_draw:
+ * @loader       : A #TerminalImageLoader.
+ * @cr           : The cairo context to paint on.
+ * @width        : The image width in device pixels.
+ * @height       : The image height in device pixels.
+ * @scale_factor : The scale factor of the target of @cr.
+ *
+ * Paints the image in the given @width and @height drawn with the
+ * configured style on @cr, using the current operator. Tiled and centered
+ * images are painted straight from the decoded image. For the other
+ * styles, if the size is not rendered yet, the nearest cached size is
+ * scaled up or down and the exact size is rendered once no new sizes
+ * were requested for a short while, so resizing a window stays responsive.
+ *
+ * Decoding and rendering happen in a worker thread, after which the
+ * #TerminalImageLoader::changed signal is emitted. Decoded images are
+ * kept in the user's cache directory, so the next start only has to
+ * map the file.
  *
- * Return value : The image in the given @width and @height drawn with
- *                the configured style or %NULL on error.
+ * Return value : %TRUE if the image was painted, %FALSE if it is not
+ *                available (yet).
  **/
-GdkPixbuf *
-terminal_image_loader_load (TerminalImageLoader *loader,
+gboolean
+terminal_image_loader_draw (TerminalImageLoader *loader,
+                            cairo_t *cr,
                             gint width,
-                            gint height)
+                            gint height,
+                            gint scale_factor)
 {
-  GdkPixbuf *pixbuf;
-  GSList *lp;
-
-  g_return_val_if_fail (TERMINAL_IS_IMAGE_LOADER (loader), NULL);
-  g_return_val_if_fail (width > 0, NULL);
-  g_return_val_if_fail (height > 0, NULL);
-
-  terminal_image_loader_check (loader);
-
-  if (G_UNLIKELY (loader->pixbuf == NULL || width <= 1 || height <= 1))
-    return NULL;
-
-  g_debug ("Image Loader Memory Status: %d images in valid cache",
-           g_slist_length (loader->cache));
-
-  /* check for a cached version */
-  for (lp = loader->cache; lp != NULL; lp = lp->next)
+  TerminalImageCacheEntry *entry;
+  TerminalImageCacheEntry *candidate;
+  TerminalImageCacheEntry *nearest = NULL;
+  TerminalImageCacheEntry key;
+  gboolean exact;
+  gint distance;
+  gint best = G_MAXINT;
+  GList *lp;
+
+  g_return_val_if_fail (TERMINAL_IS_IMAGE_LOADER (loader), FALSE);
+  g_return_val_if_fail (cr != NULL, FALSE);
+  g_return_val_if_fail (width > 0, FALSE);
+  g_return_val_if_fail (height > 0, FALSE);
+  g_return_val_if_fail (scale_factor > 0, FALSE);
+
+  if (G_UNLIKELY (loader->checked_generation != loader->generation))
+    terminal_image_loader_check (loader);
+
+  /* still decoding or failed to decode */
+  if (G_UNLIKELY (loader->image == NULL || width <= 1 || height <= 1))
+    return FALSE;
+
+  /* images are in device pixels */
+  cairo_save (cr);
+  cairo_scale (cr, 1.0 / scale_factor, 1.0 / scale_factor);
+
+  /* these do not depend on the size, so there is nothing to render and cache */
+  if (loader->style == TERMINAL_BACKGROUND_STYLE_TILED
+      || loader->style == TERMINAL_BACKGROUND_STYLE_CENTERED)
     {
-      gint w, h;
-      pixbuf = GDK_PIXBUF (lp->data);
-      w = gdk_pixbuf_get_width (pixbuf);
-      h = gdk_pixbuf_get_height (pixbuf);
-
-      if ((w == width && h == height)
-          || (w >= width && h >= height && loader->style == TERMINAL_BACKGROUND_STYLE_TILED))
-        {
-          return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
-        }
+      terminal_image_loader_draw_pattern (loader, cr, width, height);
+      cairo_restore (cr);
+      return TRUE;
     }
 
-  pixbuf = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (loader->pixbuf),
-                           gdk_pixbuf_get_has_alpha (loader->pixbuf),
-                           gdk_pixbuf_get_bits_per_sample (loader->pixbuf),
-                           width, height);
+  key.width = width;
+  key.height = height;
+  key.scale_factor = scale_factor;
+  key.style = loader->style;
+  entry = g_hash_table_lookup (loader->cache, &key);
+  exact = (entry != NULL && entry->surface != NULL);
 
-  switch (loader->style)
+  if (!exact)
     {
-    case TERMINAL_BACKGROUND_STYLE_TILED:
-      terminal_image_loader_tile (loader, pixbuf, width, height);
-      break;
-
-    case TERMINAL_BACKGROUND_STYLE_CENTERED:
-      terminal_image_loader_center (loader, pixbuf, width, height);
-      break;
-
-    case TERMINAL_BACKGROUND_STYLE_SCALED:
-      terminal_image_loader_scale (loader, pixbuf, width, height);
-      break;
+      /* find the nearest rendered size */
+      for (lp = loader->lru.head; lp != NULL; lp = lp->next)
+        {
+          candidate = lp->data;
+          if (candidate->scale_factor != scale_factor || candidate->style != loader->style
+              || candidate->surface == NULL)
+            continue;
+
+          distance = ABS (candidate->width - width) + ABS (candidate->height - height);
+          if (distance < best)
+            {
+              best = distance;
+              nearest = candidate;
+            }
+        }
 
-    case TERMINAL_BACKGROUND_STYLE_STRETCHED:
-      terminal_image_loader_stretch (loader, pixbuf, width, height);
-      break;
+      /* the size is not queued for rendering yet */
+      if (entry == NULL)
+        {
+          if (nearest == NULL)
+            {
+              /* nothing to show in the meantime, so render right away */
+              terminal_image_loader_render (loader, width, height, scale_factor);
+            }
+          else
+            {
+              /* restart the timeout for every new size */
+              loader->render_width = width;
+              loader->render_height = height;
+              loader->render_scale_factor = scale_factor;
+              if (loader->render_timeout_id != 0)
+                g_source_remove (loader->render_timeout_id);
+              loader->render_timeout_id = g_timeout_add (RESIZE_TIMEOUT, terminal_image_loader_render_timeout, loader);
+            }
+        }
 
-    case TERMINAL_BACKGROUND_STYLE_FILLED:
-      terminal_image_loader_fill (loader, pixbuf, width, height);
-      break;
+      entry = nearest;
+      if (entry == NULL)
+        {
+          cairo_restore (cr);
+          return FALSE;
+        }
 
-    default:
-      g_assert_not_reached ();
+      /* interim image, scale with the cheapest filter */
+      cairo_scale (cr, (gdouble) width / entry->width, (gdouble) height / entry->height);
+      cairo_set_source_surface (cr, entry->surface, 0, 0);
+      cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_FAST);
     }
+  else
+    cairo_set_source_surface (cr, entry->surface, 0, 0);
 
-  loader->cache = g_slist_prepend (loader->cache, pixbuf);
-  lp = g_slist_nth (loader->cache, CACHE_SIZE - 1);
-  if (lp != NULL)
-    {
-      g_object_unref (lp->data);
-      loader->cache = g_slist_delete_link (loader->cache, lp);
-    }
+  g_queue_unlink (&loader->lru, &entry->link);
+  g_queue_push_head_link (&loader->lru, &entry->link);
+
+  cairo_paint (cr);
+  cairo_restore (cr);
 
-  return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
+  return TRUE;
 }
@@ -30,10 +30,12 @@ G_DECLARE_FINAL_TYPE (TerminalImageLoader, terminal_image_loader, TERMINAL, IMAG
 TerminalImageLoader *
 terminal_image_loader_get (void);
 
-GdkPixbuf *
-terminal_image_loader_load (TerminalImageLoader *loader,
+gboolean
+terminal_image_loader_draw (TerminalImageLoader *loader,
+                            cairo_t *cr,
                             gint width,
-                            gint height);
+                            gint height,
+                            gint scale_factor);
 
 G_END_DECLS
 
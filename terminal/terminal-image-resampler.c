@@ -0,0 +1,369 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "terminal-image-resampler.h"
+
+/* rows per band below which splitting the work is not worth it */
+#define MIN_BAND_HEIGHT 32
+
+
+
+typedef struct _TerminalResampleFilter TerminalResampleFilter;
+typedef struct _TerminalResampleJob TerminalResampleJob;
+typedef struct _TerminalResampleBand TerminalResampleBand;
+
+/* the source pixels and their weights for each target pixel in one
+ * direction, padded with zero weights to the same number of taps, and
+ * the span of source pixels they cover */
+struct _TerminalResampleFilter
+{
+  gint n_taps;
+  gint *indices;
+  gfloat *weights;
+  gint first;
+  gint span;
+};
+
+struct _TerminalResampleJob
+{
+  const guchar *source_data;
+  gint source_stride;
+  guchar *target_data;
+  gint target_stride;
+  gboolean opaque;
+  cairo_rectangle_int_t area;
+
+  TerminalResampleFilter horizontal;
+  TerminalResampleFilter vertical;
+
+  /* bands still being processed by the pool */
+  GMutex lock;
+  GCond cond;
+  gint n_pending;
+};
+
+struct _TerminalResampleBand
+{
+  TerminalResampleJob *job;
+  gint first;
+  gint last;
+};
+
+
+
+static void
+terminal_image_resample_filter_init (TerminalResampleFilter *filter,
+                                     gint first,
+                                     gint length,
+                                     gint source_length,
+                                     gdouble offset,
+                                     gdouble scale);
+static void
+terminal_image_resample_rows (TerminalResampleJob *job,
+                              gint first,
+                              gint last);
+static void
+terminal_image_resample_band (gpointer data,
+                              gpointer user_data);
+
+
+
+static GThreadPool *resample_pool = NULL;
+
+
+
+static inline gint
+terminal_image_resample_floor (gdouble value)
+{
+  gint result = (gint) value;
+
+  return (value < result) ? result - 1 : result;
+}
+
+
+
+static void
+terminal_image_resample_filter_init (TerminalResampleFilter *filter,
+                                     gint first,
+                                     gint length,
+                                     gint source_length,
+                                     gdouble offset,
+                                     gdouble scale)
+{
+  gdouble center;
+  gdouble start;
+  gdouble end;
+  gdouble lo;
+  gdouble hi;
+  gint *indices;
+  gfloat *weights;
+  gint index;
+  gint i;
+  gint k;
+
+  /* interpolate between two pixels when enlarging, average all covered
+   * pixels when shrinking, like GDK_INTERP_BILINEAR */
+  filter->n_taps = (scale >= 1.0) ? 2 : (gint) (1.0 / scale) + 2;
+  filter->indices = g_new (gint, length * filter->n_taps);
+  filter->weights = g_new (gfloat, length * filter->n_taps);
+
+  for (i = 0; i < length; ++i)
+    {
+      indices = filter->indices + i * filter->n_taps;
+      weights = filter->weights + i * filter->n_taps;
+
+      if (scale >= 1.0)
+        {
+          center = (first + i + 0.5 - offset) / scale - 0.5;
+          index = terminal_image_resample_floor (center);
+
+          indices[0] = CLAMP (index, 0, source_length - 1);
+          indices[1] = CLAMP (index + 1, 0, source_length - 1);
+          weights[1] = center - index;
+          weights[0] = 1.0 - weights[1];
+        }
+      else
+        {
+          start = (first + i - offset) / scale;
+          end = (first + i + 1 - offset) / scale;
+          index = terminal_image_resample_floor (start);
+
+          for (k = 0; k < filter->n_taps; ++k)
+            {
+              lo = MAX (start, index + k);
+              hi = MIN (end, index + k + 1);
+
+              /* pixels outside of the source repeat its edges */
+              indices[k] = CLAMP (index + k, 0, source_length - 1);
+              weights[k] = (hi > lo) ? (hi - lo) / (end - start) : 0.0;
+            }
+        }
+    }
+
+  /* the indices only grow, from the first tap to the last */
+  filter->first = filter->indices[0];
+  filter->span = filter->indices[length * filter->n_taps - 1] - filter->first + 1;
+}
+
+
+
+static void
+terminal_image_resample_rows (TerminalResampleJob *job,
+                              gint first,
+                              gint last)
+{
+  const TerminalResampleFilter *horizontal = &job->horizontal;
+  const TerminalResampleFilter *vertical = &job->vertical;
+  const guint32 *source;
+  const gint *indices;
+  const gfloat *weights;
+  const gfloat *p;
+  guint32 *target;
+  gfloat *column;
+  gfloat weight;
+  gfloat a, r, g, b;
+  guint32 pixel;
+  guint ia, ir, ig, ib;
+  gint width = job->area.width;
+  gint span = horizontal->span;
+  gint x;
+  gint y;
+  gint i;
+  gint k;
+
+  /* the weighted sums of the source rows, for the source columns the
+   * target row covers */
+  column = g_new (gfloat, span * 4);
+
+  for (y = first; y < last; ++y)
+    {
+      memset (column, 0, sizeof (gfloat) * span * 4);
+
+      for (k = 0; k < vertical->n_taps; ++k)
+        {
+          weight = vertical->weights[y * vertical->n_taps + k];
+          if (weight == 0.0f)
+            continue;
+
+          /* vertical pass, a contiguous multiply-add over the source row
+           * without lookups, so it is vectorized at -O3 */
+          source = (const guint32 *) (job->source_data
+                                      + (gsize) vertical->indices[y * vertical->n_taps + k] * job->source_stride)
+                   + horizontal->first;
+          for (x = 0; x < span; ++x)
+            {
+              pixel = source[x];
+              column[x * 4 + 0] += weight * (pixel >> 24);
+              column[x * 4 + 1] += weight * ((pixel >> 16) & 0xff);
+              column[x * 4 + 2] += weight * ((pixel >> 8) & 0xff);
+              column[x * 4 + 3] += weight * (pixel & 0xff);
+            }
+        }
+
+      /* horizontal pass, the only one that looks up its taps, once per
+       * target row */
+      target = (guint32 *) (job->target_data + (gsize) (job->area.y + y) * job->target_stride) + job->area.x;
+      for (x = 0; x < width; ++x)
+        {
+          indices = horizontal->indices + x * horizontal->n_taps;
+          weights = horizontal->weights + x * horizontal->n_taps;
+          a = r = g = b = 0.0f;
+
+          for (i = 0; i < horizontal->n_taps; ++i)
+            {
+              p = column + (indices[i] - horizontal->first) * 4;
+              a += weights[i] * p[0];
+              r += weights[i] * p[1];
+              g += weights[i] * p[2];
+              b += weights[i] * p[3];
+            }
+
+          ia = job->opaque ? 0xff : MIN ((guint) (a + 0.5f), 0xff);
+
+          /* premultiplied colors never exceed the alpha value */
+          ir = MIN ((guint) (r + 0.5f), ia);
+          ig = MIN ((guint) (g + 0.5f), ia);
+          ib = MIN ((guint) (b + 0.5f), ia);
+
+          target[x] = (ia << 24) | (ir << 16) | (ig << 8) | ib;
+        }
+    }
+
+  g_free (column);
+}
+
+
+
+static void
+terminal_image_resample_band (gpointer data,
+                              gpointer user_data)
+{
+  TerminalResampleBand *band = data;
+  TerminalResampleJob *job = band->job;
+
+  terminal_image_resample_rows (job, band->first, band->last);
+
+  g_mutex_lock (&job->lock);
+  if (--job->n_pending == 0)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+
+
+/**
+ * terminal_image_resample:
+ * @source   : An image surface in %CAIRO_FORMAT_ARGB32 or %CAIRO_FORMAT_RGB24.
+ * @target   : An image surface in the same format as @source.
+ * @area     : The area of @target to fill.
+ * @x_offset : Horizontal position of @source in @target.
+ * @y_offset : Vertical position of @source in @target.
+ * @x_scale  : Horizontal scale of @source in @target.
+ * @y_scale  : Vertical scale of @source in @target.
+ *
+ * Resamples @source into @area of @target, like gdk_pixbuf_scale() with
+ * %GDK_INTERP_BILINEAR does for pixbufs. The rows of @area are split in
+ * bands, which are processed in parallel on a shared thread pool, and the
+ * call returns once all bands are done. Pixels of @area outside of the
+ * scaled @source repeat the edges of @source.
+ *
+ * This is meant to be called from a worker thread.
+ **/
+void
+terminal_image_resample (cairo_surface_t *source,
+                         cairo_surface_t *target,
+                         const cairo_rectangle_int_t *area,
+                         gdouble x_offset,
+                         gdouble y_offset,
+                         gdouble x_scale,
+                         gdouble y_scale)
+{
+  static gsize pool_initialized = 0;
+  TerminalResampleJob job;
+  TerminalResampleBand *bands;
+  gint n_bands;
+  gint n;
+
+  g_return_if_fail (cairo_image_surface_get_format (source) == cairo_image_surface_get_format (target));
+  g_return_if_fail (area->x >= 0 && area->y >= 0 && area->width > 0 && area->height > 0);
+  g_return_if_fail (area->x + area->width <= cairo_image_surface_get_width (target));
+  g_return_if_fail (area->y + area->height <= cairo_image_surface_get_height (target));
+  g_return_if_fail (x_scale > 0.0 && y_scale > 0.0);
+
+  if (g_once_init_enter (&pool_initialized))
+    {
+      resample_pool = g_thread_pool_new (terminal_image_resample_band, NULL,
+                                         g_get_num_processors (), FALSE, NULL);
+      g_once_init_leave (&pool_initialized, 1);
+    }
+
+  cairo_surface_flush (source);
+  cairo_surface_flush (target);
+
+  job.source_data = cairo_image_surface_get_data (source);
+  job.source_stride = cairo_image_surface_get_stride (source);
+  job.target_data = cairo_image_surface_get_data (target);
+  job.target_stride = cairo_image_surface_get_stride (target);
+  job.opaque = (cairo_image_surface_get_format (source) == CAIRO_FORMAT_RGB24);
+  job.area = *area;
+
+  terminal_image_resample_filter_init (&job.horizontal, area->x, area->width,
+                                       cairo_image_surface_get_width (source),
+                                       x_offset, x_scale);
+  terminal_image_resample_filter_init (&job.vertical, area->y, area->height,
+                                       cairo_image_surface_get_height (source),
+                                       y_offset, y_scale);
+
+  n_bands = CLAMP (area->height / MIN_BAND_HEIGHT, 1, (gint) g_get_num_processors ());
+  bands = g_new (TerminalResampleBand, n_bands);
+
+  g_mutex_init (&job.lock);
+  g_cond_init (&job.cond);
+  job.n_pending = n_bands - 1;
+
+  for (n = 0; n < n_bands; ++n)
+    {
+      bands[n].job = &job;
+      bands[n].first = area->height * n / n_bands;
+      bands[n].last = area->height * (n + 1) / n_bands;
+    }
+
+  /* the pool takes all but the last band, which is done by this thread */
+  for (n = 0; n < n_bands - 1; ++n)
+    g_thread_pool_push (resample_pool, &bands[n], NULL);
+  terminal_image_resample_rows (&job, bands[n_bands - 1].first, bands[n_bands - 1].last);
+
+  g_mutex_lock (&job.lock);
+  while (job.n_pending > 0)
+    g_cond_wait (&job.cond, &job.lock);
+  g_mutex_unlock (&job.lock);
+
+  g_mutex_clear (&job.lock);
+  g_cond_clear (&job.cond);
+
+  g_free (bands);
+  g_free (job.horizontal.indices);
+  g_free (job.horizontal.weights);
+  g_free (job.vertical.indices);
+  g_free (job.vertical.weights);
+
+  cairo_surface_mark_dirty (target);
+}
@@ -0,0 +1,37 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_IMAGE_RESAMPLER_H
+#define TERMINAL_IMAGE_RESAMPLER_H
+
+#include <cairo.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void
+terminal_image_resample (cairo_surface_t *source,
+                         cairo_surface_t *target,
+                         const cairo_rectangle_int_t *area,
+                         gdouble x_offset,
+                         gdouble y_offset,
+                         gdouble x_scale,
+                         gdouble y_scale);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_IMAGE_RESAMPLER_H */
@@ -0,0 +1,700 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for ptsname () */
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "terminal-log.h"
+
+/* bytes between the relay and the writer thread, a power of two */
+#define RING_SIZE (4 * 1024 * 1024)
+
+/* bytes read from a pty at once, in each direction */
+#define RELAY_BUFFER_SIZE (64 * 1024)
+
+/* rotated logs kept besides the current one */
+#define ROTATE_FILES 5
+
+
+
+static void
+terminal_log_finalize (GObject *object);
+static gboolean
+terminal_log_open (TerminalLog *log,
+                   GError **error);
+static void
+terminal_log_rotate (TerminalLog *log);
+static gboolean
+terminal_log_pass (gint fd,
+                   const guint8 *buffer,
+                   gsize *start,
+                   gsize *end);
+static gboolean
+terminal_log_has_room (TerminalLog *log);
+static void
+terminal_log_push (TerminalLog *log,
+                   const guint8 *data,
+                   gsize length);
+static void
+terminal_log_wake_relay (TerminalLog *log);
+static gpointer
+terminal_log_relay (gpointer data);
+static gpointer
+terminal_log_writer (gpointer data);
+
+
+
+struct _TerminalLog
+{
+  GObject parent_instance;
+
+  gchar *filename;
+  guint64 max_size;
+  guint64 size;
+  guint compress : 1;
+  guint dirty : 1;
+
+  /* only used by the writer thread once started */
+  GOutputStream *stream;
+
+  /* the child runs on this pty, its output is relayed to the
+   * slave of the terminal pty and copied into the ring */
+  VtePty *pty;
+  gint slave_fd;
+
+  /* single producer, single consumer: the relay thread only moves
+   * head, the writer thread only moves tail, both wrap around */
+  guint8 *ring;
+  gint head;
+  gint tail;
+
+  /* only taken by the writer to sleep when the ring is empty */
+  GMutex mutex;
+  GCond cond;
+  gint writer_waiting;
+  gint relay_done;
+
+  /* the relay polls this pipe while the ring is too full to read
+   * output, the writer writes to it once it made room */
+  gint wake_fds[2];
+  gint relay_waiting;
+};
+
+
+
+G_DEFINE_TYPE (TerminalLog, terminal_log, G_TYPE_OBJECT)
+
+
+
+static void
+terminal_log_class_init (TerminalLogClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_log_finalize;
+}
+
+
+
+static void
+terminal_log_init (TerminalLog *log)
+{
+  log->slave_fd = -1;
+  log->wake_fds[0] = log->wake_fds[1] = -1;
+  log->ring = g_malloc (RING_SIZE);
+
+  g_mutex_init (&log->mutex);
+  g_cond_init (&log->cond);
+}
+
+
+
+static void
+terminal_log_finalize (GObject *object)
+{
+  TerminalLog *log = TERMINAL_LOG (object);
+
+  /* the writer was never started */
+  if (log->stream != NULL)
+    {
+      g_output_stream_close (log->stream, NULL, NULL);
+      g_object_unref (log->stream);
+    }
+
+  if (log->slave_fd != -1)
+    close (log->slave_fd);
+  if (log->wake_fds[0] != -1)
+    {
+      close (log->wake_fds[0]);
+      close (log->wake_fds[1]);
+    }
+  if (log->pty != NULL)
+    g_object_unref (log->pty);
+
+  g_mutex_clear (&log->mutex);
+  g_cond_clear (&log->cond);
+
+  g_free (log->ring);
+  g_free (log->filename);
+
+  (*G_OBJECT_CLASS (terminal_log_parent_class)->finalize) (object);
+}
+
+
+
+static gboolean
+terminal_log_open (TerminalLog *log,
+                   GError **error)
+{
+  GFileOutputStream *stream;
+  GFileInfo *info;
+  GConverter *compressor;
+  GFile *file;
+
+  file = g_file_new_for_path (log->filename);
+  stream = g_file_append_to (file, G_FILE_CREATE_NONE, NULL, error);
+  g_object_unref (file);
+
+  if (G_UNLIKELY (stream == NULL))
+    return FALSE;
+
+  /* an existing log counts towards the rotation size */
+  info = g_file_output_stream_query_info (stream, G_FILE_ATTRIBUTE_STANDARD_SIZE, NULL, NULL);
+  log->size = info != NULL ? (guint64) g_file_info_get_size (info) : 0;
+  if (info != NULL)
+    g_object_unref (info);
+
+  if (log->compress)
+    {
+      /* gzip members can be concatenated, so appending keeps the file valid */
+      compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+      log->stream = g_converter_output_stream_new (G_OUTPUT_STREAM (stream), compressor);
+      g_object_unref (compressor);
+      g_object_unref (stream);
+    }
+  else
+    log->stream = G_OUTPUT_STREAM (stream);
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_log_rotate (TerminalLog *log)
+{
+  GError *error = NULL;
+  gchar *source;
+  gchar *target;
+  gint n;
+
+  if (!g_output_stream_close (log->stream, NULL, &error))
+    {
+      g_warning ("Failed to close log \"%s\": %s", log->filename, error->message);
+      g_clear_error (&error);
+    }
+  g_clear_object (&log->stream);
+
+  /* the previous log becomes name.1, the oldest one is dropped */
+  for (n = ROTATE_FILES; n > 0; n--)
+    {
+      if (n > 1)
+        source = g_strdup_printf ("%s.%d", log->filename, n - 1);
+      else
+        source = g_strdup (log->filename);
+      target = g_strdup_printf ("%s.%d", log->filename, n);
+
+      g_rename (source, target);
+
+      g_free (source);
+      g_free (target);
+    }
+
+  if (!terminal_log_open (log, &error))
+    {
+      g_warning ("Failed to open log \"%s\": %s", log->filename, error->message);
+      g_error_free (error);
+    }
+}
+
+
+
+static gboolean
+terminal_log_pass (gint fd,
+                   const guint8 *buffer,
+                   gsize *start,
+                   gsize *end)
+{
+  gssize n;
+
+  n = write (fd, buffer + *start, *end - *start);
+  if (n < 0)
+    return errno == EINTR || errno == EAGAIN;
+
+  /* the buffer is read into again once it is empty */
+  *start += n;
+  if (*start == *end)
+    *start = *end = 0;
+
+  return TRUE;
+}
+
+
+
+/* whether a whole read of the child's output fits into the ring */
+static gboolean
+terminal_log_has_room (TerminalLog *log)
+{
+  guint head = g_atomic_int_get (&log->head);
+  guint tail = g_atomic_int_get (&log->tail);
+
+  return RING_SIZE - (head - tail) >= RELAY_BUFFER_SIZE;
+}
+
+
+
+/* only called with room for @length, see terminal_log_has_room() */
+static void
+terminal_log_push (TerminalLog *log,
+                   const guint8 *data,
+                   gsize length)
+{
+  guint head = g_atomic_int_get (&log->head);
+  guint offset;
+  gsize n;
+
+  while (length > 0)
+    {
+      offset = head & (RING_SIZE - 1);
+      n = MIN (length, RING_SIZE - offset);
+      memcpy (log->ring + offset, data, n);
+
+      head += n;
+      data += n;
+      length -= n;
+    }
+
+  g_atomic_int_set (&log->head, head);
+
+  if (g_atomic_int_get (&log->writer_waiting))
+    {
+      g_mutex_lock (&log->mutex);
+      g_cond_broadcast (&log->cond);
+      g_mutex_unlock (&log->mutex);
+    }
+}
+
+
+
+static void
+terminal_log_wake_relay (TerminalLog *log)
+{
+  const guint8 byte = 0;
+
+  /* a full pipe already wakes it up */
+  if (g_atomic_int_compare_and_exchange (&log->relay_waiting, TRUE, FALSE))
+    while (write (log->wake_fds[1], &byte, 1) < 0 && errno == EINTR)
+      ;
+}
+
+
+
+static gpointer
+terminal_log_relay (gpointer data)
+{
+  TerminalLog *log = data;
+  struct pollfd fds[3];
+  guint8 *output;
+  guint8 *input;
+  guint8 wake[64];
+  gsize output_start = 0, output_end = 0;
+  gsize input_start = 0, input_end = 0;
+  gboolean child_hup = FALSE;
+  gboolean room;
+  gint child_fd;
+  gssize n;
+
+  /* output of the child for the terminal, and input of the terminal for
+   * the child; each direction only reads again once it passed everything
+   * on, and never waits for the other one, so a child that does not read
+   * its input while it writes output cannot lock up the relay. Neither
+   * does a full ring: output is only read while the ring has room for
+   * it, input keeps going to the child meanwhile, so Ctrl-C still gets
+   * through when the disk does not keep up */
+  output = g_malloc (RELAY_BUFFER_SIZE);
+  input = g_malloc (RELAY_BUFFER_SIZE);
+
+  child_fd = vte_pty_get_fd (log->pty);
+  g_unix_set_fd_nonblocking (child_fd, TRUE, NULL);
+  g_unix_set_fd_nonblocking (log->slave_fd, TRUE, NULL);
+
+  for (;;)
+    {
+      /* the child is gone once its output is passed on */
+      if (child_fd == -1 && output_end == 0)
+        break;
+
+      /* the writer wakes the relay up once it made room */
+      room = terminal_log_has_room (log);
+      if (!room)
+        {
+          g_atomic_int_set (&log->relay_waiting, TRUE);
+          room = terminal_log_has_room (log);
+          if (room)
+            g_atomic_int_set (&log->relay_waiting, FALSE);
+        }
+
+      /* a hung up pty stays ready, only look at it again once there is
+       * room for the rest of its output */
+      fds[0].fd = (child_fd == -1 || (child_hup && (output_end > 0 || !room))) ? -1 : child_fd;
+      fds[0].events = (output_end == 0 && room ? POLLIN : 0) | (input_end > 0 ? POLLOUT : 0);
+      fds[1].fd = log->slave_fd;
+      fds[1].events = (input_end == 0 ? POLLIN : 0) | (output_end > 0 ? POLLOUT : 0);
+      fds[2].fd = room ? -1 : log->wake_fds[0];
+      fds[2].events = POLLIN;
+
+      if (poll (fds, G_N_ELEMENTS (fds), -1) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          break;
+        }
+
+      /* nothing can be passed on once the terminal closed its pty */
+      if ((fds[1].revents & (POLLHUP | POLLERR)) != 0)
+        break;
+
+      if ((fds[2].revents & POLLIN) != 0)
+        while (read (log->wake_fds[0], wake, sizeof (wake)) > 0)
+          ;
+
+      if ((fds[0].revents & (POLLHUP | POLLERR)) != 0)
+        child_hup = TRUE;
+
+      /* a closed child pty reads as an error once it is drained */
+      if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0 && output_end == 0 && room)
+        {
+          n = read (child_fd, output, RELAY_BUFFER_SIZE);
+          if (n > 0)
+            {
+              output_end = n;
+              terminal_log_push (log, output, n);
+            }
+          else if (n == 0 || (errno != EINTR && errno != EAGAIN))
+            {
+              child_fd = -1;
+              input_start = input_end = 0;
+            }
+        }
+
+      if ((fds[0].revents & POLLOUT) != 0 && child_fd != -1
+          && !terminal_log_pass (child_fd, input, &input_start, &input_end))
+        input_start = input_end = 0;
+
+      if ((fds[1].revents & POLLOUT) != 0
+          && !terminal_log_pass (log->slave_fd, output, &output_start, &output_end))
+        break;
+
+      if ((fds[1].revents & POLLIN) != 0 && input_end == 0)
+        {
+          n = read (log->slave_fd, input, RELAY_BUFFER_SIZE);
+          if (n > 0)
+            input_end = n;
+          else if (n == 0 || (errno != EINTR && errno != EAGAIN))
+            break;
+        }
+    }
+
+  g_free (output);
+  g_free (input);
+
+  /* the terminal reads the end of file and reports the child exited */
+  close (log->slave_fd);
+  log->slave_fd = -1;
+
+  g_mutex_lock (&log->mutex);
+  g_atomic_int_set (&log->relay_done, TRUE);
+  g_cond_broadcast (&log->cond);
+  g_mutex_unlock (&log->mutex);
+
+  g_object_unref (log);
+
+  return NULL;
+}
+
+
+
+static gpointer
+terminal_log_writer (gpointer data)
+{
+  TerminalLog *log = data;
+  GError *error = NULL;
+  guint tail = g_atomic_int_get (&log->tail);
+  guint head;
+  guint offset;
+  gsize n;
+
+  for (;;)
+    {
+      head = g_atomic_int_get (&log->head);
+      if (head == tail)
+        {
+          /* the relay pushes everything before it is done */
+          if (g_atomic_int_get (&log->relay_done))
+            {
+              if ((guint) g_atomic_int_get (&log->head) == tail)
+                break;
+              continue;
+            }
+
+          /* write out what the compressor holds before sleeping */
+          if (log->dirty && log->stream != NULL)
+            g_output_stream_flush (log->stream, NULL, NULL);
+          log->dirty = FALSE;
+
+          g_mutex_lock (&log->mutex);
+          g_atomic_int_set (&log->writer_waiting, TRUE);
+          while ((guint) g_atomic_int_get (&log->head) == tail
+                 && !g_atomic_int_get (&log->relay_done))
+            g_cond_wait (&log->cond, &log->mutex);
+          g_atomic_int_set (&log->writer_waiting, FALSE);
+          g_mutex_unlock (&log->mutex);
+          continue;
+        }
+
+      offset = tail & (RING_SIZE - 1);
+      n = MIN (head - tail, RING_SIZE - offset);
+
+      if (log->stream != NULL
+          && !g_output_stream_write_all (log->stream, log->ring + offset, n, NULL, NULL, &error))
+        {
+          g_warning ("Failed to write log \"%s\": %s", log->filename, error->message);
+          g_clear_error (&error);
+
+          /* keep draining the ring, the terminal must not wait on a broken log */
+          g_output_stream_close (log->stream, NULL, NULL);
+          g_clear_object (&log->stream);
+        }
+
+      tail += n;
+      g_atomic_int_set (&log->tail, tail);
+
+      if (g_atomic_int_get (&log->relay_waiting))
+        terminal_log_wake_relay (log);
+
+      log->dirty = TRUE;
+      log->size += n;
+      if (log->max_size > 0 && log->size >= log->max_size && log->stream != NULL)
+        terminal_log_rotate (log);
+    }
+
+  if (log->stream != NULL)
+    {
+      if (!g_output_stream_close (log->stream, NULL, &error))
+        {
+          g_warning ("Failed to close log \"%s\": %s", log->filename, error->message);
+          g_error_free (error);
+        }
+      g_clear_object (&log->stream);
+    }
+
+  g_object_unref (log);
+
+  return NULL;
+}
+
+
+
+/**
+ * terminal_log_new:
+ * @filename : Path of the log file.
+ * @max_size : Bytes after which the log is rotated, or 0.
+ * @compress : Whether to write the log gzip compressed.
+ * @error    : Return location for errors or %NULL.
+ *
+ * Opens @filename for appending, creating its directory if needed.
+ *
+ * Return value: A new #TerminalLog or %NULL on error.
+ **/
+TerminalLog *
+terminal_log_new (const gchar *filename,
+                  guint64 max_size,
+                  gboolean compress,
+                  GError **error)
+{
+  TerminalLog *log;
+  gchar *dirname;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  log = g_object_new (TERMINAL_TYPE_LOG, NULL);
+  log->filename = g_strdup (filename);
+  log->max_size = max_size;
+  log->compress = !!compress;
+
+  dirname = g_path_get_dirname (filename);
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  if (!g_unix_open_pipe (log->wake_fds, FD_CLOEXEC, error)
+      || !terminal_log_open (log, error))
+    {
+      g_object_unref (log);
+      return NULL;
+    }
+
+  g_unix_set_fd_nonblocking (log->wake_fds[0], TRUE, NULL);
+  g_unix_set_fd_nonblocking (log->wake_fds[1], TRUE, NULL);
+
+  return log;
+}
+
+
+
+/**
+ * terminal_log_create_pty:
+ * @log   : A #TerminalLog.
+ * @pty   : The pty of the terminal.
+ * @error : Return location for errors or %NULL.
+ *
+ * Creates the pty the child is spawned on. Once started, everything
+ * written to it is passed on to @pty unchanged and to the log, and
+ * everything the terminal writes to @pty is passed back to the child.
+ *
+ * Return value: A new #VtePty, or %NULL on error.
+ **/
+VtePty *
+terminal_log_create_pty (TerminalLog *log,
+                         VtePty *pty,
+                         GError **error)
+{
+  struct termios tios;
+  const gchar *name;
+  gboolean utf8 = TRUE;
+  gint saved_errno;
+
+  g_return_val_if_fail (TERMINAL_IS_LOG (log), NULL);
+  g_return_val_if_fail (VTE_IS_PTY (pty), NULL);
+  g_return_val_if_fail (log->pty == NULL, NULL);
+
+  name = ptsname (vte_pty_get_fd (pty));
+  if (name != NULL)
+    log->slave_fd = open (name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+  if (G_UNLIKELY (log->slave_fd == -1))
+    {
+      saved_errno = errno;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   _("Failed to open the terminal device: %s"), g_strerror (saved_errno));
+      return NULL;
+    }
+
+  /* the terminal side only passes bytes, the line discipline
+   * that matters is the one of the child pty */
+  if (tcgetattr (log->slave_fd, &tios) == 0)
+    {
+#ifdef IUTF8
+      utf8 = (tios.c_iflag & IUTF8) != 0;
+#endif
+      cfmakeraw (&tios);
+      tcsetattr (log->slave_fd, TCSANOW, &tios);
+    }
+
+  log->pty = vte_pty_new_sync (VTE_PTY_DEFAULT, NULL, error);
+  if (G_UNLIKELY (log->pty == NULL))
+    return NULL;
+
+  vte_pty_set_utf8 (log->pty, utf8, NULL);
+
+  return g_object_ref (log->pty);
+}
+
+
+
+/**
+ * terminal_log_start:
+ * @log : A #TerminalLog.
+ *
+ * Starts relaying and logging, after the child was spawned on the
+ * pty of terminal_log_create_pty(), as a pty without any process
+ * attached reads as hung up.
+ **/
+void
+terminal_log_start (TerminalLog *log)
+{
+  g_return_if_fail (TERMINAL_IS_LOG (log));
+  g_return_if_fail (log->pty != NULL);
+
+  g_thread_unref (g_thread_new ("terminal-log-writer", terminal_log_writer, g_object_ref (log)));
+  g_thread_unref (g_thread_new ("terminal-log-relay", terminal_log_relay, g_object_ref (log)));
+}
+
+
+
+/**
+ * terminal_log_set_size:
+ * @log     : A #TerminalLog.
+ * @rows    : Rows of the terminal.
+ * @columns : Columns of the terminal.
+ *
+ * Passes the size of the terminal on to the child pty.
+ **/
+void
+terminal_log_set_size (TerminalLog *log,
+                       glong rows,
+                       glong columns)
+{
+  g_return_if_fail (TERMINAL_IS_LOG (log));
+
+  if (log->pty != NULL)
+    vte_pty_set_size (log->pty, rows, columns, NULL);
+}
+
+
+
+/**
+ * terminal_log_get_fd:
+ * @log : A #TerminalLog.
+ *
+ * Return value: The master fd of the child pty, or -1.
+ **/
+gint
+terminal_log_get_fd (TerminalLog *log)
+{
+  g_return_val_if_fail (TERMINAL_IS_LOG (log), -1);
+
+  return log->pty != NULL ? vte_pty_get_fd (log->pty) : -1;
+}
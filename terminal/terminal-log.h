@@ -0,0 +1,52 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_LOG_H
+#define TERMINAL_LOG_H
+
+#include "terminal-private.h"
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_LOG (terminal_log_get_type ())
+G_DECLARE_FINAL_TYPE (TerminalLog, terminal_log, TERMINAL, LOG, GObject)
+
+TerminalLog *
+terminal_log_new (const gchar *filename,
+                  guint64 max_size,
+                  gboolean compress,
+                  GError **error);
+
+VtePty *
+terminal_log_create_pty (TerminalLog *log,
+                         VtePty *pty,
+                         GError **error);
+
+void
+terminal_log_start (TerminalLog *log);
+
+void
+terminal_log_set_size (TerminalLog *log,
+                       glong rows,
+                       glong columns);
+
+gint
+terminal_log_get_fd (TerminalLog *log);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_LOG_H */
@@ -380,6 +380,21 @@ terminal_window_attr_parse (gint argc,
         {
           tab_attr->hold = TRUE;
         }
+      else if (terminal_option_cmp ("log", 0, argc, argv, &n, &s, &short_offset))
+        {
+          if (G_UNLIKELY (s == NULL))
+            {
+              g_set_error (error, G_SHELL_ERROR, G_SHELL_ERROR_FAILED,
+                           _("Option "--log" requires specifying "
+                             "the log file as its parameter"));
+              goto failed;
+            }
+          else
+            {
+              g_free (tab_attr->log_file);
+              tab_attr->log_file = g_strdup (s);
+            }
+        }
       else if (terminal_option_cmp ("active-tab", 0, argc, argv, &n, NULL, &short_offset))
         {
           tab_attr->active = TRUE;
@@ -660,6 +675,22 @@ unknown_option:
         }
     }
 
+  /* log files are relative to the directory terminal was started in */
+  for (wp = attrs; wp != NULL; wp = wp->next)
+    {
+      win_attr = wp->data;
+      for (tp = win_attr->tabs; tp != NULL; tp = tp->next)
+        {
+          tab_attr = tp->data;
+          if (tab_attr->log_file != NULL && !g_path_is_absolute (tab_attr->log_file))
+            {
+              s = g_canonicalize_filename (tab_attr->log_file, default_directory);
+              g_free (tab_attr->log_file);
+              tab_attr->log_file = s;
+            }
+        }
+    }
+
   /* substitute default working directory and default display if any */
   if (default_display != NULL || default_directory != NULL)
     {
@@ -749,6 +780,7 @@ terminal_tab_attr_free (TerminalTabAttr *attr)
   g_free (attr->color_text);
   g_free (attr->color_bg);
   g_free (attr->color_title);
+  g_free (attr->log_file);
   g_slice_free (TerminalTabAttr, attr);
 }
 
@@ -62,6 +62,7 @@ typedef struct
   gchar *color_text;
   gchar *color_bg;
   gchar *color_title;
+  gchar *log_file;
   TerminalTitle dynamic_title_mode;
   gint position;
   guint hold : 1;
@@ -214,6 +214,7 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   GtkWidget *entry;
   GtkWidget *combo;
   gchar *current;
+  gchar *directory;
   gint row = 0;
   const gchar *text;
 
@@ -1540,6 +1541,72 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   g_free (current);
 
 
+  /* section: Logging */
+  terminal_preferences_dialog_new_section (&frame, &vbox, &grid, &label, &row, _("Logging"));
+
+  button = gtk_check_button_new_with_mnemonic (_("_Log the output of every tab"));
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-log-sessions",
+                          G_OBJECT (button), "active",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+  gtk_grid_attach (GTK_GRID (grid), button, 0, row, 3, 1);
+  gtk_widget_show (button);
+
+  /* next row */
+  row++;
+
+  label = gtk_label_new_with_mnemonic (_("Log _directory:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_grid_attach (GTK_GRID (grid), label, 0, row, 1, 1);
+  gtk_widget_show (label);
+
+  entry = gtk_entry_new ();
+  directory = terminal_util_get_default_log_directory ();
+  gtk_entry_set_placeholder_text (GTK_ENTRY (entry), directory);
+  g_free (directory);
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-log-directory",
+                          G_OBJECT (entry), "text",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+  gtk_widget_set_hexpand (entry, TRUE);
+  gtk_grid_attach (GTK_GRID (grid), entry, 1, row, 2, 1);
+  terminal_gtk_label_set_a11y_relation (GTK_LABEL (label), entry);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), entry);
+  gtk_widget_show (entry);
+
+  /* next row */
+  row++;
+
+  label = gtk_label_new_with_mnemonic (_("_Rotate logs after"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_grid_attach (GTK_GRID (grid), label, 0, row, 1, 1);
+  gtk_widget_show (label);
+
+  button = gtk_spin_button_new_with_range (0, 1024 * 1024, 1);
+  gtk_widget_set_tooltip_text (button, _("Set to 0 to never rotate the logs."));
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-log-max-size",
+                          G_OBJECT (button), "value",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+  gtk_widget_set_halign (button, GTK_ALIGN_START);
+  gtk_grid_attach (GTK_GRID (grid), button, 1, row, 1, 1);
+  terminal_gtk_label_set_a11y_relation (GTK_LABEL (label), button);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), button);
+  gtk_widget_show (button);
+
+  label = gtk_label_new (_("MiB"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_grid_attach (GTK_GRID (grid), label, 2, row, 1, 1);
+  gtk_widget_show (label);
+
+  /* next row */
+  row++;
+
+  button = gtk_check_button_new_with_mnemonic (_("Compress logs with _gzip"));
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-log-compress",
+                          G_OBJECT (button), "active",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+  gtk_grid_attach (GTK_GRID (grid), button, 0, row, 3, 1);
+  gtk_widget_show (button);
+
+
   /* section: Shortcuts */
   terminal_preferences_dialog_new_section (&frame, &vbox, &grid, &label, &row, _("Shortcuts"));
 
@@ -1584,6 +1651,19 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   /* next row */
   row++;
 
+  button = gtk_check_button_new_with_mnemonic (_("Only underline URLs while _Ctrl is held"));
+  gtk_widget_set_tooltip_text (button, _("Saves looking for URLs on every mouse movement, which is noticeable with very long lines of output."));
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-highlight-urls-on-demand",
+                          G_OBJECT (button), "active",
+                          G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+  g_object_bind_property (G_OBJECT (dialog->preferences), "misc-highlight-urls",
+                          G_OBJECT (button), "visible",
+                          G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
+  gtk_grid_attach (GTK_GRID (grid), button, 0, row, 2, 1);
+
+  /* next row */
+  row++;
+
   button = gtk_check_button_new_with_mnemonic (_("_Use middle mouse click to open urls"));
   g_object_bind_property (G_OBJECT (dialog->preferences), "misc-middle-click-opens-uri",
                           G_OBJECT (button), "active",
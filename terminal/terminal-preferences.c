@@ -37,6 +37,9 @@
 #define TERMINALRC "xfce4/terminal/terminalrc"
 #define TERMINALRC_OLD "Terminal/terminalrc"
 
+/* seconds between logging the read statistics, with debug messages on */
+#define STATISTICS_INTERVAL 60
+
 
 enum
 {
@@ -105,6 +108,7 @@ enum
   PROP_MISC_TAB_CLOSE_MIDDLE_CLICK,
   PROP_MISC_TAB_POSITION,
   PROP_MISC_HIGHLIGHT_URLS,
+  PROP_MISC_HIGHLIGHT_URLS_ON_DEMAND,
   PROP_MISC_MIDDLE_CLICK_OPENS_URI,
   PROP_MISC_COPY_ON_SELECT,
   PROP_MISC_SHOW_RELAUNCH_DIALOG,
@@ -114,9 +118,15 @@ enum
   PROP_MISC_SLIM_TABS,
   PROP_MISC_NEW_TAB_ADJACENT,
   PROP_MISC_SEARCH_DIALOG_OPACITY,
+  PROP_MISC_SEARCH_INDEX,
   PROP_MISC_SHOW_UNSAFE_PASTE_DIALOG,
   PROP_MISC_RIGHT_CLICK_ACTION,
   PROP_MISC_HYPERLINKS_ENABLED,
+  PROP_MISC_IMAGE_CACHE_SIZE,
+  PROP_MISC_LOG_SESSIONS,
+  PROP_MISC_LOG_DIRECTORY,
+  PROP_MISC_LOG_MAX_SIZE,
+  PROP_MISC_LOG_COMPRESS,
   PROP_SCROLLING_BAR,
   PROP_OVERLAY_SCROLLING,
   PROP_SCROLLING_LINES,
@@ -159,6 +169,15 @@ terminal_preferences_prop_changed (XfconfChannel *channel,
                                    TerminalPreferences *preferences);
 static void
 terminal_preferences_load_rc_file (TerminalPreferences *preferences);
+static void
+terminal_preferences_cache_load (TerminalPreferences *preferences,
+                                 guint prop_id);
+static void
+terminal_preferences_cache_set (TerminalPreferences *preferences,
+                                guint prop_id,
+                                const GValue *src);
+static gboolean
+terminal_preferences_log_statistics (gpointer data);
 
 
 
@@ -167,6 +186,20 @@ struct _TerminalPreferences
   GObject __parent__;
 
   XfconfChannel *channel;
+
+  /* typed snapshot of every property, only refreshed from
+   * terminal_preferences_prop_changed() */
+  GValue values[N_PROPERTIES];
+
+  /* parsed colors, rebuilt on the first read after a color change */
+  TerminalColorSet colors;
+  guint colors_dirty : 1;
+
+  /* statistics, to verify xfconf is not queried on reads */
+  guint64 n_channel_reads;
+  guint64 n_cache_reads;
+  guint64 n_logged_reads;
+  guint statistics_id;
 };
 
 
@@ -1011,6 +1044,19 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                           TRUE,
                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-highlight-urls-on-demand:
+   *
+   * Only look for urls under the pointer while Ctrl is held, which saves
+   * the matching on pointer motion over large amounts of output.
+   **/
+  preferences_props[PROP_MISC_HIGHLIGHT_URLS_ON_DEMAND] =
+    g_param_spec_boolean ("misc-highlight-urls-on-demand",
+                          NULL,
+                          "MiscHighlightUrlsOnDemand",
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:misc-middle-click-open-uri:
    **/
@@ -1081,6 +1127,21 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                        0, 100, 100,
                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-search-index:
+   *
+   * Keep a trigram index of the scrollback, so searching plain text in
+   * a very long scrollback only scans the rows that may contain it. This
+   * costs memory in the order of the scrollback text, so a scrollback of
+   * more than 100000 lines, or an unlimited one, is not indexed.
+   **/
+  preferences_props[PROP_MISC_SEARCH_INDEX] =
+    g_param_spec_boolean ("misc-search-index",
+                          NULL,
+                          "MiscSearchIndex",
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:misc-show-unsafe-paste-dialog:
    **/
@@ -1112,6 +1173,68 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                           TRUE,
                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-image-cache-size:
+   *
+   * Memory in MiB the background image loader may use for rendered
+   * images, shared by all terminals.
+   **/
+  preferences_props[PROP_MISC_IMAGE_CACHE_SIZE] =
+    g_param_spec_uint ("misc-image-cache-size",
+                       NULL,
+                       "MiscImageCacheSize",
+                       1, 1024, 64,
+                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-log-sessions:
+   *
+   * Log everything the child processes of all tabs write, tabs opened
+   * with --log are logged regardless.
+   **/
+  preferences_props[PROP_MISC_LOG_SESSIONS] =
+    g_param_spec_boolean ("misc-log-sessions",
+                          NULL,
+                          "MiscLogSessions",
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-log-directory:
+   *
+   * Directory of the logs of misc-log-sessions, empty for the
+   * xfce4/terminal/logs directory in the user data directory.
+   **/
+  preferences_props[PROP_MISC_LOG_DIRECTORY] =
+    g_param_spec_string ("misc-log-directory",
+                         NULL,
+                         "MiscLogDirectory",
+                         "",
+                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-log-max-size:
+   *
+   * Size in MiB of the logged output after which a log is rotated,
+   * 0 to never rotate.
+   **/
+  preferences_props[PROP_MISC_LOG_MAX_SIZE] =
+    g_param_spec_uint ("misc-log-max-size",
+                       NULL,
+                       "MiscLogMaxSize",
+                       0, 1024 * 1024, 0,
+                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-log-compress:
+   **/
+  preferences_props[PROP_MISC_LOG_COMPRESS] =
+    g_param_spec_boolean ("misc-log-compress",
+                          NULL,
+                          "MiscLogCompress",
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:scrolling-bar:
    **/
@@ -1288,6 +1411,21 @@ terminal_preferences_init (TerminalPreferences *preferences)
 {
   GError *error = NULL;
   gchar **channels;
+  guint n;
+
+  preferences->colors_dirty = TRUE;
+
+  /* the preferences live as long as the application, so the statistics
+   * are logged while it runs */
+  if (g_getenv ("G_MESSAGES_DEBUG") != NULL)
+    preferences->statistics_id = g_timeout_add_seconds (STATISTICS_INTERVAL, terminal_preferences_log_statistics, preferences);
+
+  /* initialize the snapshot with the defaults */
+  for (n = PROP_0 + 1; n < N_PROPERTIES; ++n)
+    {
+      g_value_init (&preferences->values[n], G_PARAM_SPEC_VALUE_TYPE (preferences_props[n]));
+      g_param_value_set_default (preferences_props[n], &preferences->values[n]);
+    }
 
   /* don't set a channel if xfconf init failed */
   if (!xfconf_init (&error))
@@ -1308,6 +1446,10 @@ terminal_preferences_init (TerminalPreferences *preferences)
     }
   g_strfreev (channels);
 
+  /* fill the snapshot, from now on it is only updated on changes */
+  for (n = PROP_0 + 1; n < N_PROPERTIES; ++n)
+    terminal_preferences_cache_load (preferences, n);
+
   g_signal_connect (G_OBJECT (preferences->channel), "property-changed",
                     G_CALLBACK (terminal_preferences_prop_changed), preferences);
 }
@@ -1318,6 +1460,13 @@ static void
 terminal_preferences_finalize (GObject *object)
 {
   TerminalPreferences *preferences = TERMINAL_PREFERENCES (object);
+  guint n;
+
+  if (preferences->statistics_id != 0)
+    g_source_remove (preferences->statistics_id);
+
+  for (n = PROP_0 + 1; n < N_PROPERTIES; ++n)
+    g_value_unset (&preferences->values[n]);
 
   if (G_LIKELY (preferences->channel != NULL))
     xfconf_shutdown ();
@@ -1334,41 +1483,12 @@ terminal_preferences_get_property (GObject *object,
                                    GParamSpec *pspec)
 {
   TerminalPreferences *preferences = TERMINAL_PREFERENCES (object);
-  GValue src = G_VALUE_INIT;
-  gchar prop_name[64];
-  gchar **array;
 
   g_return_if_fail (prop_id < N_PROPERTIES);
 
-  /* only set defaults if channel is not set */
-  if (G_UNLIKELY (preferences->channel == NULL))
-    {
-      g_param_value_set_default (pspec, value);
-      return;
-    }
-
-  /* build property name */
-  g_snprintf (prop_name, sizeof (prop_name), "/%s", g_param_spec_get_name (pspec));
-
-  if (G_VALUE_TYPE (value) == G_TYPE_STRV)
-    {
-      /* handle arrays directly since we cannot transform those */
-      array = xfconf_channel_get_string_list (preferences->channel, prop_name);
-      g_value_take_boxed (value, array);
-    }
-  else if (xfconf_channel_get_property (preferences->channel, prop_name, &src))
-    {
-      if (G_VALUE_TYPE (value) == G_VALUE_TYPE (&src))
-        g_value_copy (&src, value);
-      else if (!g_value_transform (&src, value))
-        g_warning ("Failed to transform property %s", prop_name);
-      g_value_unset (&src);
-    }
-  else
-    {
-      /* value is not found, return default */
-      g_param_value_set_default (pspec, value);
-    }
+  /* serve the value from the snapshot, never from xfconf */
+  preferences->n_cache_reads++;
+  g_value_copy (&preferences->values[prop_id], value);
 }
 
 
@@ -1413,6 +1533,9 @@ terminal_preferences_set_property (GObject *object,
       /* other types we support directly */
       xfconf_channel_set_property (preferences->channel, prop_name, value);
     }
+
+  /* write-through, so a get right after a set is consistent */
+  terminal_preferences_cache_set (preferences, prop_id, value);
 }
 
 
@@ -1428,7 +1551,99 @@ terminal_preferences_prop_changed (XfconfChannel *channel,
   /* check if the property exists and emit change */
   pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (preferences), prop_name + 1);
   if (G_LIKELY (pspec != NULL))
-    g_object_notify_by_pspec (G_OBJECT (preferences), pspec);
+    {
+      /* update the snapshot; arrays are sent as GPtrArray, so reload those */
+      if (G_PARAM_SPEC_VALUE_TYPE (pspec) == G_TYPE_STRV)
+        terminal_preferences_cache_load (preferences, pspec->param_id);
+      else
+        terminal_preferences_cache_set (preferences, pspec->param_id, value);
+
+      g_object_notify_by_pspec (G_OBJECT (preferences), pspec);
+    }
+}
+
+
+
+static void
+terminal_preferences_cache_load (TerminalPreferences *preferences,
+                                 guint prop_id)
+{
+  GParamSpec *pspec = preferences_props[prop_id];
+  GValue src = G_VALUE_INIT;
+  gchar prop_name[64];
+  gchar **array;
+
+  g_return_if_fail (prop_id > PROP_0 && prop_id < N_PROPERTIES);
+  g_return_if_fail (preferences->channel != NULL);
+
+  /* build property name */
+  g_snprintf (prop_name, sizeof (prop_name), "/%s", g_param_spec_get_name (pspec));
+
+  preferences->n_channel_reads++;
+
+  if (G_PARAM_SPEC_VALUE_TYPE (pspec) == G_TYPE_STRV)
+    {
+      /* handle arrays directly since we cannot transform those */
+      array = xfconf_channel_get_string_list (preferences->channel, prop_name);
+      g_value_take_boxed (&preferences->values[prop_id], array);
+    }
+  else if (xfconf_channel_get_property (preferences->channel, prop_name, &src))
+    {
+      terminal_preferences_cache_set (preferences, prop_id, &src);
+      g_value_unset (&src);
+    }
+  else
+    {
+      /* value is not found, use default */
+      terminal_preferences_cache_set (preferences, prop_id, NULL);
+    }
+}
+
+
+
+static void
+terminal_preferences_cache_set (TerminalPreferences *preferences,
+                                guint prop_id,
+                                const GValue *src)
+{
+  GParamSpec *pspec = preferences_props[prop_id];
+  GValue *dst = &preferences->values[prop_id];
+
+  g_return_if_fail (prop_id > PROP_0 && prop_id < N_PROPERTIES);
+
+  if ((prop_id >= PROP_COLOR_FOREGROUND && prop_id <= PROP_COLOR_USE_THEME)
+      || prop_id == PROP_TAB_ACTIVITY_COLOR)
+    preferences->colors_dirty = TRUE;
+
+  /* the property was reset or removed from the channel */
+  if (src == NULL || !G_IS_VALUE (src))
+    g_param_value_set_default (pspec, dst);
+  else if (G_VALUE_TYPE (src) == G_VALUE_TYPE (dst))
+    g_value_copy (src, dst);
+  else if (!g_value_transform (src, dst))
+    {
+      g_warning ("Failed to transform property /%s", g_param_spec_get_name (pspec));
+      g_param_value_set_default (pspec, dst);
+    }
+}
+
+
+
+static gboolean
+terminal_preferences_log_statistics (gpointer data)
+{
+  TerminalPreferences *preferences = TERMINAL_PREFERENCES (data);
+  guint64 n_reads = preferences->n_channel_reads + preferences->n_cache_reads;
+
+  /* only when there were reads since the last time */
+  if (n_reads != preferences->n_logged_reads)
+    {
+      g_debug ("Preferences: %" G_GUINT64_FORMAT " xfconf reads, %" G_GUINT64_FORMAT " cached reads",
+               preferences->n_channel_reads, preferences->n_cache_reads);
+      preferences->n_logged_reads = n_reads;
+    }
+
+  return G_SOURCE_CONTINUE;
 }
 
 
@@ -1538,6 +1753,64 @@ terminal_preferences_load_rc_file (TerminalPreferences *preferences)
 
 
 
+static gboolean
+terminal_preferences_parse_color (TerminalPreferences *preferences,
+                                  guint prop_id,
+                                  GdkRGBA *color_return)
+{
+  const gchar *spec;
+
+  spec = g_value_get_string (&preferences->values[prop_id]);
+  return spec != NULL && gdk_rgba_parse (color_return, spec);
+}
+
+
+
+static void
+terminal_preferences_update_colors (TerminalPreferences *preferences)
+{
+  TerminalColorSet *colors = &preferences->colors;
+  const gchar *palette_str;
+  gchar **specs;
+  guint n = 0;
+
+  memset (colors, 0, sizeof (*colors));
+
+  palette_str = g_value_get_string (&preferences->values[PROP_COLOR_PALETTE]);
+  if (G_LIKELY (palette_str != NULL))
+    {
+      specs = g_strsplit (palette_str, ";", -1);
+      for (; n < 16 && specs[n] != NULL; n++)
+        if (!gdk_rgba_parse (colors->palette + n, specs[n]))
+          {
+            g_warning ("Unable to parse color \"%s\".", specs[n]);
+            break;
+          }
+      g_strfreev (specs);
+    }
+  colors->has_palette = (n == 16);
+
+  colors->has_foreground = terminal_preferences_parse_color (preferences, PROP_COLOR_FOREGROUND, &colors->foreground);
+  colors->has_background = terminal_preferences_parse_color (preferences, PROP_COLOR_BACKGROUND, &colors->background);
+  colors->has_cursor_foreground = terminal_preferences_parse_color (preferences, PROP_COLOR_CURSOR_FOREGROUND, &colors->cursor_foreground);
+  colors->has_cursor = terminal_preferences_parse_color (preferences, PROP_COLOR_CURSOR, &colors->cursor);
+  colors->has_selection = terminal_preferences_parse_color (preferences, PROP_COLOR_SELECTION, &colors->selection);
+  colors->has_selection_background = terminal_preferences_parse_color (preferences, PROP_COLOR_SELECTION_BACKGROUND, &colors->selection_background);
+  colors->has_bold = terminal_preferences_parse_color (preferences, PROP_COLOR_BOLD, &colors->bold);
+  colors->has_tab_activity = terminal_preferences_parse_color (preferences, PROP_TAB_ACTIVITY_COLOR, &colors->tab_activity);
+
+  colors->cursor_use_default = g_value_get_boolean (&preferences->values[PROP_COLOR_CURSOR_USE_DEFAULT]);
+  colors->selection_use_default = g_value_get_boolean (&preferences->values[PROP_COLOR_SELECTION_USE_DEFAULT]);
+  colors->bold_use_default = g_value_get_boolean (&preferences->values[PROP_COLOR_BOLD_USE_DEFAULT]);
+  colors->background_vary = g_value_get_boolean (&preferences->values[PROP_COLOR_BACKGROUND_VARY]);
+  colors->bold_is_bright = g_value_get_boolean (&preferences->values[PROP_COLOR_BOLD_IS_BRIGHT]);
+  colors->use_theme = g_value_get_boolean (&preferences->values[PROP_COLOR_USE_THEME]);
+
+  preferences->colors_dirty = FALSE;
+}
+
+
+
 /**
  * terminal_preferences_get:
  *
@@ -1581,3 +1854,26 @@ terminal_preferences_get_color (TerminalPreferences *preferences,
 
   return succeed;
 }
+
+
+
+/**
+ * terminal_preferences_get_colors:
+ * @preferences : A #TerminalPreferences.
+ *
+ * Returns the colors of the color-* properties, parsed once and shared
+ * by all screens. The set is owned by @preferences and only valid until
+ * the next change of a color property, so don't keep it around.
+ *
+ * Return value : The resolved #TerminalColorSet.
+ **/
+const TerminalColorSet *
+terminal_preferences_get_colors (TerminalPreferences *preferences)
+{
+  g_return_val_if_fail (TERMINAL_IS_PREFERENCES (preferences), NULL);
+
+  if (G_UNLIKELY (preferences->colors_dirty))
+    terminal_preferences_update_colors (preferences);
+
+  return &preferences->colors;
+}
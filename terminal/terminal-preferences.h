@@ -96,9 +96,43 @@ typedef enum /*< enum,prefix=TERMINAL_RIGHT_CLICK_ACTION >*/
   TERMINAL_RIGHT_CLICK_ACTION_PASTE_SELECTION
 } TerminalRightClickAction;
 
+/* colors resolved from the color-* properties, shared by all screens */
+typedef struct
+{
+  GdkRGBA palette[16];
+  GdkRGBA foreground;
+  GdkRGBA background;
+  GdkRGBA cursor_foreground;
+  GdkRGBA cursor;
+  GdkRGBA selection;
+  GdkRGBA selection_background;
+  GdkRGBA bold;
+  GdkRGBA tab_activity;
+
+  guint has_palette : 1;
+  guint has_foreground : 1;
+  guint has_background : 1;
+  guint has_cursor_foreground : 1;
+  guint has_cursor : 1;
+  guint has_selection : 1;
+  guint has_selection_background : 1;
+  guint has_bold : 1;
+  guint has_tab_activity : 1;
+
+  guint cursor_use_default : 1;
+  guint selection_use_default : 1;
+  guint bold_use_default : 1;
+  guint background_vary : 1;
+  guint bold_is_bright : 1;
+  guint use_theme : 1;
+} TerminalColorSet;
+
 TerminalPreferences *
 terminal_preferences_get (void);
 
+const TerminalColorSet *
+terminal_preferences_get_colors (TerminalPreferences *preferences);
+
 gboolean
 terminal_preferences_get_color (TerminalPreferences *preferences,
                                 const gchar *property,
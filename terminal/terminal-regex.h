@@ -143,13 +143,46 @@
 
 #define DEFS APOS_START_DEF IP_DEF PATH_INNER_DEF PATH_DEF
 
-#define REGEX_URL_AS_IS DEFS SCHEME "://" USERPASS URL_HOST PORT URLPATH
+#define URL_AS_IS SCHEME "://" USERPASS URL_HOST PORT URLPATH
 /* TODO: also support file:/etc/passwd */
-#define REGEX_URL_FILE DEFS "(?ix: file:/ (?: / (?: " HOSTNAME1 " )? / )? (?! / ) )(?&PATH)"
+#define URL_FILE "(?ix: file:/ (?: / (?: " HOSTNAME1 " )? / )? (?! / ) )(?&PATH)"
 /* Lookbehind so that we don't catch "abc.www.foo.bar", bug 739757. Lookahead for www/ftp for convenience (so that we can reuse HOSTNAME1). */
-#define REGEX_URL_HTTP DEFS "(?<!(?:" HOSTNAMESEGMENTCHARS_CLASS "|[.]))(?=(?i:www|ftp))" HOSTNAME1 PORT URLPATH
-#define REGEX_URL_VOIP DEFS "(?i:h323:|sips?:)" USERPASS URL_HOST PORT VOIP_PATH
-#define REGEX_EMAIL DEFS "(?i:mailto:)?" USER "@" EMAIL_HOST
-#define REGEX_NEWS_MAN "(?i:news:|man:|info:|magnet:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+"
+#define URL_HTTP "(?<!(?:" HOSTNAMESEGMENTCHARS_CLASS "|[.]))(?=(?i:www|ftp))" HOSTNAME1 PORT URLPATH
+#define URL_VOIP "(?i:h323:|sips?:)" USERPASS URL_HOST PORT VOIP_PATH
+/* Lookbehind so that an address is only tried from the start of its username. Without it, every
+   position of a long run of username characters is tried, each one up to the end of the run. */
+#define EMAIL "(?<![" USERCHARS "])(?i:mailto:)?" USER "@" EMAIL_HOST
+#define NEWS_MAN "(?i:news:|man:|info:|magnet:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+"
+
+#define REGEX_URL_AS_IS DEFS URL_AS_IS
+#define REGEX_URL_FILE DEFS URL_FILE
+#define REGEX_URL_HTTP DEFS URL_HTTP
+#define REGEX_URL_VOIP DEFS URL_VOIP
+#define REGEX_EMAIL DEFS EMAIL
+#define REGEX_NEWS_MAN NEWS_MAN
+
+/* Upper bounds on the backtracking of a single match attempt, so that a pathological line gives up
+   within a few milliseconds instead of stalling the UI while the pointer hovers it, see
+   tests/regex-bench. Links of thousands of characters stay well below them. The match limit also
+   holds for jitted patterns, the recursion limit (called depth limit since PCRE2 10.30) only for
+   the interpreter. */
+#define REGEX_MATCH_LIMIT 5000
+#define REGEX_RECURSION_LIMIT 10000
+
+#define REGEX_STRINGIFY(x) REGEX_STRINGIFY_ARG (x)
+#define REGEX_STRINGIFY_ARG(x) #x
+
+/* The limits for the matcher handed to vte, which takes no match context. They have to come first
+   in the pattern, and can only lower the library defaults. */
+#define REGEX_LIMITS "(*LIMIT_MATCH=" REGEX_STRINGIFY (REGEX_MATCH_LIMIT) ")(*LIMIT_RECURSION=" REGEX_STRINGIFY (REGEX_RECURSION_LIMIT) ")"
+
+/* The highlighted patterns as alternatives of one regex, so that a line is only scanned once.
+   The leftmost match wins, whichever alternative it is, so e.g. all of "joe@www.example.com" is
+   one e-mail link. The named group that took part in the match tells which kind of link it is.
+   Not in free-spacing mode, because the fragments above do not all use it. */
+#define REGEX_URL_ANY DEFS "(?:(?<URL_AS_IS>" URL_AS_IS ")|(?<URL_HTTP>" URL_HTTP ")|(?<URL_FILE>" URL_FILE ")|(?<EMAIL>" EMAIL ")|(?<NEWS_MAN>" NEWS_MAN "))"
+
+/* The same, but only matching all of a link found by it, to learn its kind from the text alone */
+#define REGEX_URL_ANY_WHOLE REGEX_URL_ANY "\\z"
 
 #endif /* !TERMINAL_REGEX_H */
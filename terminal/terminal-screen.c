@@ -19,6 +19,10 @@
 
 #include <stdlib.h>
 #include <sys/wait.h>
+#include <termios.h>
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
 #ifdef HAVE_MEMORY_H
 #include <memory.h>
 #endif
@@ -41,15 +45,19 @@
 #include <signal.h>
 #endif
 
+#include <glib-unix.h>
 #include <glib/gstdio.h>
 #include <libxfce4ui/libxfce4ui.h>
 #include <xfconf/xfconf.h>
 
 #include "terminal-enum-types.h"
+#include "terminal-export.h"
 #include "terminal-image-loader.h"
+#include "terminal-log.h"
 #include "terminal-marshal.h"
 #include "terminal-private.h"
 #include "terminal-screen.h"
+#include "terminal-search.h"
 #include "terminal-util.h"
 #include "terminal-widget.h"
 #include "terminal-window-dropdown.h"
@@ -65,6 +73,25 @@
 #define MIN_COLUMNS 4
 #define MIN_ROWS 1
 
+/* rows of the scrollback, or bytes of the selection, written at once
+ * when saving the contents */
+#define SAVE_CONTENTS_ROWS 2000
+#define SAVE_CONTENTS_SIZE (64 * 1024)
+
+/* bytes fed to the terminal at once when replaying saved contents */
+#define REPLAY_CONTENTS_SIZE (64 * 1024)
+
+/* pastes larger than this are streamed to the child, in chunks of
+ * PASTE_CHUNK_SIZE and at most PASTE_STREAM_SIZE per main loop iteration,
+ * and only PASTE_PREVIEW_SIZE of them is shown in the unsafe paste dialog */
+#define PASTE_STREAM_SIZE (64 * 1024)
+#define PASTE_CHUNK_SIZE (4 * 1024)
+#define PASTE_PREVIEW_SIZE (16 * 1024)
+
+/* target info of the clipboard contents, see terminal_screen_copy_clipboard_format() */
+#define CLIPBOARD_TARGET_TEXT 0
+#define CLIPBOARD_TARGET_HTML 1
+
 
 
 enum
@@ -101,8 +128,35 @@ typedef enum
   DISABLE_PASTE_DIALOG_N
 } DisablePasteDialog;
 
+typedef enum
+{
+  UPDATE_BACKGROUND = 1 << 0,
+  UPDATE_BINDING_BACKSPACE = 1 << 1,
+  UPDATE_BINDING_DELETE = 1 << 2,
+  UPDATE_BINDING_AMBIGUOUS_WIDTH = 1 << 3,
+  UPDATE_FONT = 1 << 4,
+  UPDATE_COLORS = 1 << 5,
+  UPDATE_MISC_BELL = 1 << 6,
+  UPDATE_MISC_CURSOR_BLINKS = 1 << 7,
+  UPDATE_MISC_CURSOR_SHAPE = 1 << 8,
+  UPDATE_MISC_MOUSE_AUTOHIDE = 1 << 9,
+  UPDATE_MISC_REWRAP_ON_RESIZE = 1 << 10,
+  UPDATE_SCROLLING_BAR = 1 << 11,
+  UPDATE_SCROLLING_LINES = 1 << 12,
+  UPDATE_SCROLLING_ON_OUTPUT = 1 << 13,
+  UPDATE_SCROLLING_ON_KEYSTROKE = 1 << 14,
+  UPDATE_KINETIC_SCROLLING = 1 << 15,
+  UPDATE_TEXT_BLINK_MODE = 1 << 16,
+  UPDATE_TITLE = 1 << 17,
+  UPDATE_WORD_CHARS = 1 << 18,
+  UPDATE_LABEL_ORIENTATION = 1 << 19,
+  UPDATE_SIXEL = 1 << 20
+} ScreenUpdate;
+
 
 
+static void
+terminal_screen_dispose (GObject *object);
 static void
 terminal_screen_finalize (GObject *object);
 static void
@@ -121,15 +175,13 @@ static void
 terminal_screen_unrealize (GtkWidget *widget);
 static void
 terminal_screen_style_updated (GtkWidget *widget);
-static gboolean
-terminal_screen_draw (GtkWidget *widget,
-                      cairo_t *cr,
-                      gpointer user_data);
 static void
 terminal_screen_preferences_changed (TerminalPreferences *preferences,
                                      GParamSpec *pspec,
                                      TerminalScreen *screen);
 static gboolean
+terminal_screen_flush_updates (gpointer user_data);
+static gboolean
 terminal_screen_get_child_command (TerminalScreen *screen,
                                    gchar **command,
                                    gchar ***argv,
@@ -218,8 +270,72 @@ static void
 terminal_screen_paste_unsafe_text (TerminalScreen *screen,
                                    const gchar *text,
                                    GdkAtom original_clipboard);
+#if VTE_CHECK_VERSION(0, 68, 0)
+static void
+terminal_screen_paste_text (TerminalScreen *screen,
+                            const gchar *text);
+static void
+terminal_screen_paste_filter (GString *filtered,
+                              const gchar *text,
+                              gsize length);
+static gboolean
+terminal_screen_paste_next_chunk (TerminalScreen *screen);
+static gboolean
+terminal_screen_paste_write (gint fd,
+                             GIOCondition condition,
+                             gpointer user_data);
+static void
+terminal_screen_paste_bar_response (GtkInfoBar *info_bar,
+                                    gint response_id,
+                                    TerminalScreen *screen);
+static void
+terminal_screen_paste_stop (TerminalScreen *screen);
+#endif
 static void
 terminal_screen_update_sixel (TerminalScreen *screen);
+static gint
+terminal_screen_get_child_fd (TerminalScreen *screen);
+#if VTE_CHECK_VERSION(0, 72, 0)
+static void
+terminal_screen_copy_clipboard_format (TerminalScreen *screen,
+                                       gboolean html);
+static void
+terminal_screen_clipboard_get (GtkClipboard *clipboard,
+                               GtkSelectionData *selection_data,
+                               guint info,
+                               gpointer owner);
+static void
+terminal_screen_clipboard_clear (GtkClipboard *clipboard,
+                                 gpointer owner);
+#endif
+static GCancellable *
+terminal_screen_task_cancellable_add (TerminalScreen *screen,
+                                      GCancellable *cancellable);
+static void
+terminal_screen_task_cancellable_remove (TerminalScreen *screen,
+                                         GCancellable *cancellable);
+static void
+terminal_screen_save_contents_data_free (gpointer data);
+static void
+terminal_screen_save_contents_next (GTask *task);
+static void
+terminal_screen_save_contents_written (GObject *object,
+                                       GAsyncResult *result,
+                                       gpointer user_data);
+static void
+terminal_screen_save_contents_closed (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data);
+static void
+terminal_screen_replay_contents_data_free (gpointer data);
+static void
+terminal_screen_replay_contents_filled (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data);
+static void
+terminal_screen_replay_contents_read (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data);
 
 
 
@@ -228,6 +344,8 @@ struct _TerminalScreen
   GtkOverlay parent_instance;
   TerminalPreferences *preferences;
   TerminalImageLoader *loader;
+  TerminalSearch *search;
+  TerminalLog *log;
   GtkWidget *swin;
   GtkWidget *terminal;
   GtkWidget *scrollbar;
@@ -241,6 +359,9 @@ struct _TerminalScreen
   gchar *working_directory;
   GCancellable *cancellable;
 
+  /* of the running tasks, cancelled when the screen is destroyed */
+  GSList *task_cancellables;
+
   gchar **custom_command;
   gchar *custom_title;
   gchar *initial_title;
@@ -249,6 +370,25 @@ struct _TerminalScreen
   gchar *custom_bg_color;
   gchar *custom_title_color;
 
+  /* from --log, the preferences may also enable logging */
+  gchar *log_file;
+
+  /* the text of the selection we own the clipboard with, the HTML is
+   * only generated when asked for and while the selection is unchanged */
+  gchar *clipboard_text;
+  guint clipboard_serial;
+  guint selection_serial;
+
+  /* the paste being streamed to the child, see terminal_screen_paste_text() */
+  gchar *paste_text;
+  gsize paste_length;
+  gsize paste_offset;
+  guint paste_watch_id;
+  GString *paste_chunk;
+  guint paste_bracketed : 1;
+  GtkWidget *paste_bar;
+  GtkWidget *paste_progress;
+
   TerminalTitle dynamic_title_mode;
   guint hold : 1;
   guint has_random_bg_color : 1;
@@ -257,6 +397,10 @@ struct _TerminalScreen
   guint activity_timeout_id;
   time_t activity_resize_time;
 
+  /* coalesced preference updates, see terminal_screen_flush_updates() */
+  guint pending_updates;
+  guint pending_updates_id;
+
   GdkGeometry hints;
 };
 
@@ -266,6 +410,57 @@ typedef struct
   gchar *string;
 } DisablePasteDialogEntry;
 
+typedef struct
+{
+  const gchar *name;
+  gboolean is_prefix;
+  ScreenUpdate update;
+} ScreenUpdateProperty;
+
+typedef struct
+{
+  ScreenUpdate update;
+  void (*func) (TerminalScreen *screen);
+} ScreenUpdateFunc;
+
+typedef struct
+{
+  TerminalScreen *screen;
+  GCancellable *cancellable;
+
+  /* weak, gone with the screen */
+  VteTerminal *terminal;
+
+  GOutputStream *stream;
+  VteFormat format;
+
+  /* rows still to write, the chunk being written */
+  glong first_row;
+  glong next_row;
+  glong end_row;
+  gchar *text;
+
+  /* the selection, taken at once but written in chunks as well */
+  gchar *selection;
+  gsize selection_length;
+  gsize selection_offset;
+
+  GFileProgressCallback progress_callback;
+  gpointer progress_data;
+} SaveContentsData;
+
+typedef struct
+{
+  TerminalScreen *screen;
+  GCancellable *cancellable;
+
+  /* weak, gone with the screen */
+  VteTerminal *terminal;
+
+  /* the replayed contents, once the compression is known */
+  GInputStream *stream;
+} ReplayContentsData;
+
 
 
 static guint screen_signals[LAST_SIGNAL];
@@ -280,12 +475,108 @@ static DisablePasteDialogEntry disable_unsafe_past_dialog_texts[] = {
   { DISABLE_PASTE_DIALOG_PERMANENT, N_ ("Disable dialog (can be re-enabled in the Preferences)") }
 };
 
+/* preferences that require an update of the screen */
+static const ScreenUpdateProperty screen_update_properties[] = {
+  { "background-", TRUE, UPDATE_BACKGROUND },
+  { "binding-backspace", FALSE, UPDATE_BINDING_BACKSPACE },
+  { "binding-delete", FALSE, UPDATE_BINDING_DELETE },
+  { "binding-ambiguous-width", FALSE, UPDATE_BINDING_AMBIGUOUS_WIDTH },
+  { "cell-width-scale", FALSE, UPDATE_FONT },
+  { "cell-height-scale", FALSE, UPDATE_FONT },
+  { "color-", TRUE, UPDATE_COLORS },
+  { "font-", TRUE, UPDATE_FONT },
+  { "misc-bell", TRUE, UPDATE_MISC_BELL },
+  { "misc-cursor-blinks", FALSE, UPDATE_MISC_CURSOR_BLINKS },
+  { "misc-cursor-shape", FALSE, UPDATE_MISC_CURSOR_SHAPE },
+  { "misc-mouse-autohide", FALSE, UPDATE_MISC_MOUSE_AUTOHIDE },
+  { "misc-rewrap-on-resize", FALSE, UPDATE_MISC_REWRAP_ON_RESIZE },
+  { "scrolling-bar", FALSE, UPDATE_SCROLLING_BAR },
+  { "overlay-scrolling", FALSE, UPDATE_SCROLLING_BAR },
+  { "scrolling-lines", FALSE, UPDATE_SCROLLING_LINES },
+  { "scrolling-unlimited", FALSE, UPDATE_SCROLLING_LINES },
+  { "scrolling-on-output", FALSE, UPDATE_SCROLLING_ON_OUTPUT },
+  { "scrolling-on-keystroke", FALSE, UPDATE_SCROLLING_ON_KEYSTROKE },
+  { "kinetic-scrolling", FALSE, UPDATE_KINETIC_SCROLLING },
+  { "text-blink-mode", FALSE, UPDATE_TEXT_BLINK_MODE },
+  { "title-", TRUE, UPDATE_TITLE },
+  { "word-chars", FALSE, UPDATE_WORD_CHARS },
+  { "misc-tab-position", FALSE, UPDATE_LABEL_ORIENTATION },
+  { "enable-sixel", FALSE, UPDATE_SIXEL },
+};
+
+/* update functions, in the order they are applied */
+static const ScreenUpdateFunc screen_update_funcs[] = {
+  { UPDATE_BACKGROUND, terminal_screen_update_background },
+  { UPDATE_BINDING_BACKSPACE, terminal_screen_update_binding_backspace },
+  { UPDATE_BINDING_DELETE, terminal_screen_update_binding_delete },
+  { UPDATE_BINDING_AMBIGUOUS_WIDTH, terminal_screen_update_binding_ambiguous_width },
+  { UPDATE_FONT, terminal_screen_update_font },
+  { UPDATE_COLORS, terminal_screen_update_colors },
+  { UPDATE_MISC_BELL, terminal_screen_update_misc_bell },
+  { UPDATE_MISC_CURSOR_BLINKS, terminal_screen_update_misc_cursor_blinks },
+  { UPDATE_MISC_CURSOR_SHAPE, terminal_screen_update_misc_cursor_shape },
+  { UPDATE_MISC_MOUSE_AUTOHIDE, terminal_screen_update_misc_mouse_autohide },
+  { UPDATE_MISC_REWRAP_ON_RESIZE, terminal_screen_update_misc_rewrap_on_resize },
+  { UPDATE_SCROLLING_BAR, terminal_screen_update_scrolling_bar },
+  { UPDATE_SCROLLING_LINES, terminal_screen_update_scrolling_lines },
+  { UPDATE_SCROLLING_ON_OUTPUT, terminal_screen_update_scrolling_on_output },
+  { UPDATE_SCROLLING_ON_KEYSTROKE, terminal_screen_update_scrolling_on_keystroke },
+  { UPDATE_KINETIC_SCROLLING, terminal_screen_update_kinetic_scrolling },
+  { UPDATE_TEXT_BLINK_MODE, terminal_screen_update_text_blink_mode },
+  { UPDATE_TITLE, terminal_screen_update_title },
+  { UPDATE_WORD_CHARS, terminal_screen_update_word_chars },
+  { UPDATE_LABEL_ORIENTATION, terminal_screen_update_label_orientation },
+  { UPDATE_SIXEL, terminal_screen_update_sixel },
+};
+
+/* screen updates indexed by the TerminalPreferences property id */
+static guint *screen_updates_by_prop_id = NULL;
+static guint screen_updates_n_props = 0;
+
 
 
 G_DEFINE_TYPE (TerminalScreen, terminal_screen, GTK_TYPE_OVERLAY)
 
 
 
+static void
+terminal_screen_build_update_table (void)
+{
+  GObjectClass *klass;
+  GParamSpec **pspecs;
+  const gchar *name;
+  guint n_pspecs;
+  guint n, i;
+
+  klass = g_type_class_ref (TERMINAL_TYPE_PREFERENCES);
+  pspecs = g_object_class_list_properties (klass, &n_pspecs);
+
+  for (n = 0; n < n_pspecs; n++)
+    screen_updates_n_props = MAX (screen_updates_n_props, pspecs[n]->param_id + 1);
+  screen_updates_by_prop_id = g_new0 (guint, screen_updates_n_props);
+
+  /* match each property once, so notifications only need an array lookup */
+  for (n = 0; n < n_pspecs; n++)
+    {
+      name = g_param_spec_get_name (pspecs[n]);
+      for (i = 0; i < G_N_ELEMENTS (screen_update_properties); i++)
+        {
+          if (screen_update_properties[i].is_prefix
+                ? g_str_has_prefix (name, screen_update_properties[i].name)
+                : strcmp (name, screen_update_properties[i].name) == 0)
+            {
+              screen_updates_by_prop_id[pspecs[n]->param_id] = screen_update_properties[i].update;
+              break;
+            }
+        }
+    }
+
+  g_free (pspecs);
+  g_type_class_unref (klass);
+}
+
+
+
 static void
 terminal_screen_class_init (TerminalScreenClass *klass)
 {
@@ -293,6 +584,7 @@ terminal_screen_class_init (TerminalScreenClass *klass)
   GObjectClass *gobject_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = terminal_screen_dispose;
   gobject_class->finalize = terminal_screen_finalize;
   gobject_class->get_property = terminal_screen_get_property;
   gobject_class->set_property = terminal_screen_set_property;
@@ -302,6 +594,9 @@ terminal_screen_class_init (TerminalScreenClass *klass)
   gtkwidget_class->unrealize = terminal_screen_unrealize;
   gtkwidget_class->style_updated = terminal_screen_style_updated;
 
+  /* build the preference dispatch table */
+  terminal_screen_build_update_table ();
+
   /**
    * TerminalScreen:custom-title:
    **/
@@ -390,8 +685,15 @@ terminal_screen_init (TerminalScreen *screen)
   g_signal_connect_swapped (G_OBJECT (screen->terminal), "paste-clipboard-request",
                             G_CALLBACK (terminal_screen_paste_clipboard), screen);
 
+  /* highlights the matches of the search dialog */
+  screen->search = terminal_search_new (VTE_TERMINAL (screen->terminal));
+
   screen->preferences = terminal_preferences_get ();
 
+  g_object_bind_property (G_OBJECT (screen->preferences), "misc-search-index",
+                          G_OBJECT (screen->search), "indexed",
+                          G_BINDING_SYNC_CREATE);
+
   g_object_get (G_OBJECT (screen->preferences), "scrolling-bar", &scrollbar, NULL);
 
   screen->swin = gtk_scrolled_window_new (gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (screen->terminal)), gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal)));
@@ -443,6 +745,36 @@ terminal_screen_init (TerminalScreen *screen)
 
 
 
+static void
+terminal_screen_dispose (GObject *object)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (object);
+  GtkClipboard *clipboard;
+
+  /* the tasks must not touch the terminal once it is destroyed */
+  g_cancellable_cancel (screen->cancellable);
+  g_slist_foreach (screen->task_cancellables, (GFunc) g_cancellable_cancel, NULL);
+
+  /* the progress bar of the paste is gone with the children */
+  if (screen->paste_watch_id != 0)
+    {
+      g_source_remove (screen->paste_watch_id);
+      screen->paste_watch_id = 0;
+    }
+
+  /* leave a copy of the text on the clipboard, so it outlives the tab */
+  if (screen->clipboard_text != NULL)
+    {
+      clipboard = gtk_widget_get_clipboard (GTK_WIDGET (screen), GDK_SELECTION_CLIPBOARD);
+      if (gtk_clipboard_get_owner (clipboard) == object)
+        gtk_clipboard_set_text (clipboard, screen->clipboard_text, -1);
+    }
+
+  (*G_OBJECT_CLASS (terminal_screen_parent_class)->dispose) (object);
+}
+
+
+
 static void
 terminal_screen_finalize (GObject *object)
 {
@@ -452,6 +784,8 @@ terminal_screen_finalize (GObject *object)
     g_source_remove (screen->activity_timeout_id);
   if (screen->contents_changed_id != 0)
     g_source_remove (screen->contents_changed_id);
+  if (screen->pending_updates_id != 0)
+    g_source_remove (screen->pending_updates_id);
 
   /* detach from preferences */
   g_signal_handlers_disconnect_by_func (screen->preferences,
@@ -461,6 +795,11 @@ terminal_screen_finalize (GObject *object)
   if (screen->loader != NULL)
     g_object_unref (G_OBJECT (screen->loader));
 
+  g_object_unref (G_OBJECT (screen->search));
+
+  if (screen->log != NULL)
+    g_object_unref (G_OBJECT (screen->log));
+
   g_cancellable_cancel (screen->cancellable);
   g_object_unref (screen->cancellable);
 
@@ -471,6 +810,11 @@ terminal_screen_finalize (GObject *object)
   g_free (screen->custom_fg_color);
   g_free (screen->custom_bg_color);
   g_free (screen->custom_title_color);
+  g_free (screen->log_file);
+  g_free (screen->clipboard_text);
+  g_free (screen->paste_text);
+  if (screen->paste_chunk != NULL)
+    g_string_free (screen->paste_chunk, TRUE);
 
   (*G_OBJECT_CLASS (terminal_screen_parent_class)->finalize) (object);
 }
@@ -611,122 +955,49 @@ terminal_screen_style_updated (GtkWidget *widget)
 
 
 
-static gboolean
-terminal_screen_draw (GtkWidget *widget,
-                      cairo_t *cr,
-                      gpointer user_data)
+static void
+terminal_screen_preferences_changed (TerminalPreferences *preferences,
+                                     GParamSpec *pspec,
+                                     TerminalScreen *screen)
 {
-  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
-  GdkPixbuf *image;
-  gint width, height;
-  cairo_surface_t *surface;
-  cairo_t *ctx;
-  gint scale_factor;
-
-  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-  g_return_val_if_fail (VTE_IS_TERMINAL (screen->terminal), FALSE);
-
-  scale_factor = gtk_widget_get_scale_factor (widget);
-  width = scale_factor * gtk_widget_get_allocated_width (screen->terminal);
-  height = scale_factor * gtk_widget_get_allocated_height (screen->terminal);
-
-  image = terminal_image_loader_load (screen->loader, width, height);
-  if (G_UNLIKELY (image == NULL))
-    return FALSE;
-
-  g_signal_handlers_disconnect_by_func (G_OBJECT (screen->terminal),
-                                        G_CALLBACK (terminal_screen_draw), screen);
+  guint update;
 
-  cairo_save (cr);
-
-  /* draw background image; cairo_set_operator() allows PNG transparency */
-  gdk_cairo_set_source_pixbuf (cr, image, 0, 0);
-  cairo_pattern_get_surface (cairo_get_source (cr), &surface);
-  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
-  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-  cairo_paint (cr);
-  g_object_unref (G_OBJECT (image));
-
-  /* draw vte terminal */
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
-  ctx = cairo_create (surface);
-  gtk_widget_draw (screen->terminal, ctx);
-  cairo_set_source_surface (cr, surface, 0, 0);
-  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-  cairo_paint (cr);
-  cairo_destroy (ctx);
-  cairo_surface_destroy (surface);
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  g_return_if_fail (TERMINAL_IS_PREFERENCES (preferences));
+  g_return_if_fail (screen->preferences == preferences);
 
-  cairo_restore (cr);
+  if (G_UNLIKELY (pspec->param_id >= screen_updates_n_props))
+    return;
 
-  g_signal_connect (G_OBJECT (screen->terminal), "draw",
-                    G_CALLBACK (terminal_screen_draw), screen);
+  update = screen_updates_by_prop_id[pspec->param_id];
+  if (update == 0)
+    return;
 
-  return TRUE;
+  /* collect the updates, so changing many properties at once (e.g. a color
+   * preset) only updates the screen once */
+  screen->pending_updates |= update;
+  if (screen->pending_updates_id == 0)
+    screen->pending_updates_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE, terminal_screen_flush_updates, screen, NULL);
 }
 
 
 
-static void
-terminal_screen_preferences_changed (TerminalPreferences *preferences,
-                                     GParamSpec *pspec,
-                                     TerminalScreen *screen)
+static gboolean
+terminal_screen_flush_updates (gpointer user_data)
 {
-  const gchar *name;
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  guint pending;
+  guint i;
 
-  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  g_return_if_fail (TERMINAL_IS_PREFERENCES (preferences));
-  g_return_if_fail (screen->preferences == preferences);
+  pending = screen->pending_updates;
+  screen->pending_updates = 0;
+  screen->pending_updates_id = 0;
 
-  /* get name */
-  name = g_param_spec_get_name (pspec);
-  g_assert (name != NULL);
-
-  if (strncmp ("background-", name, strlen ("background-")) == 0)
-    terminal_screen_update_background (screen);
-  else if (strcmp ("binding-backspace", name) == 0)
-    terminal_screen_update_binding_backspace (screen);
-  else if (strcmp ("binding-delete", name) == 0)
-    terminal_screen_update_binding_delete (screen);
-  else if (strcmp ("binding-ambiguous-width", name) == 0)
-    terminal_screen_update_binding_ambiguous_width (screen);
-  else if (strcmp ("cell-width-scale", name) == 0 || strcmp ("cell-height-scale", name) == 0)
-    terminal_screen_update_font (screen);
-  else if (strncmp ("color-", name, strlen ("color-")) == 0)
-    terminal_screen_update_colors (screen);
-  else if (strncmp ("font-", name, strlen ("font-")) == 0)
-    terminal_screen_update_font (screen);
-  else if (strncmp ("misc-bell", name, strlen ("misc-bell")) == 0)
-    terminal_screen_update_misc_bell (screen);
-  else if (strcmp ("misc-cursor-blinks", name) == 0)
-    terminal_screen_update_misc_cursor_blinks (screen);
-  else if (strcmp ("misc-cursor-shape", name) == 0)
-    terminal_screen_update_misc_cursor_shape (screen);
-  else if (strcmp ("misc-mouse-autohide", name) == 0)
-    terminal_screen_update_misc_mouse_autohide (screen);
-  else if (strcmp ("misc-rewrap-on-resize", name) == 0)
-    terminal_screen_update_misc_rewrap_on_resize (screen);
-  else if (strcmp ("scrolling-bar", name) == 0 || strcmp ("overlay-scrolling", name) == 0)
-    terminal_screen_update_scrolling_bar (screen);
-  else if (strcmp ("scrolling-lines", name) == 0 || strcmp ("scrolling-unlimited", name) == 0)
-    terminal_screen_update_scrolling_lines (screen);
-  else if (strcmp ("scrolling-on-output", name) == 0)
-    terminal_screen_update_scrolling_on_output (screen);
-  else if (strcmp ("scrolling-on-keystroke", name) == 0)
-    terminal_screen_update_scrolling_on_keystroke (screen);
-  else if (strcmp ("kinetic-scrolling", name) == 0)
-    terminal_screen_update_kinetic_scrolling (screen);
-  else if (strcmp ("text-blink-mode", name) == 0)
-    terminal_screen_update_text_blink_mode (screen);
-  else if (strncmp ("title-", name, strlen ("title-")) == 0)
-    terminal_screen_update_title (screen);
-  else if (strcmp ("word-chars", name) == 0)
-    terminal_screen_update_word_chars (screen);
-  else if (strcmp ("misc-tab-position", name) == 0)
-    terminal_screen_update_label_orientation (screen);
-  else if (strcmp ("enable-sixel", name) == 0)
-    terminal_screen_update_sixel (screen);
+  for (i = 0; i < G_N_ELEMENTS (screen_update_funcs); i++)
+    if ((pending & screen_update_funcs[i].update) != 0)
+      (*screen_update_funcs[i].func) (screen);
+
+  return FALSE;
 }
 
 
@@ -1028,11 +1299,7 @@ terminal_screen_update_background (TerminalScreen *screen)
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
   g_return_if_fail (VTE_IS_TERMINAL (screen->terminal));
 
-  if (screen->loader != NULL)
-    {
-      g_signal_handlers_disconnect_by_func (screen->terminal, terminal_screen_draw, screen);
-      g_clear_object (&screen->loader);
-    }
+  g_clear_object (&screen->loader);
 
   g_object_get (G_OBJECT (screen->preferences), "background-mode", &background_mode, NULL);
 
@@ -1041,7 +1308,6 @@ terminal_screen_update_background (TerminalScreen *screen)
   else if (G_UNLIKELY (background_mode == TERMINAL_BACKGROUND_IMAGE))
     {
       screen->loader = terminal_image_loader_get ();
-      g_signal_connect (G_OBJECT (screen->terminal), "draw", G_CALLBACK (terminal_screen_draw), screen);
       g_object_get (G_OBJECT (screen->preferences), "background-image-shading", &background_alpha, NULL);
     }
   else
@@ -1049,6 +1315,7 @@ terminal_screen_update_background (TerminalScreen *screen)
 
   screen->background_color.alpha = background_alpha;
   vte_terminal_set_color_background (VTE_TERMINAL (screen->terminal), &screen->background_color);
+  terminal_widget_set_background (TERMINAL_WIDGET (screen->terminal), screen->loader, &screen->background_color);
 
   gtk_widget_queue_draw (GTK_WIDGET (screen));
 }
@@ -1135,60 +1402,24 @@ terminal_screen_update_encoding (TerminalScreen *screen)
 static void
 terminal_screen_update_colors (TerminalScreen *screen)
 {
-  GdkRGBA palette[16];
+  const TerminalColorSet *colors;
   GdkRGBA bg;
   GdkRGBA fg;
-  GdkRGBA cursor;
-  GdkRGBA selection;
-  GdkRGBA bold;
-  gboolean cursor_use_default;
-  gboolean selection_use_default;
-  gboolean bold_use_default;
-  guint n = 0;
   gboolean has_bg;
   gboolean has_fg;
-  gboolean valid_palette = FALSE;
-  gchar *palette_str;
-  gchar **colors;
-  gboolean vary_bg;
   gdouble hsv[N_HSV];
   gdouble sat_min, sat_max;
-  gboolean bold_is_bright;
-  gboolean use_theme;
 
   GtkStyleContext *context = gtk_widget_get_style_context (gtk_widget_get_toplevel (GTK_WIDGET (screen)));
 
-  g_object_get (screen->preferences,
-                "color-palette", &palette_str,
-                "color-cursor-use-default", &cursor_use_default,
-                "color-selection-use-default", &selection_use_default,
-                "color-bold-use-default", &bold_use_default,
-                "color-background-vary", &vary_bg,
-                "color-bold-is-bright", &bold_is_bright,
-                "color-use-theme", &use_theme,
-                NULL);
-
-  if (G_LIKELY (palette_str != NULL))
-    {
-      colors = g_strsplit (palette_str, ";", -1);
-      g_free (palette_str);
-
-      if (colors != NULL)
-        for (; n < 16 && colors[n] != NULL; n++)
-          if (!gdk_rgba_parse (palette + n, colors[n]))
-            {
-              g_warning ("Unable to parse color \"%s\".", colors[n]);
-              break;
-            }
-
-      g_strfreev (colors);
-      valid_palette = (n == 16);
-    }
+  /* parsed once by the preferences and shared by all screens */
+  colors = terminal_preferences_get_colors (screen->preferences);
 
   if (G_LIKELY (screen->custom_fg_color == NULL))
     {
-      has_fg = terminal_preferences_get_color (screen->preferences, "color-foreground", &fg);
-      if (use_theme || !has_fg)
+      has_fg = colors->has_foreground;
+      fg = colors->foreground;
+      if (colors->use_theme || !has_fg)
         {
           gtk_style_context_get_color (context, GTK_STATE_FLAG_ACTIVE, &fg);
           has_fg = TRUE;
@@ -1199,15 +1430,16 @@ terminal_screen_update_colors (TerminalScreen *screen)
 
   if (G_LIKELY (screen->custom_bg_color == NULL))
     {
-      has_bg = terminal_preferences_get_color (screen->preferences, "color-background", &bg);
-      if (use_theme || !has_bg)
+      has_bg = colors->has_background;
+      bg = colors->background;
+      if (colors->use_theme || !has_bg)
         {
           gtk_style_context_get_background_color (context, GTK_STATE_FLAG_ACTIVE, &bg);
           has_bg = TRUE;
         }
 
       /* we pick a random hue value to keep readability */
-      if (vary_bg && !screen->has_random_bg_color)
+      if (colors->background_vary && !screen->has_random_bg_color)
         {
           gtk_rgb_to_hsv (bg.red, bg.green, bg.blue,
                           NULL, &hsv[HSV_SATURATION], &hsv[HSV_VALUE]);
@@ -1248,11 +1480,11 @@ terminal_screen_update_colors (TerminalScreen *screen)
           if (bg.red != 0 && bg.green != 0 && bg.blue != 0)
             screen->has_random_bg_color = 1;
         }
-      else if (vary_bg && screen->has_random_bg_color)
+      else if (colors->background_vary && screen->has_random_bg_color)
         {
           /* we already have a random bg color - do nothing */
         }
-      else if (!vary_bg)
+      else if (!colors->background_vary)
         {
           /* update the color if the vary setting is unchecked */
           screen->background_color.red = bg.red;
@@ -1269,12 +1501,16 @@ terminal_screen_update_colors (TerminalScreen *screen)
       screen->background_color.blue = bg.blue;
     }
 
-  if (G_LIKELY (valid_palette))
+  if (G_LIKELY (colors->has_palette))
     {
       vte_terminal_set_colors (VTE_TERMINAL (screen->terminal),
                                has_fg ? &fg : NULL,
                                has_bg ? &screen->background_color : NULL,
-                               palette, 16);
+                               colors->palette, 16);
+
+      /* the image background is shaded with the same color */
+      if (screen->loader != NULL)
+        terminal_widget_set_background (TERMINAL_WIDGET (screen->terminal), screen->loader, &screen->background_color);
     }
   else
     {
@@ -1284,37 +1520,37 @@ terminal_screen_update_colors (TerminalScreen *screen)
     }
 
   /* cursor color */
-  if (!cursor_use_default)
+  if (!colors->cursor_use_default)
     {
-      cursor_use_default = !terminal_preferences_get_color (screen->preferences, "color-cursor-foreground", &cursor);
-      vte_terminal_set_color_cursor_foreground (VTE_TERMINAL (screen->terminal), cursor_use_default ? NULL : &cursor);
-      cursor_use_default = !terminal_preferences_get_color (screen->preferences, "color-cursor", &cursor);
-      vte_terminal_set_color_cursor (VTE_TERMINAL (screen->terminal), cursor_use_default ? NULL : &cursor);
+      vte_terminal_set_color_cursor_foreground (VTE_TERMINAL (screen->terminal),
+                                                colors->has_cursor_foreground ? &colors->cursor_foreground : NULL);
+      vte_terminal_set_color_cursor (VTE_TERMINAL (screen->terminal),
+                                     colors->has_cursor ? &colors->cursor : NULL);
     }
 
   /* selection color */
-  if (!selection_use_default)
+  if (!colors->selection_use_default)
     {
-      selection_use_default = !terminal_preferences_get_color (screen->preferences, "color-selection", &selection);
-      vte_terminal_set_color_highlight_foreground (VTE_TERMINAL (screen->terminal), selection_use_default ? NULL : &selection);
-      selection_use_default = !terminal_preferences_get_color (screen->preferences, "color-selection-background", &selection);
-      vte_terminal_set_color_highlight (VTE_TERMINAL (screen->terminal), selection_use_default ? NULL : &selection);
+      vte_terminal_set_color_highlight_foreground (VTE_TERMINAL (screen->terminal),
+                                                   colors->has_selection ? &colors->selection : NULL);
+      vte_terminal_set_color_highlight (VTE_TERMINAL (screen->terminal),
+                                        colors->has_selection_background ? &colors->selection_background : NULL);
     }
 
   /* bold color */
-  if (!bold_use_default)
-    bold_use_default = !terminal_preferences_get_color (screen->preferences, "color-bold", &bold);
 #if VTE_CHECK_VERSION(0, 52, 0)
   /* the meaning of NULL for bold color changed in vte 0.52: see bug #15019 */
-  vte_terminal_set_color_bold (VTE_TERMINAL (screen->terminal), bold_use_default ? NULL : &bold);
+  vte_terminal_set_color_bold (VTE_TERMINAL (screen->terminal),
+                               !colors->bold_use_default && colors->has_bold ? &colors->bold : NULL);
 #else
   /* avoid computed bold color for older vte versions */
-  if (!bold_use_default || has_fg)
-    vte_terminal_set_color_bold (VTE_TERMINAL (screen->terminal), bold_use_default ? &fg : &bold);
+  if ((!colors->bold_use_default && colors->has_bold) || has_fg)
+    vte_terminal_set_color_bold (VTE_TERMINAL (screen->terminal),
+                                 !colors->bold_use_default && colors->has_bold ? &colors->bold : &fg);
 #endif
 
   /* "bold-is-bright" supported since vte 0.51.3 */
-  vte_terminal_set_bold_is_bright (VTE_TERMINAL (screen->terminal), bold_is_bright);
+  vte_terminal_set_bold_is_bright (VTE_TERMINAL (screen->terminal), colors->bold_is_bright);
 }
 
 
@@ -1610,6 +1846,9 @@ terminal_screen_vte_selection_changed (VteTerminal *terminal,
   g_return_if_fail (VTE_IS_TERMINAL (terminal));
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
+  /* tells the clipboard whether it can still generate the HTML */
+  screen->selection_serial++;
+
   /* copy vte selection to GDK_SELECTION_CLIPBOARD if option is set */
   g_object_get (G_OBJECT (screen->preferences),
                 "misc-copy-on-select", &copy_on_select, NULL);
@@ -1664,6 +1903,7 @@ static gboolean
 terminal_screen_reset_activity_timeout (gpointer user_data)
 {
   TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  const TerminalColorSet *colors;
   GdkRGBA active_color;
   GdkRGBA fg_color;
   GdkRGBA label_color;
@@ -1677,9 +1917,11 @@ terminal_screen_reset_activity_timeout (gpointer user_data)
   else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
     terminal_screen_set_tab_label_color (screen, &label_color);
 
-  if (terminal_preferences_get_color (screen->preferences, "tab-activity-color", &active_color))
+  colors = terminal_preferences_get_colors (screen->preferences);
+  if (colors->has_tab_activity)
     {
       /* calculate color between fg and active color */
+      active_color = colors->tab_activity;
       gtk_style_context_get_color (gtk_widget_get_style_context (screen->tab_label),
                                    gtk_widget_get_state_flags (screen->tab_label),
                                    &fg_color);
@@ -1707,10 +1949,9 @@ static gboolean
 contents_changed_idle (gpointer data)
 {
   TerminalScreen *screen = data;
+  const TerminalColorSet *colors;
   guint timeout;
-  GdkRGBA color;
   GdkRGBA label_color;
-  gboolean has_color;
 
   screen->contents_changed_id = 0;
 
@@ -1725,9 +1966,9 @@ contents_changed_idle (gpointer data)
     return FALSE;
 
   /* set label color */
-  has_color = terminal_preferences_get_color (screen->preferences, "tab-activity-color", &color);
-  if (G_LIKELY (has_color))
-    terminal_screen_set_tab_label_color (screen, &color);
+  colors = terminal_preferences_get_colors (screen->preferences);
+  if (G_LIKELY (colors->has_tab_activity))
+    terminal_screen_set_tab_label_color (screen, &colors->tab_activity);
   else if (G_LIKELY (screen->custom_title_color == NULL))
     gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
   else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
@@ -1775,6 +2016,12 @@ terminal_screen_vte_window_contents_resized (TerminalScreen *screen)
 {
   /* avoid a content changed when the window is resized */
   screen->activity_resize_time = time (NULL);
+
+  /* the child pty of a logged tab follows the terminal size */
+  if (screen->log != NULL)
+    terminal_log_set_size (screen->log,
+                           vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal)),
+                           vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal)));
 }
 
 
@@ -1896,6 +2143,13 @@ terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
   GtkWidget *box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 8);
   GtkWidget *button, *label;
   GtkWidget *combo;
+  const gchar *p;
+  const gchar *end;
+  gchar *size;
+  gchar *message;
+  gsize length = strlen (text);
+  gsize preview_length = length;
+  guint n_lines = 0;
   gint parent_w, parent_h;
 
   gtk_window_set_transient_for (GTK_WINDOW (dialog), parent);
@@ -1944,13 +2198,35 @@ terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
   gtk_container_add (GTK_CONTAINER (sw), tv);
   gtk_container_add (GTK_CONTAINER (box), sw);
 
+  for (p = text, end = text + length; p < end && (p = memchr (p, '\n', end - p)) != NULL; p++)
+    n_lines++;
+  if (length > 0 && text[length - 1] != '\n')
+    n_lines++;
+
+  /* large texts are only previewed, editing a part of them makes no sense */
+  size = g_format_size (length);
+  if (length > PASTE_PREVIEW_SIZE)
+    {
+      preview_length = g_utf8_find_prev_char (text, text + PASTE_PREVIEW_SIZE + 1) - text;
+      gtk_text_view_set_editable (GTK_TEXT_VIEW (tv), FALSE);
+      message = g_strdup_printf (_("Size: %s, lines: %u (only the beginning is shown)"), size, n_lines);
+    }
+  else
+    message = g_strdup_printf (_("Size: %s, lines: %u"), size, n_lines);
+  label = gtk_label_new (message);
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  gtk_widget_set_margin_start (label, 6);
+  gtk_container_add (GTK_CONTAINER (box), label);
+  g_free (message);
+  g_free (size);
+
   combo = gtk_combo_box_text_new ();
   for (gint i = 0; i < DISABLE_PASTE_DIALOG_N; i++)
     gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), _(disable_unsafe_past_dialog_texts[i].string));
   gtk_combo_box_set_active (GTK_COMBO_BOX (combo), 0);
   gtk_container_add (GTK_CONTAINER (box), combo);
 
-  gtk_text_buffer_set_text (buffer, text, -1);
+  gtk_text_buffer_set_text (buffer, text, preview_length);
 
   return dialog;
 }
@@ -2004,14 +2280,24 @@ terminal_screen_paste_unsafe_text (TerminalScreen *screen,
       sw = children->next->data;
       tv = GTK_TEXT_VIEW (gtk_bin_get_child (GTK_BIN (sw)));
       buffer = gtk_text_view_get_buffer (tv);
-      combo = children->next->next->data;
+      combo = children->next->next->next->data;
       g_list_free (children);
 
-      gtk_text_buffer_get_bounds (buffer, &start, &end);
-      res_text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+      /* a preview of a large text is not editable, paste all of it */
+      if (gtk_text_view_get_editable (tv))
+        {
+          gtk_text_buffer_get_bounds (buffer, &start, &end);
+          res_text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+        }
+      else
+        res_text = g_strdup (text);
 
       if (res_text != NULL)
         {
+#if VTE_CHECK_VERSION(0, 68, 0)
+          terminal_screen_paste_text (screen, res_text);
+          g_free (res_text);
+#else
           /* Modify the content of the clipboard as required, and then paste it.
            * Using the builtin pasting function enables bracketed paste mode when applicable.
            */
@@ -2030,6 +2316,7 @@ terminal_screen_paste_unsafe_text (TerminalScreen *screen,
 
           /* restore original clipboard contents */
           gtk_clipboard_set_text (clipboard, text, strlen (text));
+#endif
         }
 
       /* disable the dialog */
@@ -2071,6 +2358,250 @@ terminal_screen_paste_unsafe_text (TerminalScreen *screen,
 }
 
 
+#if VTE_CHECK_VERSION(0, 68, 0)
+static void
+terminal_screen_paste_text (TerminalScreen *screen,
+                            const gchar *text)
+{
+  VtePty *pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
+  struct termios tios;
+  GtkWidget *content_area;
+  GtkWidget *label;
+  gsize length;
+  gsize remaining;
+  gchar *paste_text;
+
+  if (G_UNLIKELY (text == NULL))
+    return;
+
+  /* small pastes go at once, unless they have to wait for a
+   * large one to finish */
+  length = strlen (text);
+  if (pty == NULL || (screen->paste_text == NULL && length <= PASTE_STREAM_SIZE))
+    {
+      vte_terminal_paste_text (VTE_TERMINAL (screen->terminal), text);
+      return;
+    }
+
+  if (screen->paste_text != NULL)
+    {
+      /* append to the paste in progress */
+      remaining = screen->paste_length - screen->paste_offset;
+      paste_text = g_malloc (remaining + length + 1);
+      memcpy (paste_text, screen->paste_text + screen->paste_offset, remaining);
+      memcpy (paste_text + remaining, text, length + 1);
+      g_free (screen->paste_text);
+
+      screen->paste_text = paste_text;
+      screen->paste_length = remaining + length;
+      screen->paste_offset = 0;
+      return;
+    }
+
+  screen->paste_text = g_strndup (text, length);
+  screen->paste_length = length;
+  screen->paste_offset = 0;
+  screen->paste_chunk = g_string_sized_new (PASTE_CHUNK_SIZE);
+
+  /* vte does not tell whether the child asked for bracketed paste, and
+   * programs only do so while they read the keys themselves. So frame the
+   * whole stream once unless the child pty is in canonical mode, where the
+   * markers would end up in the input of the program */
+  screen->paste_bracketed = tcgetattr (terminal_screen_get_child_fd (screen), &tios) == 0
+                            && (tios.c_lflag & ICANON) == 0;
+  if (screen->paste_bracketed)
+    g_string_append (screen->paste_chunk, "\033[200~");
+
+  /* written to the pty directly, as fast as the child reads it; vte keeps
+   * the fd non-blocking for its own writes */
+  screen->paste_watch_id = g_unix_fd_add (vte_pty_get_fd (pty), G_IO_OUT,
+                                          terminal_screen_paste_write, screen);
+
+  screen->paste_bar = gtk_info_bar_new_with_buttons (_("_Cancel"), GTK_RESPONSE_CANCEL, NULL);
+  gtk_info_bar_set_message_type (GTK_INFO_BAR (screen->paste_bar), GTK_MESSAGE_INFO);
+  content_area = gtk_info_bar_get_content_area (GTK_INFO_BAR (screen->paste_bar));
+
+  label = gtk_label_new (_("Pasting"));
+  gtk_container_add (GTK_CONTAINER (content_area), label);
+
+  screen->paste_progress = gtk_progress_bar_new ();
+  gtk_widget_set_hexpand (screen->paste_progress, TRUE);
+  gtk_widget_set_valign (screen->paste_progress, GTK_ALIGN_CENTER);
+  gtk_container_add (GTK_CONTAINER (content_area), screen->paste_progress);
+
+  g_signal_connect (G_OBJECT (screen->paste_bar), "response",
+                    G_CALLBACK (terminal_screen_paste_bar_response), screen);
+
+  gtk_widget_set_halign (screen->paste_bar, GTK_ALIGN_FILL);
+  gtk_widget_set_valign (screen->paste_bar, GTK_ALIGN_END);
+  gtk_overlay_add_overlay (GTK_OVERLAY (screen), screen->paste_bar);
+  gtk_widget_show_all (screen->paste_bar);
+}
+
+
+
+static void
+terminal_screen_paste_filter (GString *filtered,
+                              const gchar *text,
+                              gsize length)
+{
+  guchar c;
+  gsize n;
+
+  /* what vte_terminal_paste_text() does: line ends become \r, and the
+   * controls are dropped, so the text cannot end the paste early */
+  for (n = 0; n < length; n++)
+    {
+      c = text[n];
+      if (c == '\n' || c == '\r')
+        {
+          g_string_append_c (filtered, '\r');
+          if (c == '\r' && n + 1 < length && text[n + 1] == '\n')
+            n++;
+        }
+      else if (c == 0xc2 && n + 1 < length && (guchar) text[n + 1] >= 0x80 && (guchar) text[n + 1] <= 0x9f)
+        n++;
+      else if (c == '\t' || (c >= 0x20 && c != 0x7f))
+        g_string_append_c (filtered, c);
+    }
+}
+
+
+
+static gboolean
+terminal_screen_paste_next_chunk (TerminalScreen *screen)
+{
+  const gchar *start = screen->paste_text + screen->paste_offset;
+  const gchar *end = screen->paste_text + screen->paste_length;
+  const gchar *p;
+
+  if (start == end)
+    {
+      /* also when cancelled, the child must not stay in the paste */
+      if (!screen->paste_bracketed)
+        return FALSE;
+
+      g_string_append (screen->paste_chunk, "\033[201~");
+      screen->paste_bracketed = FALSE;
+      return TRUE;
+    }
+
+  /* end the chunk on a character, and keep \r\n together, both turn
+   * into a single \r */
+  p = start + MIN (PASTE_CHUNK_SIZE, (gsize) (end - start));
+  if (p < end)
+    {
+      while (p > start + 1 && (*p & 0xc0) == 0x80)
+        p--;
+      if (p[-1] == '\r' && *p == '\n')
+        p++;
+    }
+
+  terminal_screen_paste_filter (screen->paste_chunk, start, p - start);
+  screen->paste_offset = p - screen->paste_text;
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_screen_paste_write (gint fd,
+                             GIOCondition condition,
+                             gpointer user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  gsize written = 0;
+  gssize n;
+
+  if ((condition & (G_IO_ERR | G_IO_HUP)) != 0)
+    {
+      screen->paste_watch_id = 0;
+      terminal_screen_paste_stop (screen);
+      return G_SOURCE_REMOVE;
+    }
+
+  /* write until the child stops reading, but give the main loop a turn
+   * when it reads faster than one dispatch should take */
+  while (written < PASTE_STREAM_SIZE)
+    {
+      if (screen->paste_chunk->len == 0 && !terminal_screen_paste_next_chunk (screen))
+        {
+          screen->paste_watch_id = 0;
+          terminal_screen_paste_stop (screen);
+          return G_SOURCE_REMOVE;
+        }
+
+      n = write (fd, screen->paste_chunk->str, screen->paste_chunk->len);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+
+          screen->paste_watch_id = 0;
+          terminal_screen_paste_stop (screen);
+          return G_SOURCE_REMOVE;
+        }
+
+      g_string_erase (screen->paste_chunk, 0, n);
+      written += n;
+    }
+
+  if (screen->paste_progress != NULL && screen->paste_length > 0)
+    gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (screen->paste_progress),
+                                   (gdouble) screen->paste_offset / screen->paste_length);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static void
+terminal_screen_paste_bar_response (GtkInfoBar *info_bar,
+                                    gint response_id,
+                                    TerminalScreen *screen)
+{
+  /* drop the rest of the text, the watch still writes what is left of
+   * the current chunk and ends the paste */
+  screen->paste_length = screen->paste_offset;
+
+  gtk_widget_destroy (screen->paste_bar);
+  screen->paste_bar = NULL;
+  screen->paste_progress = NULL;
+}
+
+
+
+static void
+terminal_screen_paste_stop (TerminalScreen *screen)
+{
+  if (screen->paste_watch_id != 0)
+    {
+      g_source_remove (screen->paste_watch_id);
+      screen->paste_watch_id = 0;
+    }
+
+  g_free (screen->paste_text);
+  screen->paste_text = NULL;
+
+  if (screen->paste_chunk != NULL)
+    {
+      g_string_free (screen->paste_chunk, TRUE);
+      screen->paste_chunk = NULL;
+    }
+
+  if (screen->paste_bar != NULL)
+    {
+      gtk_widget_destroy (screen->paste_bar);
+      screen->paste_bar = NULL;
+      screen->paste_progress = NULL;
+    }
+}
+#endif
+
+
 
 static void
 terminal_screen_update_sixel (TerminalScreen *screen)
@@ -2120,14 +2651,126 @@ terminal_screen_spawn_async_cb (VteTerminal *terminal,
 
 
 
-/**
- * terminal_screen_new:
- * @attr    : Terminal attributes.
- * @columns : Columns (width).
- * @rows    : Rows (height).
- *
- * Creates a terminal screen object.
- **/
+static void
+terminal_screen_log_spawn_cb (GObject *object,
+                              GAsyncResult *result,
+                              gpointer user_data)
+{
+  TerminalScreen *screen = user_data;
+  GError *error = NULL;
+  GPid pid = -1;
+
+  if (vte_pty_spawn_finish (VTE_PTY (object), result, &pid, &error))
+    {
+      /* the terminal reports the exit once the relay closed its pty */
+      vte_terminal_watch_child (VTE_TERMINAL (screen->terminal), pid);
+      terminal_log_start (screen->log);
+    }
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
+
+  terminal_screen_spawn_async_cb (VTE_TERMINAL (screen->terminal), pid, error, screen);
+
+  if (error != NULL)
+    g_error_free (error);
+}
+
+
+
+static VtePty *
+terminal_screen_create_log_pty (TerminalScreen *screen)
+{
+  GError *error = NULL;
+  GDateTime *now;
+  VtePty *pty = NULL;
+  VtePty *child_pty = NULL;
+  gboolean log_sessions;
+  gboolean compress;
+  guint max_size;
+  gchar *directory;
+  gchar *filename;
+  gchar *timestamp;
+
+  /* a relaunched child gets a new log */
+  g_clear_object (&screen->log);
+
+  g_object_get (G_OBJECT (screen->preferences),
+                "misc-log-sessions", &log_sessions,
+                "misc-log-directory", &directory,
+                "misc-log-max-size", &max_size,
+                "misc-log-compress", &compress,
+                NULL);
+
+  if (screen->log_file != NULL)
+    filename = g_strdup (screen->log_file);
+  else if (log_sessions)
+    {
+      if (!IS_STRING (directory))
+        {
+          g_free (directory);
+          directory = terminal_util_get_default_log_directory ();
+        }
+
+      now = g_date_time_new_now_local ();
+      timestamp = g_date_time_format (now, "%Y%m%d-%H%M%S");
+      g_date_time_unref (now);
+
+      filename = g_strdup_printf ("%s%c%s-%d-%u.log%s", directory, G_DIR_SEPARATOR,
+                                  timestamp, (gint) getpid (), screen->session_id,
+                                  compress ? ".gz" : "");
+      g_free (timestamp);
+    }
+  else
+    {
+      g_free (directory);
+      return NULL;
+    }
+
+  g_free (directory);
+
+  screen->log = terminal_log_new (filename, (guint64) max_size * 1024 * 1024, compress, &error);
+  if (screen->log != NULL)
+    pty = vte_terminal_pty_new_sync (VTE_TERMINAL (screen->terminal), VTE_PTY_DEFAULT, NULL, &error);
+  if (pty != NULL)
+    {
+      vte_terminal_set_pty (VTE_TERMINAL (screen->terminal), pty);
+      child_pty = terminal_log_create_pty (screen->log, pty, &error);
+      g_object_unref (pty);
+    }
+
+  if (G_UNLIKELY (child_pty == NULL))
+    {
+      /* run the child without a log rather than not at all */
+      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                              error, _("Failed to log to \"%s\""), filename);
+      g_error_free (error);
+      g_clear_object (&screen->log);
+    }
+  else
+    {
+      terminal_log_set_size (screen->log,
+                             vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal)),
+                             vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal)));
+    }
+
+  g_free (filename);
+
+  return child_pty;
+}
+
+
+
+/**
+ * terminal_screen_new:
+ * @attr    : Terminal attributes.
+ * @columns : Columns (width).
+ * @rows    : Rows (height).
+ *
+ * Creates a terminal screen object.
+ **/
 TerminalScreen *
 terminal_screen_new (TerminalTabAttr *attr,
                      glong columns,
@@ -2145,6 +2788,8 @@ terminal_screen_new (TerminalTabAttr *attr,
     screen->initial_title = g_strdup (attr->initial_title);
   screen->dynamic_title_mode = attr->dynamic_title_mode;
   screen->hold = attr->hold;
+  if (attr->log_file != NULL)
+    screen->log_file = g_strdup (attr->log_file);
   vte_terminal_set_size (VTE_TERMINAL (screen->terminal), columns, rows);
 
   if (attr->color_text != NULL)
@@ -2174,6 +2819,7 @@ terminal_screen_launch_child (TerminalScreen *screen)
   gchar **env;
   gchar **argv2;
   guint i, argc;
+  VtePty *child_pty;
   VtePtyFlags pty_flags = VTE_PTY_DEFAULT;
   GSpawnFlags spawn_flags = G_SPAWN_SEARCH_PATH;
 
@@ -2202,15 +2848,32 @@ terminal_screen_launch_child (TerminalScreen *screen)
           spawn_flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
         }
 
-      vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
-                                pty_flags,
-                                screen->working_directory, argv2, env,
-                                spawn_flags,
-                                NULL, NULL,
-                                NULL, SPAWN_TIMEOUT,
-                                screen->cancellable,
-                                terminal_screen_spawn_async_cb,
-                                screen);
+      /* a logged child runs on a pty that is relayed to the terminal */
+      child_pty = terminal_screen_create_log_pty (screen);
+      if (child_pty != NULL)
+        {
+          vte_pty_spawn_async (child_pty,
+                               screen->working_directory, argv2, env,
+                               spawn_flags | G_SPAWN_DO_NOT_REAP_CHILD,
+                               NULL, NULL,
+                               NULL, SPAWN_TIMEOUT,
+                               screen->cancellable,
+                               terminal_screen_log_spawn_cb,
+                               screen);
+          g_object_unref (child_pty);
+        }
+      else
+        {
+          vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
+                                    pty_flags,
+                                    screen->working_directory, argv2, env,
+                                    spawn_flags,
+                                    NULL, NULL,
+                                    NULL, SPAWN_TIMEOUT,
+                                    screen->cancellable,
+                                    terminal_screen_spawn_async_cb,
+                                    screen);
+        }
 
       g_free (argv2);
 
@@ -2598,7 +3261,11 @@ void
 terminal_screen_copy_clipboard (TerminalScreen *screen)
 {
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+#if VTE_CHECK_VERSION(0, 72, 0)
+  terminal_screen_copy_clipboard_format (screen, FALSE);
+#else
   vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_TEXT);
+#endif
 }
 
 
@@ -2614,11 +3281,109 @@ void
 terminal_screen_copy_clipboard_html (TerminalScreen *screen)
 {
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+#if VTE_CHECK_VERSION(0, 72, 0)
+  terminal_screen_copy_clipboard_format (screen, TRUE);
+#else
   vte_terminal_copy_clipboard_format (VTE_TERMINAL (screen->terminal), VTE_FORMAT_HTML);
+#endif
+}
+
+
+
+#if VTE_CHECK_VERSION(0, 72, 0)
+static void
+terminal_screen_copy_clipboard_format (TerminalScreen *screen,
+                                       gboolean html)
+{
+  GtkClipboard *clipboard;
+  GtkTargetList *list;
+  GtkTargetEntry *targets;
+  gchar *text;
+  gint n_targets;
+
+  /* the plain text is kept, in case the selection changes before
+   * anyone asks, but the HTML, which can be many times larger, is
+   * generated on request */
+  text = vte_terminal_get_text_selected (VTE_TERMINAL (screen->terminal), VTE_FORMAT_TEXT);
+  if (G_UNLIKELY (text == NULL))
+    return;
+
+  list = gtk_target_list_new (NULL, 0);
+  if (html)
+    gtk_target_list_add (list, gdk_atom_intern_static_string ("text/html"), 0, CLIPBOARD_TARGET_HTML);
+  gtk_target_list_add_text_targets (list, CLIPBOARD_TARGET_TEXT);
+  targets = gtk_target_table_new_from_list (list, &n_targets);
+  gtk_target_list_unref (list);
+
+  /* replacing our own contents clears the previous text first */
+  clipboard = gtk_widget_get_clipboard (GTK_WIDGET (screen), GDK_SELECTION_CLIPBOARD);
+  if (gtk_clipboard_set_with_owner (clipboard, targets, n_targets,
+                                    terminal_screen_clipboard_get,
+                                    terminal_screen_clipboard_clear,
+                                    G_OBJECT (screen)))
+    {
+      screen->clipboard_text = text;
+      screen->clipboard_serial = screen->selection_serial;
+    }
+  else
+    g_free (text);
+
+  gtk_target_table_free (targets, n_targets);
+}
+
+
+
+static void
+terminal_screen_clipboard_get (GtkClipboard *clipboard,
+                               GtkSelectionData *selection_data,
+                               guint info,
+                               gpointer owner)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (owner);
+  gchar *escaped;
+  gchar *html;
+
+  if (info != CLIPBOARD_TARGET_HTML)
+    {
+      gtk_selection_data_set_text (selection_data, screen->clipboard_text, -1);
+      return;
+    }
+
+  if (screen->clipboard_serial == screen->selection_serial
+      && vte_terminal_get_has_selection (VTE_TERMINAL (screen->terminal)))
+    {
+      html = vte_terminal_get_text_selected (VTE_TERMINAL (screen->terminal), VTE_FORMAT_HTML);
+    }
+  else
+    {
+      /* the colors are gone with the selection, still offer the text */
+      escaped = g_markup_escape_text (screen->clipboard_text, -1);
+      html = g_strconcat ("<pre>", escaped, "</pre>", NULL);
+      g_free (escaped);
+    }
+
+  /* gtk hands large data over to the requestor in increments */
+  if (G_LIKELY (html != NULL))
+    gtk_selection_data_set (selection_data, gtk_selection_data_get_target (selection_data),
+                            8, (const guchar *) html, strlen (html));
+  g_free (html);
 }
 
 
 
+static void
+terminal_screen_clipboard_clear (GtkClipboard *clipboard,
+                                 gpointer owner)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (owner);
+
+  g_free (screen->clipboard_text);
+  screen->clipboard_text = NULL;
+}
+#endif
+
+
+
 /**
  * terminal_screen_paste_clipboard:
  * @screen  : A #TerminalScreen.
@@ -2643,7 +3408,11 @@ terminal_screen_paste_clipboard (TerminalScreen *screen)
       && !disable_paste_dialog_until_restart)
     terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_CLIPBOARD);
   else
+#if VTE_CHECK_VERSION(0, 68, 0)
+    terminal_screen_paste_text (screen, text);
+#else
     vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
+#endif
 
   g_free (text);
 }
@@ -2680,7 +3449,11 @@ terminal_screen_paste_primary (TerminalScreen *screen)
       && !disable_paste_dialog_until_restart)
     terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_PRIMARY);
   else
+#if VTE_CHECK_VERSION(0, 68, 0)
+    terminal_screen_paste_text (screen, text);
+#else
     vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
+#endif
 
   g_free (text);
 }
@@ -2715,9 +3488,6 @@ terminal_screen_reset (TerminalScreen *screen,
 {
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
   vte_terminal_reset (VTE_TERMINAL (screen->terminal), TRUE, clear);
-
-  if (clear)
-    vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), NULL, 0);
 }
 
 
@@ -2758,6 +3528,12 @@ terminal_screen_get_restart_command (TerminalScreen *screen)
   if (G_UNLIKELY (screen->hold))
     result = g_slist_prepend (result, g_strdup ("--hold"));
 
+  if (screen->log_file != NULL)
+    {
+      result = g_slist_prepend (result, g_strdup ("--log"));
+      result = g_slist_prepend (result, g_strdup (screen->log_file));
+    }
+
   return result;
 }
 
@@ -2877,41 +3653,17 @@ terminal_screen_set_encoding (TerminalScreen *screen,
 
 
 
-void
-terminal_screen_search_set_gregex (TerminalScreen *screen,
-                                   VteRegex *regex,
-                                   gboolean wrap_around)
-{
-  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_set_regex (VTE_TERMINAL (screen->terminal), regex, 0);
-  vte_terminal_search_set_wrap_around (VTE_TERMINAL (screen->terminal), wrap_around);
-}
-
-
-
-gboolean
-terminal_screen_search_has_gregex (TerminalScreen *screen)
-{
-  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-  return vte_terminal_search_get_regex (VTE_TERMINAL (screen->terminal)) != NULL;
-}
-
-
-
-void
-terminal_screen_search_find_next (TerminalScreen *screen)
-{
-  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_find_next (VTE_TERMINAL (screen->terminal));
-}
-
-
-
-void
-terminal_screen_search_find_previous (TerminalScreen *screen)
+/**
+ * terminal_screen_get_search:
+ * @screen : A #TerminalScreen.
+ *
+ * Return value: The #TerminalSearch highlighting matches in @screen.
+ **/
+TerminalSearch *
+terminal_screen_get_search (TerminalScreen *screen)
 {
-  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_search_find_previous (VTE_TERMINAL (screen->terminal));
+  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  return screen->search;
 }
 
 
@@ -3127,14 +3879,490 @@ terminal_screen_set_scroll_on_output (TerminalScreen *screen,
 
 
 
+static GCancellable *
+terminal_screen_task_cancellable_add (TerminalScreen *screen,
+                                      GCancellable *cancellable)
+{
+  cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : g_cancellable_new ();
+  screen->task_cancellables = g_slist_prepend (screen->task_cancellables, cancellable);
+
+  return cancellable;
+}
+
+
+
+static void
+terminal_screen_task_cancellable_remove (TerminalScreen *screen,
+                                         GCancellable *cancellable)
+{
+  screen->task_cancellables = g_slist_remove (screen->task_cancellables, cancellable);
+  g_object_unref (cancellable);
+}
+
+
+
+static void
+terminal_screen_save_contents_data_free (gpointer data)
+{
+  SaveContentsData *save = data;
+
+  if (save->terminal != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (save->terminal), (gpointer *) &save->terminal);
+  terminal_screen_task_cancellable_remove (save->screen, save->cancellable);
+  g_object_unref (save->screen);
+  g_object_unref (save->stream);
+  g_free (save->text);
+  g_free (save->selection);
+  g_slice_free (SaveContentsData, save);
+}
+
+
+
+static void
+terminal_screen_save_contents_next (GTask *task)
+{
+  SaveContentsData *save = g_task_get_task_data (task);
+  GtkAdjustment *adjustment;
+  const gchar *chunk;
+  glong last_row;
+  gsize length;
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_object_unref (task);
+      return;
+    }
+
+  if (G_UNLIKELY (save->terminal == NULL))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED, _("The terminal was closed"));
+      g_object_unref (task);
+      return;
+    }
+
+  if (save->selection_offset < save->selection_length)
+    {
+      chunk = save->selection + save->selection_offset;
+      length = MIN (SAVE_CONTENTS_SIZE, save->selection_length - save->selection_offset);
+      save->selection_offset += length;
+
+      if (save->progress_callback != NULL)
+        save->progress_callback (save->selection_offset, save->selection_length, save->progress_data);
+
+      g_output_stream_write_all_async (save->stream, chunk, length, G_PRIORITY_LOW,
+                                       g_task_get_cancellable (task),
+                                       terminal_screen_save_contents_written, task);
+      return;
+    }
+
+  if (save->next_row >= save->end_row)
+    {
+      /* flushes the compressor, if any */
+      g_output_stream_close_async (save->stream, G_PRIORITY_LOW, g_task_get_cancellable (task),
+                                   terminal_screen_save_contents_closed, task);
+      return;
+    }
+
+  /* rows that dropped off a limited scrollback in the meantime are lost */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (save->terminal));
+  save->next_row = MAX (save->next_row, (glong) gtk_adjustment_get_lower (adjustment));
+  last_row = MIN (save->next_row + SAVE_CONTENTS_ROWS, save->end_row) - 1;
+
+  /* the text of a chunk ends in a newline, unless the line is continued */
+  g_free (save->text);
+#if VTE_CHECK_VERSION(0, 72, 0)
+  save->text = vte_terminal_get_text_range_format (save->terminal, save->format,
+                                                   save->next_row, 0, last_row,
+                                                   vte_terminal_get_column_count (save->terminal) - 1,
+                                                   &length);
+#else
+  save->text = vte_terminal_get_text_range (save->terminal,
+                                            save->next_row, 0, last_row,
+                                            vte_terminal_get_column_count (save->terminal) - 1,
+                                            NULL, NULL, NULL);
+  length = (save->text != NULL) ? strlen (save->text) : 0;
+#endif
+  save->next_row = last_row + 1;
+
+  if (save->progress_callback != NULL)
+    save->progress_callback (save->next_row - save->first_row, save->end_row - save->first_row, save->progress_data);
+
+  if (G_UNLIKELY (length == 0))
+    {
+      terminal_screen_save_contents_next (task);
+      return;
+    }
+
+  g_output_stream_write_all_async (save->stream, save->text, length, G_PRIORITY_LOW,
+                                   g_task_get_cancellable (task),
+                                   terminal_screen_save_contents_written, task);
+}
+
+
+
+static void
+terminal_screen_save_contents_written (GObject *object,
+                                       GAsyncResult *result,
+                                       gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  GError *error = NULL;
+
+  if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (object), result, NULL, &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  /* the main loop ran in between, so the window stays responsive */
+  terminal_screen_save_contents_next (task);
+}
+
+
+
+static void
+terminal_screen_save_contents_closed (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  GError *error = NULL;
+
+  if (g_output_stream_close_finish (G_OUTPUT_STREAM (object), result, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+}
+
+
+
+/**
+ * terminal_screen_save_contents_async:
+ * @screen            : A #TerminalScreen.
+ * @stream            : The #GOutputStream to write to, closed when done.
+ * @format            : The #TerminalExportFormat to write.
+ * @range             : The #TerminalContentsRange to write.
+ * @cancellable       : A #GCancellable or %NULL, also cancelled when @screen is destroyed.
+ * @progress_callback : Called with the number of rows, or bytes of the selection, written, or %NULL.
+ * @progress_data     : Data for @progress_callback.
+ * @callback          : Called when the contents are saved.
+ * @user_data         : Data for @callback.
+ *
+ * Writes the text of the scrollback and screen, the visible rows or the
+ * selection to @stream. The text is read in chunks of rows, each one
+ * once the previous chunk is written, so neither reading a large
+ * scrollback nor a slow or compressing @stream blocks the main loop.
+ * The selection can only be taken at once, but it is written in chunks
+ * as well.
+ *
+ * Colors and attributes are kept in the ansi and cell run formats,
+ * converted from html chunks while writing. Vte before 0.72 only
+ * provides the text, so there these have no attributes, and the
+ * selection cannot be saved at all.
+ **/
 void
-terminal_screen_save_contents (TerminalScreen *screen,
-                               GOutputStream *stream,
-                               GError *error)
+terminal_screen_save_contents_async (TerminalScreen *screen,
+                                     GOutputStream *stream,
+                                     TerminalExportFormat format,
+                                     TerminalContentsRange range,
+                                     GCancellable *cancellable,
+                                     GFileProgressCallback progress_callback,
+                                     gpointer progress_data,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data)
 {
+  SaveContentsData *save;
+  GtkAdjustment *adjustment;
+  GConverter *encoder;
+  GTask *task;
+
   g_return_if_fail (TERMINAL_IS_SCREEN (screen));
-  vte_terminal_write_contents_sync (VTE_TERMINAL (screen->terminal),
-                                    stream, VTE_WRITE_DEFAULT, NULL, &error);
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+  /* the tab may have been closed while the stream was opened */
+  if (G_UNLIKELY (g_cancellable_is_cancelled (screen->cancellable)))
+    {
+      g_task_report_new_error (screen, callback, user_data, terminal_screen_save_contents_async,
+                               G_IO_ERROR, G_IO_ERROR_CANCELLED, _("The terminal was closed"));
+      return;
+    }
+
+  /* output that arrives while saving is not included */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+
+  save = g_slice_new0 (SaveContentsData);
+  save->screen = g_object_ref (screen);
+  save->cancellable = terminal_screen_task_cancellable_add (screen, cancellable);
+  save->terminal = VTE_TERMINAL (screen->terminal);
+  g_object_add_weak_pointer (G_OBJECT (save->terminal), (gpointer *) &save->terminal);
+  save->format = VTE_FORMAT_TEXT;
+  if (format == TERMINAL_EXPORT_FORMAT_TEXT)
+    save->stream = g_object_ref (stream);
+  else
+    {
+#if VTE_CHECK_VERSION(0, 72, 0)
+      save->format = VTE_FORMAT_HTML;
+#endif
+      encoder = terminal_export_encoder_new (format, save->format == VTE_FORMAT_HTML);
+      save->stream = g_converter_output_stream_new (stream, encoder);
+      g_object_unref (encoder);
+    }
+  if (range == TERMINAL_CONTENTS_RANGE_ALL)
+    {
+      save->first_row = gtk_adjustment_get_lower (adjustment);
+      save->end_row = gtk_adjustment_get_upper (adjustment);
+    }
+  else if (range == TERMINAL_CONTENTS_RANGE_SCREEN)
+    {
+      save->first_row = gtk_adjustment_get_value (adjustment);
+      save->end_row = save->first_row + gtk_adjustment_get_page_size (adjustment);
+    }
+  save->next_row = save->first_row;
+  save->progress_callback = progress_callback;
+  save->progress_data = progress_data;
+
+  task = g_task_new (screen, save->cancellable, callback, user_data);
+  g_task_set_source_tag (task, terminal_screen_save_contents_async);
+  g_task_set_task_data (task, save, terminal_screen_save_contents_data_free);
+
+  if (range == TERMINAL_CONTENTS_RANGE_SELECTION)
+    {
+#if VTE_CHECK_VERSION(0, 72, 0)
+      save->selection = vte_terminal_get_text_selected (save->terminal, save->format);
+      if (save->selection != NULL)
+        save->selection_length = strlen (save->selection);
+#else
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               _("Saving the selection requires VTE 0.72 or newer"));
+      g_object_unref (task);
+      return;
+#endif
+    }
+
+  terminal_screen_save_contents_next (task);
+}
+
+
+
+/**
+ * terminal_screen_save_contents_finish:
+ * @screen : A #TerminalScreen.
+ * @result : The #GAsyncResult passed to the callback.
+ * @error  : Return location for errors or %NULL.
+ *
+ * Return value: %TRUE if the contents were saved.
+ **/
+gboolean
+terminal_screen_save_contents_finish (TerminalScreen *screen,
+                                      GAsyncResult *result,
+                                      GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, screen), FALSE);
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+
+
+static void
+terminal_screen_replay_contents_data_free (gpointer data)
+{
+  ReplayContentsData *replay = data;
+
+  if (replay->terminal != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (replay->terminal), (gpointer *) &replay->terminal);
+  terminal_screen_task_cancellable_remove (replay->screen, replay->cancellable);
+  g_object_unref (replay->screen);
+  if (replay->stream != NULL)
+    g_object_unref (replay->stream);
+  g_slice_free (ReplayContentsData, replay);
+}
+
+
+
+static void
+terminal_screen_replay_contents_filled (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  ReplayContentsData *replay = g_task_get_task_data (task);
+  GInputStream *stream = G_INPUT_STREAM (object);
+  GConverter *converter;
+  const guchar *magic;
+  gsize length;
+  GError *error = NULL;
+
+  if (g_buffered_input_stream_fill_finish (G_BUFFERED_INPUT_STREAM (object), result, &error) < 0)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  /* saved contents may be compressed */
+  magic = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (object), &length);
+  if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+      converter = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+      stream = g_converter_input_stream_new (stream, converter);
+      g_object_unref (converter);
+    }
+  else
+    g_object_ref (stream);
+
+  converter = terminal_export_replayer_new ();
+  replay->stream = g_converter_input_stream_new (stream, converter);
+  g_object_unref (converter);
+  g_object_unref (stream);
+
+  g_input_stream_read_bytes_async (replay->stream, REPLAY_CONTENTS_SIZE, G_PRIORITY_LOW,
+                                   g_task_get_cancellable (task),
+                                   terminal_screen_replay_contents_read, task);
+}
+
+
+
+static void
+terminal_screen_replay_contents_read (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  ReplayContentsData *replay = g_task_get_task_data (task);
+  GBytes *bytes;
+  GError *error = NULL;
+
+  bytes = g_input_stream_read_bytes_finish (G_INPUT_STREAM (object), result, &error);
+  if (G_UNLIKELY (bytes == NULL))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  /* the read may have finished just before the tab was closed */
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_bytes_unref (bytes);
+      g_object_unref (task);
+      return;
+    }
+
+  if (G_UNLIKELY (replay->terminal == NULL))
+    {
+      g_bytes_unref (bytes);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED, _("The terminal was closed"));
+      g_object_unref (task);
+      return;
+    }
+
+  if (g_bytes_get_size (bytes) == 0)
+    {
+      g_bytes_unref (bytes);
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  vte_terminal_feed (replay->terminal, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+  g_bytes_unref (bytes);
+
+  g_input_stream_read_bytes_async (G_INPUT_STREAM (object), REPLAY_CONTENTS_SIZE, G_PRIORITY_LOW,
+                                   g_task_get_cancellable (task),
+                                   terminal_screen_replay_contents_read, task);
+}
+
+
+
+/**
+ * terminal_screen_replay_contents_async:
+ * @screen      : A #TerminalScreen without a child process.
+ * @stream      : The #GInputStream of saved contents.
+ * @cancellable : A #GCancellable or %NULL, also cancelled when @screen is destroyed.
+ * @callback    : Called when all contents are shown.
+ * @user_data   : Data for @callback.
+ *
+ * Feeds contents saved with terminal_screen_save_contents_async(), in
+ * any format and optionally compressed, to the terminal of @screen, in
+ * chunks as they are read.
+ **/
+void
+terminal_screen_replay_contents_async (TerminalScreen *screen,
+                                       GInputStream *stream,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data)
+{
+  ReplayContentsData *replay;
+  GInputStream *buffered;
+  GTask *task;
+
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+
+  /* the tab may have been closed while the stream was opened */
+  if (G_UNLIKELY (g_cancellable_is_cancelled (screen->cancellable)))
+    {
+      g_task_report_new_error (screen, callback, user_data, terminal_screen_replay_contents_async,
+                               G_IO_ERROR, G_IO_ERROR_CANCELLED, _("The terminal was closed"));
+      return;
+    }
+
+  replay = g_slice_new0 (ReplayContentsData);
+  replay->screen = g_object_ref (screen);
+  replay->cancellable = terminal_screen_task_cancellable_add (screen, cancellable);
+  replay->terminal = VTE_TERMINAL (screen->terminal);
+  g_object_add_weak_pointer (G_OBJECT (replay->terminal), (gpointer *) &replay->terminal);
+
+  task = g_task_new (screen, replay->cancellable, callback, user_data);
+  g_task_set_source_tag (task, terminal_screen_replay_contents_async);
+  g_task_set_task_data (task, replay, terminal_screen_replay_contents_data_free);
+
+  /* peek at the start of the stream for the gzip magic */
+  buffered = g_buffered_input_stream_new (stream);
+  g_buffered_input_stream_fill_async (G_BUFFERED_INPUT_STREAM (buffered), 2, G_PRIORITY_LOW, replay->cancellable,
+                                      terminal_screen_replay_contents_filled, task);
+  g_object_unref (buffered);
+}
+
+
+
+/**
+ * terminal_screen_replay_contents_finish:
+ * @screen : A #TerminalScreen.
+ * @result : The #GAsyncResult passed to the callback.
+ * @error  : Return location for errors or %NULL.
+ *
+ * Return value: %TRUE if all contents were shown.
+ **/
+gboolean
+terminal_screen_replay_contents_finish (TerminalScreen *screen,
+                                        GAsyncResult *result,
+                                        GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, screen), FALSE);
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+
+
+static gint
+terminal_screen_get_child_fd (TerminalScreen *screen)
+{
+  VtePty *pty;
+
+  /* the terminal pty of a logged tab has no processes */
+  if (screen->log != NULL)
+    return terminal_log_get_fd (screen->log);
+
+  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
+  if (pty == NULL)
+    return -1;
+
+  return vte_pty_get_fd (pty);
 }
 
 
@@ -3148,18 +4376,13 @@ terminal_screen_save_contents (TerminalScreen *screen,
 gboolean
 terminal_screen_has_foreground_process (TerminalScreen *screen)
 {
-  VtePty *pty;
   int fd;
   int fgpid;
 
   if (screen == NULL || screen->pid == -1)
     return FALSE;
 
-  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
-  if (pty == NULL)
-    return FALSE;
-
-  fd = vte_pty_get_fd (pty);
+  fd = terminal_screen_get_child_fd (screen);
   if (fd == -1)
     return FALSE;
 
@@ -3240,7 +4463,7 @@ terminal_screen_send_signal (TerminalScreen *screen,
   g_return_if_fail (screen->pid > 0);
   g_return_if_fail (signum >= 1 && signum <= 31);
 
-  fgpid = tcgetpgrp (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))));
+  fgpid = tcgetpgrp (terminal_screen_get_child_fd (screen));
   if (fgpid != -1 && fgpid != screen->pid)
     kill (fgpid, signum);
 }
@@ -22,11 +22,20 @@
 
 #include <gtk/gtk.h>
 
+#include "terminal-export.h"
 #include "terminal-options.h"
 #include "terminal-private.h"
+#include "terminal-search.h"
 
 G_BEGIN_DECLS
 
+typedef enum
+{
+  TERMINAL_CONTENTS_RANGE_ALL,
+  TERMINAL_CONTENTS_RANGE_SCREEN,
+  TERMINAL_CONTENTS_RANGE_SELECTION,
+} TerminalContentsRange;
+
 #define TERMINAL_TYPE_SCREEN (terminal_screen_get_type ())
 G_DECLARE_FINAL_TYPE (TerminalScreen, terminal_screen, TERMINAL, SCREEN, GtkOverlay)
 
@@ -116,17 +125,8 @@ void
 terminal_screen_set_encoding (TerminalScreen *screen,
                               const gchar *charset);
 
-void
-terminal_screen_search_set_gregex (TerminalScreen *screen,
-                                   VteRegex *regex,
-                                   gboolean wrap_around);
-gboolean
-terminal_screen_search_has_gregex (TerminalScreen *screen);
-
-void
-terminal_screen_search_find_next (TerminalScreen *screen);
-void
-terminal_screen_search_find_previous (TerminalScreen *screen);
+TerminalSearch *
+terminal_screen_get_search (TerminalScreen *screen);
 
 void
 terminal_screen_update_scrolling_bar (TerminalScreen *screen);
@@ -147,9 +147,32 @@ terminal_screen_set_scroll_on_output (TerminalScreen *screen,
                                       gboolean enabled);
 
 void
-terminal_screen_save_contents (TerminalScreen *screen,
-                               GOutputStream *stream,
-                               GError *error);
+terminal_screen_save_contents_async (TerminalScreen *screen,
+                                     GOutputStream *stream,
+                                     TerminalExportFormat format,
+                                     TerminalContentsRange range,
+                                     GCancellable *cancellable,
+                                     GFileProgressCallback progress_callback,
+                                     gpointer progress_data,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data);
+
+gboolean
+terminal_screen_save_contents_finish (TerminalScreen *screen,
+                                      GAsyncResult *result,
+                                      GError **error);
+
+void
+terminal_screen_replay_contents_async (TerminalScreen *screen,
+                                       GInputStream *stream,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data);
+
+gboolean
+terminal_screen_replay_contents_finish (TerminalScreen *screen,
+                                        GAsyncResult *result,
+                                        GError **error);
 
 gboolean
 terminal_screen_has_foreground_process (TerminalScreen *screen);
@@ -0,0 +1,384 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "terminal-search-all.h"
+
+/* matches kept per tab, more are of no use in a list */
+#define MAX_MATCHES_PER_SCREEN 1000
+
+/* lines searched between looking at the cancellable */
+#define LINES_PER_CANCEL_CHECK 1024
+
+/* time in microseconds the snapshots of the tabs may take per main loop
+ * iteration, at least one is taken each time */
+#define SNAPSHOT_TIME_SLICE 8000
+
+
+
+typedef struct _TerminalSearchAllData TerminalSearchAllData;
+typedef struct _TerminalSearchAllSnapshot TerminalSearchAllSnapshot;
+
+struct _TerminalSearchAllData
+{
+  /* shared by the threads, matching does not modify it */
+  pcre2_code_8 *code;
+
+  /* the screens still to take a snapshot of, and the index of the first */
+  GList *screens;
+  guint next_index;
+
+  /* the matches of each screen, so they are returned in tab order */
+  GPtrArray **results;
+  guint n_screens;
+
+  /* the running threads, and the snapshots while they are taken */
+  guint n_pending;
+};
+
+struct _TerminalSearchAllSnapshot
+{
+  /* the task of terminal_search_all() */
+  GTask *task;
+
+  TerminalScreen *screen;
+  guint index;
+
+  gchar *text;
+  gsize length;
+  glong first_row;
+  glong columns;
+};
+
+
+
+static void
+terminal_search_all_data_free (gpointer data);
+static void
+terminal_search_all_snapshot_free (gpointer data);
+static void
+terminal_search_all_match_free (gpointer data);
+static void
+terminal_search_all_thread (GTask *task,
+                            gpointer source_object,
+                            gpointer task_data,
+                            GCancellable *cancellable);
+static gboolean
+terminal_search_all_snapshot (gpointer user_data);
+static void
+terminal_search_all_snapshot_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data);
+static void
+terminal_search_all_return (GTask *task);
+
+
+
+static void
+terminal_search_all_data_free (gpointer data)
+{
+  TerminalSearchAllData *search_data = data;
+  guint n;
+
+  for (n = 0; n < search_data->n_screens; n++)
+    if (search_data->results[n] != NULL)
+      g_ptr_array_unref (search_data->results[n]);
+
+  g_list_free_full (search_data->screens, g_object_unref);
+  g_free (search_data->results);
+  pcre2_code_free_8 (search_data->code);
+  g_slice_free (TerminalSearchAllData, search_data);
+}
+
+
+
+static void
+terminal_search_all_snapshot_free (gpointer data)
+{
+  TerminalSearchAllSnapshot *snapshot = data;
+
+  g_object_unref (snapshot->task);
+  g_object_unref (snapshot->screen);
+  g_free (snapshot->text);
+  g_slice_free (TerminalSearchAllSnapshot, snapshot);
+}
+
+
+
+static void
+terminal_search_all_match_free (gpointer data)
+{
+  TerminalSearchAllMatch *match = data;
+
+  if (match->screen != NULL)
+    g_object_unref (match->screen);
+  g_free (match->text);
+  g_slice_free (TerminalSearchAllMatch, match);
+}
+
+
+
+static void
+terminal_search_all_thread (GTask *task,
+                            gpointer source_object,
+                            gpointer task_data,
+                            GCancellable *cancellable)
+{
+  TerminalSearchAllSnapshot *snapshot = task_data;
+  TerminalSearchAllData *data = g_task_get_task_data (snapshot->task);
+  TerminalSearchAllMatch *match;
+  pcre2_match_data_8 *match_data;
+  GPtrArray *matches;
+  const gchar *end = snapshot->text + snapshot->length;
+  const gchar *line;
+  const gchar *next;
+  const gchar *p;
+  gunichar c;
+  glong row = snapshot->first_row;
+  glong width;
+  guint n_lines = 0;
+
+  match_data = pcre2_match_data_create_from_pattern_8 (data->code, NULL);
+  matches = g_ptr_array_new_with_free_func (terminal_search_all_match_free);
+
+  for (line = snapshot->text; line < end && matches->len < MAX_MATCHES_PER_SCREEN; line = next + 1)
+    {
+      if (++n_lines % LINES_PER_CANCEL_CHECK == 0 && g_cancellable_is_cancelled (cancellable))
+        break;
+
+      next = memchr (line, '\n', end - line);
+      if (next == NULL)
+        next = end;
+
+      if (pcre2_match_8 (data->code, (PCRE2_SPTR8) line, next - line, 0, 0, match_data, NULL) > 0)
+        {
+          match = g_slice_new0 (TerminalSearchAllMatch);
+          match->row = row;
+          match->text = g_strndup (line, next - line);
+          g_ptr_array_add (matches, match);
+        }
+
+      /* the snapshot has no soft line breaks, so count the rows a line
+       * is wrapped over, with wide characters taking two cells */
+      for (width = 0, p = line; p < next; p = g_utf8_next_char (p))
+        {
+          if ((guchar) *p < 0x80)
+            width++;
+          else
+            {
+              c = g_utf8_get_char (p);
+              if (!g_unichar_iszerowidth (c))
+                width += g_unichar_iswide (c) ? 2 : 1;
+            }
+        }
+      row += MAX (1, (width + snapshot->columns - 1) / snapshot->columns);
+    }
+
+  pcre2_match_data_free_8 (match_data);
+
+  if (g_task_return_error_if_cancelled (task))
+    g_ptr_array_unref (matches);
+  else
+    g_task_return_pointer (task, matches, (GDestroyNotify) g_ptr_array_unref);
+}
+
+
+
+static gboolean
+terminal_search_all_snapshot (gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  TerminalSearchAllData *data = g_task_get_task_data (task);
+  TerminalSearchAllSnapshot *snapshot;
+  TerminalScreen *screen;
+  GTask *screen_task;
+  gint64 deadline = g_get_monotonic_time () + SNAPSHOT_TIME_SLICE;
+
+  /* a tab at a time, so a lot of them do not hold up the main loop, and
+   * each is searched while the next ones are taken */
+  while (data->screens != NULL && !g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    {
+      screen = data->screens->data;
+      data->screens = g_list_delete_link (data->screens, data->screens);
+
+      snapshot = g_slice_new0 (TerminalSearchAllSnapshot);
+      snapshot->text = terminal_search_get_text (terminal_screen_get_search (screen),
+                                                 &snapshot->first_row, &snapshot->columns,
+                                                 &snapshot->length);
+      if (G_LIKELY (snapshot->text != NULL))
+        {
+          snapshot->task = g_object_ref (task);
+          snapshot->screen = screen;
+          snapshot->index = data->next_index;
+          data->n_pending++;
+
+          screen_task = g_task_new (NULL, g_task_get_cancellable (task), terminal_search_all_snapshot_ready, NULL);
+          g_task_set_source_tag (screen_task, terminal_search_all_snapshot_ready);
+          g_task_set_task_data (screen_task, snapshot, terminal_search_all_snapshot_free);
+          g_task_run_in_thread (screen_task, terminal_search_all_thread);
+          g_object_unref (screen_task);
+        }
+      else
+        {
+          g_slice_free (TerminalSearchAllSnapshot, snapshot);
+          g_object_unref (screen);
+        }
+
+      data->next_index++;
+
+      if (data->screens != NULL && g_get_monotonic_time () >= deadline)
+        return G_SOURCE_CONTINUE;
+    }
+
+  /* the snapshots are done or cancelled, see if the threads are as well */
+  if (--data->n_pending == 0)
+    terminal_search_all_return (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+terminal_search_all_snapshot_ready (GObject *object,
+                                    GAsyncResult *result,
+                                    gpointer user_data)
+{
+  TerminalSearchAllSnapshot *snapshot = g_task_get_task_data (G_TASK (result));
+  TerminalSearchAllData *data = g_task_get_task_data (snapshot->task);
+  GPtrArray *matches;
+  guint n;
+
+  /* cancelled searches have no matches */
+  matches = g_task_propagate_pointer (G_TASK (result), NULL);
+  if (matches != NULL)
+    {
+      for (n = 0; n < matches->len; n++)
+        ((TerminalSearchAllMatch *) g_ptr_array_index (matches, n))->screen = g_object_ref (snapshot->screen);
+
+      data->results[snapshot->index] = matches;
+    }
+
+  if (--data->n_pending == 0)
+    terminal_search_all_return (snapshot->task);
+}
+
+
+
+static void
+terminal_search_all_return (GTask *task)
+{
+  TerminalSearchAllData *data = g_task_get_task_data (task);
+  GPtrArray *matches;
+  guint n;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  matches = g_ptr_array_new_with_free_func (terminal_search_all_match_free);
+  for (n = 0; n < data->n_screens; n++)
+    {
+      if (data->results[n] != NULL)
+        {
+          g_ptr_array_extend_and_steal (matches, data->results[n]);
+          data->results[n] = NULL;
+        }
+    }
+
+  g_task_return_pointer (task, matches, (GDestroyNotify) g_ptr_array_unref);
+}
+
+
+
+/**
+ * terminal_search_all:
+ * @screens     : List of #TerminalScreen to search.
+ * @pattern     : The pcre2 pattern to look for.
+ * @flags       : Compile options for @pattern.
+ * @cancellable : A #GCancellable or %NULL.
+ * @callback    : Called when all screens have been searched.
+ * @user_data   : Data for @callback.
+ *
+ * Searches the scrollback and screen of all @screens for lines matching
+ * @pattern. The text of the screens is taken from an idle source on the
+ * calling thread, a few at a time, and each screen is searched in a worker
+ * thread as soon as its text is there, concurrently with the others.
+ **/
+void
+terminal_search_all (GList *screens,
+                     const gchar *pattern,
+                     guint32 flags,
+                     GCancellable *cancellable,
+                     GAsyncReadyCallback callback,
+                     gpointer user_data)
+{
+  TerminalSearchAllData *data;
+  PCRE2_UCHAR8 message[256];
+  PCRE2_SIZE error_offset;
+  GTask *task;
+  gint error_number;
+
+  g_return_if_fail (pattern != NULL);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, terminal_search_all);
+
+  data = g_slice_new0 (TerminalSearchAllData);
+  data->code = pcre2_compile_8 ((PCRE2_SPTR8) pattern, PCRE2_ZERO_TERMINATED, flags,
+                                &error_number, &error_offset, NULL);
+  if (G_UNLIKELY (data->code == NULL))
+    {
+      g_slice_free (TerminalSearchAllData, data);
+      pcre2_get_error_message_8 (error_number, message, sizeof (message));
+      g_task_return_new_error (task, G_REGEX_ERROR, G_REGEX_ERROR_COMPILE, "%s", (const gchar *) message);
+      g_object_unref (task);
+      return;
+    }
+
+  /* the interpreter is used if jit is not available */
+  pcre2_jit_compile_8 (data->code, PCRE2_JIT_COMPLETE);
+
+  data->n_screens = g_list_length (screens);
+  data->results = g_new0 (GPtrArray *, data->n_screens);
+  data->screens = g_list_copy_deep (screens, (GCopyFunc) (void (*) (void)) g_object_ref, NULL);
+  g_task_set_task_data (task, data, terminal_search_all_data_free);
+
+  /* held until all snapshots are taken */
+  data->n_pending = 1;
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, terminal_search_all_snapshot, task, g_object_unref);
+}
+
+
+
+/**
+ * terminal_search_all_finish:
+ * @result : The #GAsyncResult passed to the callback.
+ * @error  : Return location for errors or %NULL.
+ *
+ * Return value: Array of #TerminalSearchAllMatch, in the order of the
+ *               screens and their rows, or %NULL on error.
+ **/
+GPtrArray *
+terminal_search_all_finish (GAsyncResult *result,
+                            GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,48 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SEARCH_ALL_H
+#define TERMINAL_SEARCH_ALL_H
+
+#include "terminal-screen.h"
+
+G_BEGIN_DECLS
+
+typedef struct _TerminalSearchAllMatch TerminalSearchAllMatch;
+
+struct _TerminalSearchAllMatch
+{
+  TerminalScreen *screen;
+  glong row;
+  gchar *text;
+};
+
+void
+terminal_search_all (GList *screens,
+                     const gchar *pattern,
+                     guint32 flags,
+                     GCancellable *cancellable,
+                     GAsyncReadyCallback callback,
+                     gpointer user_data);
+
+GPtrArray *
+terminal_search_all_finish (GAsyncResult *result,
+                            GError **error);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SEARCH_ALL_H */
@@ -22,9 +22,33 @@
 #include <string.h>
 #endif
 
+#include "terminal-marshal.h"
 #include "terminal-preferences.h"
 #include "terminal-search-dialog.h"
 
+/* time after the last change before the matches are highlighted */
+#define SEARCH_TYPING_TIMEOUT 150
+
+
+
+/* Signal identifiers */
+enum
+{
+  SEARCH_CHANGED,
+  RESULT_ACTIVATED,
+  LAST_SIGNAL,
+};
+
+/* Results of searching all tabs */
+enum
+{
+  RESULT_COLUMN_SCREEN,
+  RESULT_COLUMN_ROW,
+  RESULT_COLUMN_TITLE,
+  RESULT_COLUMN_TEXT,
+  N_RESULT_COLUMNS
+};
+
 
 
 static void
@@ -32,8 +56,6 @@ terminal_search_dialog_finalize (GObject *object);
 static void
 terminal_search_dialog_opacity_changed (TerminalSearchDialog *dialog);
 static void
-terminal_search_dialog_clear_gregex (TerminalSearchDialog *dialog);
-static void
 terminal_search_dialog_entry_icon_release (GtkWidget *entry,
                                            GtkEntryIconPosition icon_pos);
 static void
@@ -43,6 +65,18 @@ static gboolean
 terminal_search_dialog_entry_key_press (GtkWidget *entry,
                                         GdkEventKey *event,
                                         TerminalSearchDialog *dialog);
+static void
+terminal_search_dialog_queue_search_changed (TerminalSearchDialog *dialog);
+static gboolean
+terminal_search_dialog_search_changed (gpointer user_data);
+static gchar *
+terminal_search_dialog_build_pattern (TerminalSearchDialog *dialog,
+                                      guint32 *flags);
+static void
+terminal_search_dialog_result_activated (GtkTreeView *view,
+                                         GtkTreePath *path,
+                                         GtkTreeViewColumn *column,
+                                         TerminalSearchDialog *dialog);
 
 
 #if !LIBXFCE4UI_CHECK_VERSION(4, 21, 8)
@@ -56,12 +90,12 @@ struct _TerminalSearchDialog
 {
   XfceTitledDialog parent_instance;
 
-  VteRegex *last_gregex;
-
   GtkWidget *button_prev;
   GtkWidget *button_next;
+  GtkWidget *button_all;
 
   GtkWidget *entry;
+  GtkWidget *status;
 
   GtkWidget *match_case;
   GtkWidget *match_regex;
@@ -69,10 +103,19 @@ struct _TerminalSearchDialog
   GtkWidget *wrap_around;
 
   GtkAdjustment *opacity_adjustment;
+
+  GtkListStore *results;
+  GtkWidget *results_window;
+
+  guint search_changed_id;
 };
 
 
 
+static guint dialog_signals[LAST_SIGNAL];
+
+
+
 G_DEFINE_TYPE (TerminalSearchDialog, terminal_search_dialog, XFCE_TYPE_TITLED_DIALOG)
 
 
@@ -84,6 +127,36 @@ terminal_search_dialog_class_init (TerminalSearchDialogClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = terminal_search_dialog_finalize;
+
+  /**
+   * TerminalSearchDialog::search-changed:
+   * @dialog : A #TerminalSearchDialog.
+   *
+   * Emitted shortly after the search text or its options changed, to
+   * highlight the matches while typing.
+   **/
+  dialog_signals[SEARCH_CHANGED] = g_signal_new (I_ ("search-changed"),
+                                                 G_TYPE_FROM_CLASS (gobject_class),
+                                                 G_SIGNAL_RUN_LAST,
+                                                 0, NULL, NULL,
+                                                 g_cclosure_marshal_VOID__VOID,
+                                                 G_TYPE_NONE, 0);
+
+  /**
+   * TerminalSearchDialog::result-activated:
+   * @dialog : A #TerminalSearchDialog.
+   * @screen : The #TerminalScreen of the result.
+   * @row    : The row of the result in @screen.
+   *
+   * Emitted when a result of searching all tabs is activated.
+   **/
+  dialog_signals[RESULT_ACTIVATED] = g_signal_new (I_ ("result-activated"),
+                                                   G_TYPE_FROM_CLASS (gobject_class),
+                                                   G_SIGNAL_RUN_LAST,
+                                                   0, NULL, NULL,
+                                                   _terminal_marshal_VOID__OBJECT_LONG,
+                                                   G_TYPE_NONE, 2,
+                                                   TERMINAL_TYPE_SCREEN, G_TYPE_LONG);
 }
 
 
@@ -100,6 +173,8 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   GtkWidget *opacity_scale;
   GtkWidget *opacity_label;
   GtkWidget *percent_label;
+  GtkWidget *view;
+  GtkCellRenderer *renderer;
   GdkScreen *screen = gtk_widget_get_screen (GTK_WIDGET (dialog));
   GtkAccelGroup *group = gtk_accel_group_new ();
   GtkAccelKey key_prev = { 0 }, key_next = { 0 };
@@ -115,6 +190,10 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   close_button = xfce_gtk_button_new_mixed ("window-close", _("_Close"));
   xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), close_button, GTK_RESPONSE_CLOSE);
 
+  dialog->button_all = xfce_gtk_button_new_mixed ("edit-find", _("In _All Tabs"));
+  gtk_widget_set_tooltip_text (dialog->button_all, _("List the matching lines of all tabs in all windows"));
+  xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), dialog->button_all, TERMINAL_RESPONSE_SEARCH_ALL);
+
   dialog->button_prev = xfce_gtk_button_new_mixed ("go-previous", _("_Previous"));
   xfce_titled_dialog_add_action_widget (XFCE_TITLED_DIALOG (dialog), dialog->button_prev, TERMINAL_RESPONSE_SEARCH_PREV);
   gtk_widget_set_can_default (dialog->button_prev, TRUE);
@@ -151,26 +230,29 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   g_signal_connect (G_OBJECT (dialog->entry), "changed",
                     G_CALLBACK (terminal_search_dialog_entry_changed), dialog);
 
+  /* shows the number of matches */
+  dialog->status = gtk_label_new (NULL);
+  gtk_widget_set_sensitive (dialog->status, FALSE);
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->status, FALSE, FALSE, 0);
+
   dialog->match_case = gtk_check_button_new_with_mnemonic (_("C_ase sensitive"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_case, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_case), "toggled",
-                            G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+                            G_CALLBACK (terminal_search_dialog_queue_search_changed), dialog);
 
   dialog->match_regex = gtk_check_button_new_with_mnemonic (_("Match as _regular expression"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_regex, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_regex), "toggled",
-                            G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+                            G_CALLBACK (terminal_search_dialog_queue_search_changed), dialog);
 
   dialog->match_word = gtk_check_button_new_with_mnemonic (_("Match _entire word only"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_word, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_word), "toggled",
-                            G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+                            G_CALLBACK (terminal_search_dialog_queue_search_changed), dialog);
 
   dialog->wrap_around = gtk_check_button_new_with_mnemonic (_("_Wrap around"));
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->wrap_around), TRUE);
   gtk_box_pack_start (GTK_BOX (vbox), dialog->wrap_around, FALSE, FALSE, 0);
-  g_signal_connect_swapped (G_OBJECT (dialog->wrap_around), "toggled",
-                            G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
 
   opacity_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
   gtk_widget_set_margin_start (opacity_box, 6);
@@ -201,6 +283,33 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   if (gdk_screen_is_composited (screen))
     gtk_box_pack_start (GTK_BOX (vbox), opacity_box, FALSE, TRUE, 0);
 
+  /* results of searching all tabs, hidden until there are some */
+  dialog->results = gtk_list_store_new (N_RESULT_COLUMNS, TERMINAL_TYPE_SCREEN, G_TYPE_LONG, G_TYPE_STRING, G_TYPE_STRING);
+
+  dialog->results_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (dialog->results_window), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (dialog->results_window), GTK_SHADOW_IN);
+  gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (dialog->results_window), 200);
+  gtk_widget_set_no_show_all (dialog->results_window, TRUE);
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->results_window, TRUE, TRUE, 0);
+
+  view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (dialog->results));
+  gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (view), FALSE);
+  gtk_container_add (GTK_CONTAINER (dialog->results_window), view);
+  gtk_widget_show (view);
+  g_signal_connect (G_OBJECT (view), "row-activated",
+                    G_CALLBACK (terminal_search_dialog_result_activated), dialog);
+
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer), "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1, NULL, renderer,
+                                               "text", RESULT_COLUMN_TITLE, NULL);
+
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer), "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1, NULL, renderer,
+                                               "text", RESULT_COLUMN_TEXT, NULL);
+
   terminal_search_dialog_entry_changed (dialog->entry, dialog);
 }
 
@@ -209,7 +318,12 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
 static void
 terminal_search_dialog_finalize (GObject *object)
 {
-  terminal_search_dialog_clear_gregex (TERMINAL_SEARCH_DIALOG (object));
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (object);
+
+  if (dialog->search_changed_id != 0)
+    g_source_remove (dialog->search_changed_id);
+
+  g_object_unref (dialog->results);
 
   (*G_OBJECT_CLASS (terminal_search_dialog_parent_class)->finalize) (object);
 }
@@ -228,18 +342,6 @@ terminal_search_dialog_opacity_changed (TerminalSearchDialog *dialog)
 
 
 
-static void
-terminal_search_dialog_clear_gregex (TerminalSearchDialog *dialog)
-{
-  if (dialog->last_gregex != NULL)
-    {
-      vte_regex_unref (dialog->last_gregex);
-      dialog->last_gregex = NULL;
-    }
-}
-
-
-
 static void
 terminal_search_dialog_entry_icon_release (GtkWidget *entry,
                                            GtkEntryIconPosition icon_pos)
@@ -260,13 +362,101 @@ terminal_search_dialog_entry_changed (GtkWidget *entry,
   text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
   has_text = IS_STRING (text);
 
-  terminal_search_dialog_clear_gregex (dialog);
-
   gtk_widget_set_sensitive (dialog->button_prev, has_text);
   gtk_widget_set_sensitive (dialog->button_next, has_text);
+  gtk_widget_set_sensitive (dialog->button_all, has_text);
 
   xfce_titled_dialog_set_default_response (XFCE_TITLED_DIALOG (dialog),
                                            has_text ? TERMINAL_RESPONSE_SEARCH_PREV : GTK_RESPONSE_CLOSE);
+
+  terminal_search_dialog_queue_search_changed (dialog);
+}
+
+
+
+static void
+terminal_search_dialog_queue_search_changed (TerminalSearchDialog *dialog)
+{
+  /* restart the timeout on each key press */
+  if (dialog->search_changed_id != 0)
+    g_source_remove (dialog->search_changed_id);
+
+  dialog->search_changed_id = g_timeout_add (SEARCH_TYPING_TIMEOUT, terminal_search_dialog_search_changed, dialog);
+}
+
+
+
+static gboolean
+terminal_search_dialog_search_changed (gpointer user_data)
+{
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (user_data);
+
+  dialog->search_changed_id = 0;
+
+  g_signal_emit (G_OBJECT (dialog), dialog_signals[SEARCH_CHANGED], 0);
+
+  return FALSE;
+}
+
+
+
+static gchar *
+terminal_search_dialog_build_pattern (TerminalSearchDialog *dialog,
+                                      guint32 *flags)
+{
+  const gchar *text;
+  gchar *pattern;
+  gchar *word_regex;
+
+  /* unset if no pattern is typed */
+  text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
+  if (!IS_STRING (text))
+    return NULL;
+
+  *flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
+
+  if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)))
+    *flags |= PCRE2_CASELESS;
+
+  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
+    {
+      /* MULTILINE flag is always used for pcre2 */
+      *flags |= G_REGEX_MULTILINE;
+      pattern = g_strdup (text);
+    }
+  else
+    pattern = g_regex_escape_string (text, -1);
+
+  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)))
+    {
+      word_regex = g_strdup_printf ("\\b%s\\b", pattern);
+      g_free (pattern);
+      pattern = word_regex;
+    }
+
+  return pattern;
+}
+
+
+
+static void
+terminal_search_dialog_result_activated (GtkTreeView *view,
+                                         GtkTreePath *path,
+                                         GtkTreeViewColumn *column,
+                                         TerminalSearchDialog *dialog)
+{
+  TerminalScreen *screen;
+  GtkTreeIter iter;
+  glong row;
+
+  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (dialog->results), &iter, path))
+    return;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (dialog->results), &iter,
+                      RESULT_COLUMN_SCREEN, &screen,
+                      RESULT_COLUMN_ROW, &row, -1);
+  g_signal_emit (G_OBJECT (dialog), dialog_signals[RESULT_ACTIVATED], 0, screen, row);
+  g_object_unref (screen);
 }
 
 
@@ -309,58 +499,132 @@ terminal_search_dialog_get_wrap_around (TerminalSearchDialog *dialog)
 
 
 
-VteRegex *
-terminal_search_dialog_get_regex (TerminalSearchDialog *dialog,
-                                  GError **error)
+/**
+ * terminal_search_dialog_get_pattern:
+ * @dialog : A #TerminalSearchDialog.
+ * @flags  : Return location for the pcre2 compile options.
+ *
+ * Return value: The pcre2 pattern for the current search, or %NULL
+ *               if nothing is typed. Free with g_free().
+ **/
+gchar *
+terminal_search_dialog_get_pattern (TerminalSearchDialog *dialog,
+                                    guint32 *flags)
 {
-  const gchar *pattern;
-  guint32 flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
-  gchar *pattern_escaped = NULL;
-  gchar *word_regex = NULL;
-  VteRegex *regex;
-
   g_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  g_return_val_if_fail (flags != NULL, NULL);
 
-  /* if not cleared, use the old regex */
-  if (dialog->last_gregex != NULL)
-    return vte_regex_ref (dialog->last_gregex);
+  return terminal_search_dialog_build_pattern (dialog, flags);
+}
 
-  /* unset if no pattern is typed */
-  pattern = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
-  if (!IS_STRING (pattern))
+
+
+/**
+ * terminal_search_dialog_get_literal:
+ * @dialog : A #TerminalSearchDialog.
+ *
+ * Return value: The text every match of the current search contains,
+ *               or %NULL for regular expressions.
+ **/
+const gchar *
+terminal_search_dialog_get_literal (TerminalSearchDialog *dialog)
+{
+  const gchar *text;
+
+  g_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
+
+  text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
+  if (!IS_STRING (text) || gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
     return NULL;
 
-  if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)))
-    flags |= PCRE2_CASELESS;
+  return text;
+}
 
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
-    {
-      /* MULTILINE flag is always used for pcre2 */
-      flags |= G_REGEX_MULTILINE;
-    }
+
+
+/**
+ * terminal_search_dialog_set_status:
+ * @dialog    : A #TerminalSearchDialog.
+ * @current   : Index of the current match, or -1.
+ * @n_matches : Number of matches found.
+ * @done      : Whether all text has been searched.
+ *
+ * Shows how many matches were found next to the search entry.
+ **/
+void
+terminal_search_dialog_set_status (TerminalSearchDialog *dialog,
+                                   gint current,
+                                   guint n_matches,
+                                   gboolean done)
+{
+  gchar *status;
+
+  g_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  if (!IS_STRING (gtk_entry_get_text (GTK_ENTRY (dialog->entry))))
+    status = NULL;
+  else if (n_matches == 0)
+    status = g_strdup (done ? _("No matches") : _("Searching..."));
+  else if (current >= 0)
+    status = g_strdup_printf (_("%d of %u"), current + 1, n_matches);
   else
+    status = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE, "%u match", "%u matches", n_matches), n_matches);
+
+  gtk_label_set_text (GTK_LABEL (dialog->status), status);
+  g_free (status);
+}
+
+
+
+/**
+ * terminal_search_dialog_set_results:
+ * @dialog  : A #TerminalSearchDialog.
+ * @matches : Array of #TerminalSearchAllMatch, or %NULL to hide the results.
+ *
+ * Lists the matching lines of searching all tabs.
+ **/
+void
+terminal_search_dialog_set_results (TerminalSearchDialog *dialog,
+                                    GPtrArray *matches)
+{
+  TerminalSearchAllMatch *match;
+  TerminalScreen *last_screen = NULL;
+  gchar *title = NULL;
+  guint n;
+
+  g_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  gtk_list_store_clear (dialog->results);
+
+  if (matches == NULL)
     {
-      pattern_escaped = g_regex_escape_string (pattern, -1);
-      pattern = pattern_escaped;
+      gtk_widget_hide (dialog->results_window);
+      return;
     }
 
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)))
+  for (n = 0; n < matches->len; n++)
     {
-      word_regex = g_strdup_printf ("\\b%s\\b", pattern);
-      pattern = word_regex;
+      match = g_ptr_array_index (matches, n);
+
+      /* the matches of a screen are next to each other */
+      if (match->screen != last_screen)
+        {
+          g_free (title);
+          title = terminal_screen_get_title (match->screen);
+          last_screen = match->screen;
+        }
+
+      gtk_list_store_insert_with_values (dialog->results, NULL, -1,
+                                         RESULT_COLUMN_SCREEN, match->screen,
+                                         RESULT_COLUMN_ROW, match->row,
+                                         RESULT_COLUMN_TITLE, title,
+                                         RESULT_COLUMN_TEXT, match->text, -1);
     }
 
-  regex = vte_regex_new_for_search (pattern, -1, flags, error);
-
-  g_free (pattern_escaped);
-  g_free (word_regex);
-
-  /* keep around */
-  if (regex != NULL)
-    dialog->last_gregex = vte_regex_ref (regex);
+  g_free (title);
 
-  return regex;
+  terminal_search_dialog_set_status (dialog, -1, matches->len, TRUE);
+  gtk_widget_show (dialog->results_window);
 }
 
 
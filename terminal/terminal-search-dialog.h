@@ -21,6 +21,7 @@
 #include <libxfce4ui/libxfce4ui.h>
 
 #include "terminal-private.h"
+#include "terminal-search-all.h"
 
 G_BEGIN_DECLS
 
@@ -43,7 +44,8 @@ G_DECLARE_FINAL_TYPE (TerminalSearchDialog, terminal_search_dialog, TERMINAL, SE
 enum
 {
   TERMINAL_RESPONSE_SEARCH_NEXT,
-  TERMINAL_RESPONSE_SEARCH_PREV
+  TERMINAL_RESPONSE_SEARCH_PREV,
+  TERMINAL_RESPONSE_SEARCH_ALL
 };
 
 GtkWidget *
@@ -52,9 +54,22 @@ terminal_search_dialog_new (GtkWindow *parent);
 gboolean
 terminal_search_dialog_get_wrap_around (TerminalSearchDialog *dialog);
 
-VteRegex *
-terminal_search_dialog_get_regex (TerminalSearchDialog *dialog,
-                                  GError **error);
+gchar *
+terminal_search_dialog_get_pattern (TerminalSearchDialog *dialog,
+                                    guint32 *flags);
+
+const gchar *
+terminal_search_dialog_get_literal (TerminalSearchDialog *dialog);
+
+void
+terminal_search_dialog_set_status (TerminalSearchDialog *dialog,
+                                   gint current,
+                                   guint n_matches,
+                                   gboolean done);
+
+void
+terminal_search_dialog_set_results (TerminalSearchDialog *dialog,
+                                    GPtrArray *matches);
 
 void
 terminal_search_dialog_present (TerminalSearchDialog *dialog);
@@ -0,0 +1,1304 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "terminal-search.h"
+
+/* time in microseconds the scan may take per main loop iteration, so
+ * input and drawing are never held up for more than half a frame */
+#define SCAN_TIME_SLICE 8000
+
+/* lines scanned between looking at the clock */
+#define SCAN_LINES_PER_CHECK 64
+
+/* rows a line wraps onto before it is cut, so a single line of
+ * pathological length cannot hold up the main loop */
+#define LINE_MAX_ROWS 1000
+
+/* alpha of the highlighted matches, the current one is highlighted twice */
+#define HIGHLIGHT_ALPHA 0.4
+
+/* rows dropped from the top of the scrollback before the index is pruned */
+#define INDEX_PRUNE_ROWS 10000
+
+/* longest scrollback that is indexed, the postings of an unlimited one
+ * would grow without bound */
+#define INDEX_MAX_ROWS 100000
+
+/* the ascii case folded trigram at @p, as index key, the bytes are
+ * unsigned so those of utf-8 sequences do not spill into the others */
+#define TRIGRAM(p) GUINT_TO_POINTER (((guint32) (guchar) g_ascii_tolower ((p)[0]) << 16) \
+                                     | ((guint32) (guchar) g_ascii_tolower ((p)[1]) << 8) \
+                                     | (guint32) (guchar) g_ascii_tolower ((p)[2]))
+
+
+
+/* Property identifiers */
+enum
+{
+  PROP_0,
+  PROP_INDEXED,
+  N_PROPERTIES
+};
+
+/* Signal identifiers */
+enum
+{
+  CHANGED,
+  LAST_SIGNAL,
+};
+
+
+
+typedef struct _TerminalSearchMatch TerminalSearchMatch;
+
+
+
+static void
+terminal_search_finalize (GObject *object);
+static void
+terminal_search_set_property (GObject *object,
+                              guint prop_id,
+                              const GValue *value,
+                              GParamSpec *pspec);
+static void
+terminal_search_clear (TerminalSearch *search);
+static glong
+terminal_search_find_row (TerminalSearch *search,
+                          glong row);
+static glong
+terminal_search_get_width (const gchar *start,
+                           const gchar *end);
+static gchar *
+terminal_search_get_row_text (TerminalSearch *search,
+                              glong row,
+                              gsize *length);
+static gchar *
+terminal_search_get_line_text (TerminalSearch *search,
+                               glong row,
+                               glong end_row,
+                               glong *n_rows,
+                               gboolean *ended,
+                               gsize *length);
+static glong
+terminal_search_find_line_start (TerminalSearch *search,
+                                 glong row,
+                                 glong lower);
+static glong
+terminal_search_scan_line (TerminalSearch *search,
+                           glong row,
+                           glong end_row);
+static gboolean
+terminal_search_scan (gpointer data);
+static void
+terminal_search_contents_changed (TerminalSearch *search);
+static gboolean
+terminal_search_index_allowed (TerminalSearch *search);
+static void
+terminal_search_index_update (TerminalSearch *search);
+static void
+terminal_search_index_clear (TerminalSearch *search);
+static glong
+terminal_search_index_line (TerminalSearch *search,
+                            glong row,
+                            glong end_row);
+static void
+terminal_search_index_prune (TerminalSearch *search,
+                             glong lower);
+static gboolean
+terminal_search_index (gpointer data);
+static GArray *
+terminal_search_index_lookup (TerminalSearch *search,
+                              const gchar *literal,
+                              guint32 flags);
+static void
+terminal_search_draw_match (cairo_t *cr,
+                            const TerminalSearchMatch *match,
+                            glong columns,
+                            gdouble top,
+                            const GtkBorder *padding,
+                            glong char_width,
+                            glong char_height);
+static gboolean
+terminal_search_draw (GtkWidget *widget,
+                      cairo_t *cr,
+                      TerminalSearch *search);
+
+
+
+struct _TerminalSearch
+{
+  GObject parent_instance;
+
+  /* weak, the search lives as long as the screen of the terminal */
+  VteTerminal *terminal;
+
+  /* the pattern code was compiled from, with its options */
+  gchar *pattern;
+  guint32 flags;
+
+  pcre2_code_8 *code;
+  pcre2_match_data_8 *match_data;
+
+  /* matches in the lines above next_row, ordered by position */
+  GArray *matches;
+  glong next_row;
+
+  /* the match made current by terminal_search_find(), or -1, and a
+   * find waiting for the scan to get far enough */
+  glong current;
+  guint find_pending : 1;
+  guint find_backwards : 1;
+  guint find_wrap_around : 1;
+
+  /* lines the index says may match, scanned before next_row */
+  GArray *candidates;
+  guint next_candidate;
+
+  guint scan_id;
+
+  /* width the rows were wrapped at when scanned and indexed */
+  glong columns;
+
+  /* optional trigram index of the scrollback: the lines above
+   * indexed_row are in the sorted lists of all their trigrams, by the
+   * row they start at, as 32 bit offset from pruned_row */
+  gboolean indexed;
+  GHashTable *index;
+  glong indexed_row;
+  glong pruned_row;
+  guint index_id;
+};
+
+/* a match wider than the rest of its row continues on the next rows,
+ * like the line it is in */
+struct _TerminalSearchMatch
+{
+  glong row;
+  glong column;
+  glong columns;
+};
+
+
+
+static guint search_signals[LAST_SIGNAL];
+static GParamSpec *search_props[N_PROPERTIES] = {
+  NULL,
+};
+
+
+
+G_DEFINE_TYPE (TerminalSearch, terminal_search, G_TYPE_OBJECT)
+
+
+
+static void
+terminal_search_class_init (TerminalSearchClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_search_finalize;
+  gobject_class->set_property = terminal_search_set_property;
+
+  /**
+   * TerminalSearch:indexed:
+   *
+   * Whether the scrollback is indexed while output arrives, so literal
+   * searches only have to look at the rows that may contain them. A
+   * scrollback of more than 100000 lines, or an unlimited one, is not.
+   **/
+  search_props[PROP_INDEXED] =
+    g_param_spec_boolean ("indexed",
+                          "indexed",
+                          "indexed",
+                          FALSE,
+                          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (gobject_class, N_PROPERTIES, search_props);
+
+  /**
+   * TerminalSearch::changed:
+   * @search : A #TerminalSearch.
+   *
+   * Emitted when the number of matches, the current match or the
+   * progress of the scan changed.
+   **/
+  search_signals[CHANGED] = g_signal_new (I_ ("changed"),
+                                          G_TYPE_FROM_CLASS (gobject_class),
+                                          G_SIGNAL_RUN_LAST,
+                                          0, NULL, NULL,
+                                          g_cclosure_marshal_VOID__VOID,
+                                          G_TYPE_NONE, 0);
+}
+
+
+
+static void
+terminal_search_init (TerminalSearch *search)
+{
+  search->matches = g_array_new (FALSE, FALSE, sizeof (TerminalSearchMatch));
+  search->current = -1;
+  search->index = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+}
+
+
+
+static void
+terminal_search_finalize (GObject *object)
+{
+  TerminalSearch *search = TERMINAL_SEARCH (object);
+
+  terminal_search_clear (search);
+  g_array_free (search->matches, TRUE);
+
+  if (search->index_id != 0)
+    g_source_remove (search->index_id);
+  g_hash_table_destroy (search->index);
+
+  if (search->terminal != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (search->terminal), (gpointer *) &search->terminal);
+
+  (*G_OBJECT_CLASS (terminal_search_parent_class)->finalize) (object);
+}
+
+
+
+static void
+terminal_search_set_property (GObject *object,
+                              guint prop_id,
+                              const GValue *value,
+                              GParamSpec *pspec)
+{
+  TerminalSearch *search = TERMINAL_SEARCH (object);
+
+  switch (prop_id)
+    {
+    case PROP_INDEXED:
+      search->indexed = g_value_get_boolean (value);
+      terminal_search_index_update (search);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+
+
+static void
+terminal_search_clear (TerminalSearch *search)
+{
+  if (search->scan_id != 0)
+    {
+      g_source_remove (search->scan_id);
+      search->scan_id = 0;
+    }
+
+  if (search->match_data != NULL)
+    {
+      pcre2_match_data_free_8 (search->match_data);
+      search->match_data = NULL;
+    }
+
+  if (search->code != NULL)
+    {
+      pcre2_code_free_8 (search->code);
+      search->code = NULL;
+    }
+
+  if (search->candidates != NULL)
+    {
+      g_array_unref (search->candidates);
+      search->candidates = NULL;
+    }
+
+  g_free (search->pattern);
+  search->pattern = NULL;
+  search->flags = 0;
+
+  g_array_set_size (search->matches, 0);
+  search->current = -1;
+  search->find_pending = FALSE;
+}
+
+
+
+/* index of the first match at or below @row */
+static glong
+terminal_search_find_row (TerminalSearch *search,
+                          glong row)
+{
+  glong lower = 0;
+  glong upper = search->matches->len;
+  glong middle;
+
+  while (lower < upper)
+    {
+      middle = (lower + upper) / 2;
+      if (g_array_index (search->matches, TerminalSearchMatch, middle).row < row)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower;
+}
+
+
+
+static glong
+terminal_search_get_width (const gchar *start,
+                           const gchar *end)
+{
+  gunichar c;
+  glong width = 0;
+
+  for (; start < end; start = g_utf8_next_char (start))
+    {
+      c = g_utf8_get_char (start);
+      if (!g_unichar_iszerowidth (c))
+        width += g_unichar_iswide (c) ? 2 : 1;
+    }
+
+  return width;
+}
+
+
+
+static gchar *
+terminal_search_get_row_text (TerminalSearch *search,
+                              glong row,
+                              gsize *length)
+{
+  gchar *text;
+
+#if VTE_CHECK_VERSION(0, 72, 0)
+  text = vte_terminal_get_text_range_format (search->terminal, VTE_FORMAT_TEXT,
+                                             row, 0, row, vte_terminal_get_column_count (search->terminal) - 1,
+                                             length);
+#else
+  text = vte_terminal_get_text_range (search->terminal,
+                                      row, 0, row, vte_terminal_get_column_count (search->terminal) - 1,
+                                      NULL, NULL, NULL);
+  *length = (text != NULL) ? strlen (text) : 0;
+#endif
+
+  return text;
+}
+
+
+
+/* the text of the logical line at @row, up to the first row that does
+ * not wrap onto the next one or @end_row, without its line end */
+static gchar *
+terminal_search_get_line_text (TerminalSearch *search,
+                               glong row,
+                               glong end_row,
+                               glong *n_rows,
+                               gboolean *ended,
+                               gsize *length)
+{
+  GString *line = g_string_new (NULL);
+  gchar *text;
+  gsize row_length;
+
+  *n_rows = 0;
+  *ended = FALSE;
+
+  while (!*ended && row + *n_rows < end_row)
+    {
+      text = terminal_search_get_row_text (search, row + (*n_rows)++, &row_length);
+
+      /* vte ends the text of a row with a newline unless it wraps */
+      *ended = text == NULL || row_length == 0 || text[row_length - 1] == '\n' || *n_rows == LINE_MAX_ROWS;
+      if (G_LIKELY (text != NULL))
+        g_string_append_len (line, text, row_length);
+      g_free (text);
+    }
+
+  if (line->len > 0 && line->str[line->len - 1] == '\n')
+    g_string_truncate (line, line->len - 1);
+
+  *length = line->len;
+
+  return g_string_free (line, FALSE);
+}
+
+
+
+/* the first row of the logical line @row belongs to */
+static glong
+terminal_search_find_line_start (TerminalSearch *search,
+                                 glong row,
+                                 glong lower)
+{
+  gchar *text;
+  gsize length;
+  gboolean wraps;
+  glong n;
+
+  for (n = 0; row > lower && n < LINE_MAX_ROWS; n++)
+    {
+      text = terminal_search_get_row_text (search, row - 1, &length);
+      wraps = text != NULL && length > 0 && text[length - 1] != '\n';
+      g_free (text);
+
+      if (!wraps)
+        break;
+      row--;
+    }
+
+  return row;
+}
+
+
+
+/* scans the logical line at @row, returns the number of rows it takes */
+static glong
+terminal_search_scan_line (TerminalSearch *search,
+                           glong row,
+                           glong end_row)
+{
+  TerminalSearchMatch match;
+  PCRE2_SIZE *ovector;
+  const gchar *position;
+  gchar *text;
+  gsize length;
+  gsize offset = 0;
+  gboolean ended;
+  glong n_rows;
+  glong cell = 0;
+
+  text = terminal_search_get_line_text (search, row, end_row, &n_rows, &ended, &length);
+
+  position = text;
+  ovector = pcre2_get_ovector_pointer_8 (search->match_data);
+
+  while (offset < length
+         && pcre2_match_8 (search->code, (PCRE2_SPTR8) text, length, offset, 0, search->match_data, NULL) > 0)
+    {
+      /* empty matches cannot be highlighted, retry one character later */
+      if (ovector[1] == ovector[0])
+        {
+          offset = g_utf8_next_char (text + ovector[0]) - text;
+          continue;
+        }
+
+      /* the text has one character per cell, but wide ones take two, and
+       * the rows of the line are all as wide as the terminal */
+      cell += terminal_search_get_width (position, text + ovector[0]);
+      match.row = row + cell / search->columns;
+      match.column = cell % search->columns;
+      match.columns = terminal_search_get_width (text + ovector[0], text + ovector[1]);
+      g_array_append_val (search->matches, match);
+
+      position = text + ovector[1];
+      cell += match.columns;
+      offset = ovector[1];
+    }
+
+  g_free (text);
+
+  return n_rows;
+}
+
+
+
+static gboolean
+terminal_search_scan (gpointer data)
+{
+  TerminalSearch *search = TERMINAL_SEARCH (data);
+  GtkAdjustment *adjustment;
+  gint64 deadline = g_get_monotonic_time () + SCAN_TIME_SLICE;
+  guint n_matches = search->matches->len;
+  glong lower;
+  glong end_row;
+  glong row;
+  guint n;
+
+  if (G_UNLIKELY (search->terminal == NULL))
+    {
+      search->scan_id = 0;
+      return FALSE;
+    }
+
+  /* new output extends the scan while it is running */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  lower = gtk_adjustment_get_lower (adjustment);
+  end_row = gtk_adjustment_get_upper (adjustment);
+
+  /* the indexed rows that may match come first, they are all above next_row */
+  while (search->candidates != NULL && g_get_monotonic_time () < deadline)
+    {
+      for (n = 0; n < SCAN_LINES_PER_CHECK && search->next_candidate < search->candidates->len; n++)
+        {
+          row = g_array_index (search->candidates, glong, search->next_candidate++);
+          if (row >= lower)
+            terminal_search_scan_line (search, row, end_row);
+        }
+
+      if (search->next_candidate >= search->candidates->len)
+        {
+          g_array_unref (search->candidates);
+          search->candidates = NULL;
+        }
+    }
+
+  while (search->candidates == NULL && search->next_row < end_row && g_get_monotonic_time () < deadline)
+    for (n = 0; n < SCAN_LINES_PER_CHECK && search->next_row < end_row; n++)
+      search->next_row += terminal_search_scan_line (search, search->next_row, end_row);
+
+  if (search->matches->len != n_matches)
+    gtk_widget_queue_draw (GTK_WIDGET (search->terminal));
+
+  if (search->candidates == NULL && search->next_row >= end_row)
+    search->scan_id = 0;
+
+  /* the scan got to the match the find was waiting for */
+  if (search->find_pending && (search->matches->len != n_matches || search->scan_id == 0))
+    terminal_search_find (search, search->find_backwards, search->find_wrap_around);
+
+  g_signal_emit (G_OBJECT (search), search_signals[CHANGED], 0);
+
+  return search->scan_id != 0;
+}
+
+
+
+static void
+terminal_search_contents_changed (TerminalSearch *search)
+{
+  GtkAdjustment *adjustment;
+  glong lower;
+  glong first_screen_row;
+  glong n;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  lower = gtk_adjustment_get_lower (adjustment);
+  first_screen_row = gtk_adjustment_get_upper (adjustment) - vte_terminal_get_row_count (search->terminal);
+
+  /* rewrapping on resize renumbers all rows, and a reset or cleared
+   * scrollback leaves indexed rows behind, so start over */
+  if (search->columns != vte_terminal_get_column_count (search->terminal)
+      || search->indexed_row > first_screen_row)
+    {
+      search->columns = vte_terminal_get_column_count (search->terminal);
+      terminal_search_index_clear (search);
+      if (search->candidates != NULL)
+        {
+          g_array_unref (search->candidates);
+          search->candidates = NULL;
+        }
+      g_array_set_size (search->matches, 0);
+      search->current = -1;
+      search->next_row = lower;
+    }
+
+  /* index the rows that scrolled off the screen */
+  if (search->index_id == 0 && search->indexed_row < first_screen_row && terminal_search_index_allowed (search))
+    search->index_id = g_idle_add (terminal_search_index, search);
+
+  if (search->code == NULL)
+    return;
+
+  /* forget the matches in scrollback that dropped off the top */
+  n = terminal_search_find_row (search, lower);
+  if (n > 0)
+    {
+      g_array_remove_range (search->matches, 0, n);
+      search->current = search->current >= n ? search->current - n : -1;
+    }
+
+  /* the scrollback does not change, but the rows on screen can, so
+   * these are scanned again from the start of their first line, just
+   * like a reset or cleared scrollback */
+  if (search->next_row > first_screen_row)
+    {
+      search->next_row = terminal_search_find_line_start (search, MAX (first_screen_row, lower), lower);
+      g_array_set_size (search->matches, terminal_search_find_row (search, search->next_row));
+      if (search->current >= (glong) search->matches->len)
+        search->current = -1;
+    }
+  else if (search->next_row < lower)
+    search->next_row = lower;
+
+  if (search->scan_id == 0)
+    search->scan_id = g_idle_add (terminal_search_scan, search);
+}
+
+
+
+static gboolean
+terminal_search_index_allowed (TerminalSearch *search)
+{
+  guint scrollback_lines;
+
+  if (!search->indexed || search->terminal == NULL)
+    return FALSE;
+
+  /* unlimited is G_MAXUINT */
+  g_object_get (G_OBJECT (search->terminal), "scrollback-lines", &scrollback_lines, NULL);
+
+  return scrollback_lines <= INDEX_MAX_ROWS;
+}
+
+
+
+static void
+terminal_search_index_update (TerminalSearch *search)
+{
+  if (!terminal_search_index_allowed (search))
+    terminal_search_index_clear (search);
+  else if (search->index_id == 0)
+    {
+      /* index what is already in the scrollback */
+      search->index_id = g_idle_add (terminal_search_index, search);
+    }
+}
+
+
+
+static void
+terminal_search_index_clear (TerminalSearch *search)
+{
+  if (search->index_id != 0)
+    {
+      g_source_remove (search->index_id);
+      search->index_id = 0;
+    }
+
+  g_hash_table_remove_all (search->index);
+  search->indexed_row = 0;
+  search->pruned_row = 0;
+}
+
+
+
+/* indexes the logical line at @row by the row it starts at, returns the
+ * number of rows it takes or 0 if it continues on screen */
+static glong
+terminal_search_index_line (TerminalSearch *search,
+                            glong row,
+                            glong end_row)
+{
+  GArray *rows;
+  gchar *text;
+  gsize length;
+  gsize n;
+  gboolean ended;
+  glong n_rows;
+  guint32 offset = row - search->pruned_row;
+
+  text = terminal_search_get_line_text (search, row, end_row, &n_rows, &ended, &length);
+
+  /* the rest of the line may still change */
+  if (!ended)
+    {
+      g_free (text);
+      return 0;
+    }
+
+  for (n = 0; n + 3 <= length; n++)
+    {
+      rows = g_hash_table_lookup (search->index, TRIGRAM (text + n));
+      if (rows == NULL)
+        {
+          rows = g_array_new (FALSE, FALSE, sizeof (guint32));
+          g_hash_table_insert (search->index, TRIGRAM (text + n), rows);
+        }
+
+      /* a trigram can occur more than once in a line */
+      if (rows->len == 0 || g_array_index (rows, guint32, rows->len - 1) != offset)
+        g_array_append_val (rows, offset);
+    }
+
+  g_free (text);
+
+  return n_rows;
+}
+
+
+
+static void
+terminal_search_index_prune (TerminalSearch *search,
+                             glong lower)
+{
+  GHashTableIter iter;
+  GArray *rows;
+  guint32 shift = lower - search->pruned_row;
+  guint32 *offsets;
+  guint n;
+
+  g_hash_table_iter_init (&iter, search->index);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &rows))
+    {
+      for (n = 0; n < rows->len && g_array_index (rows, guint32, n) < shift; n++)
+        ;
+
+      if (n == rows->len)
+        {
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+
+      if (n > 0)
+        g_array_remove_range (rows, 0, n);
+
+      /* the offsets of the rows left are rebased on lower, so they
+       * never outgrow 32 bits */
+      offsets = (guint32 *) (gpointer) rows->data;
+      for (n = 0; n < rows->len; n++)
+        offsets[n] -= shift;
+    }
+
+  search->pruned_row = lower;
+}
+
+
+
+static gboolean
+terminal_search_index (gpointer data)
+{
+  TerminalSearch *search = TERMINAL_SEARCH (data);
+  GtkAdjustment *adjustment;
+  gint64 deadline = g_get_monotonic_time () + SCAN_TIME_SLICE;
+  glong lower;
+  glong first_screen_row;
+  glong n_rows = 1;
+  guint n;
+
+  if (G_UNLIKELY (search->terminal == NULL))
+    {
+      search->index_id = 0;
+      return FALSE;
+    }
+
+  /* only the scrollback is indexed, the rows on screen still change */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  lower = gtk_adjustment_get_lower (adjustment);
+  first_screen_row = gtk_adjustment_get_upper (adjustment) - vte_terminal_get_row_count (search->terminal);
+
+  if (search->indexed_row < lower)
+    {
+      /* the offsets of a new index start at the top of the scrollback */
+      if (g_hash_table_size (search->index) == 0)
+        search->pruned_row = lower;
+      search->indexed_row = lower;
+    }
+
+  while (n_rows > 0 && search->indexed_row < first_screen_row && g_get_monotonic_time () < deadline)
+    for (n = 0; n < SCAN_LINES_PER_CHECK && n_rows > 0 && search->indexed_row < first_screen_row; n++)
+      {
+        n_rows = terminal_search_index_line (search, search->indexed_row, first_screen_row);
+        search->indexed_row += n_rows;
+      }
+
+  /* drop the rows that fell off the top of a limited scrollback */
+  if (lower - search->pruned_row >= INDEX_PRUNE_ROWS)
+    terminal_search_index_prune (search, lower);
+
+  /* a line running onto the screen is indexed once it scrolled off */
+  if (n_rows == 0 || search->indexed_row >= first_screen_row)
+    search->index_id = 0;
+
+  return search->index_id != 0;
+}
+
+
+
+static GArray *
+terminal_search_index_lookup (TerminalSearch *search,
+                              const gchar *literal,
+                              guint32 flags)
+{
+  GArray *candidates;
+  GArray *shortest = NULL;
+  GArray **lists;
+  GArray *rows;
+  glong row;
+  guint32 offset;
+  gsize length;
+  gsize n_lists;
+  gsize n;
+  guint i;
+  guint lo;
+  guint hi;
+
+  if (literal == NULL || !terminal_search_index_allowed (search))
+    return NULL;
+
+  /* the index folds the case of ascii only */
+  length = strlen (literal);
+  if (length < 3 || ((flags & PCRE2_CASELESS) != 0 && !g_str_is_ascii (literal)))
+    return NULL;
+
+  n_lists = length - 2;
+  lists = g_new (GArray *, n_lists);
+  candidates = g_array_new (FALSE, FALSE, sizeof (glong));
+
+  for (n = 0; n < n_lists; n++)
+    {
+      lists[n] = g_hash_table_lookup (search->index, TRIGRAM (literal + n));
+      if (lists[n] == NULL)
+        {
+          /* no indexed row can contain the literal */
+          g_free (lists);
+          return candidates;
+        }
+
+      if (shortest == NULL || lists[n]->len < shortest->len)
+        shortest = lists[n];
+    }
+
+  /* keep the rows of the shortest list that are in all others */
+  for (i = 0; i < shortest->len; i++)
+    {
+      offset = g_array_index (shortest, guint32, i);
+
+      for (n = 0; n < n_lists; n++)
+        {
+          rows = lists[n];
+          if (rows == shortest)
+            continue;
+
+          for (lo = 0, hi = rows->len; lo < hi;)
+            {
+              if (g_array_index (rows, guint32, (lo + hi) / 2) < offset)
+                lo = (lo + hi) / 2 + 1;
+              else
+                hi = (lo + hi) / 2;
+            }
+
+          if (lo == rows->len || g_array_index (rows, guint32, lo) != offset)
+            break;
+        }
+
+      if (n == n_lists)
+        {
+          row = search->pruned_row + offset;
+          g_array_append_val (candidates, row);
+        }
+    }
+
+  g_free (lists);
+
+  return candidates;
+}
+
+
+
+static void
+terminal_search_draw_match (cairo_t *cr,
+                            const TerminalSearchMatch *match,
+                            glong columns,
+                            gdouble top,
+                            const GtkBorder *padding,
+                            glong char_width,
+                            glong char_height)
+{
+  glong row = match->row;
+  glong column = match->column;
+  glong remaining = match->columns;
+  glong n;
+
+  /* one rectangle for each row the match wraps onto */
+  while (remaining > 0)
+    {
+      n = MIN (remaining, columns - column);
+      cairo_rectangle (cr,
+                       padding->left + column * char_width,
+                       padding->top + (row - top) * char_height,
+                       n * char_width, char_height);
+
+      remaining -= n;
+      column = 0;
+      row++;
+    }
+}
+
+
+
+static gboolean
+terminal_search_draw (GtkWidget *widget,
+                      cairo_t *cr,
+                      TerminalSearch *search)
+{
+  const TerminalSearchMatch *match;
+  GtkStyleContext *context;
+  GtkAdjustment *adjustment;
+  GtkBorder padding;
+  GdkRGBA color;
+  gdouble top;
+  glong bottom;
+  glong char_width;
+  glong char_height;
+  glong n;
+
+  if (search->matches->len == 0)
+    return FALSE;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (widget));
+  top = gtk_adjustment_get_value (adjustment);
+  bottom = top + vte_terminal_get_row_count (VTE_TERMINAL (widget)) + 1;
+
+  char_width = vte_terminal_get_char_width (VTE_TERMINAL (widget));
+  char_height = vte_terminal_get_char_height (VTE_TERMINAL (widget));
+
+  /* vte draws the cells inside the css padding */
+  context = gtk_widget_get_style_context (widget);
+  gtk_style_context_get_padding (context, gtk_widget_get_state_flags (widget), &padding);
+  if (!gtk_style_context_lookup_color (context, "theme_selected_bg_color", &color))
+    gdk_rgba_parse (&color, "#3584e4");
+
+  /* include the matches above the view that wrap into it */
+  n = terminal_search_find_row (search, top);
+  for (; n > 0; n--)
+    {
+      match = &g_array_index (search->matches, TerminalSearchMatch, n - 1);
+      if (match->row + (match->column + match->columns - 1) / search->columns < top)
+        break;
+    }
+
+  for (; n < (glong) search->matches->len; n++)
+    {
+      match = &g_array_index (search->matches, TerminalSearchMatch, n);
+      if (match->row >= bottom)
+        break;
+
+      terminal_search_draw_match (cr, match, search->columns, top, &padding, char_width, char_height);
+    }
+
+  cairo_set_source_rgba (cr, color.red, color.green, color.blue, HIGHLIGHT_ALPHA);
+  cairo_fill (cr);
+
+  if (search->current >= 0)
+    {
+      match = &g_array_index (search->matches, TerminalSearchMatch, search->current);
+      terminal_search_draw_match (cr, match, search->columns, top, &padding, char_width, char_height);
+      cairo_fill (cr);
+    }
+
+  return FALSE;
+}
+
+
+
+/**
+ * terminal_search_new:
+ * @terminal : A #VteTerminal.
+ *
+ * Creates a search that highlights all matches in @terminal.
+ *
+ * Return value: A new #TerminalSearch.
+ **/
+TerminalSearch *
+terminal_search_new (VteTerminal *terminal)
+{
+  TerminalSearch *search;
+
+  g_return_val_if_fail (VTE_IS_TERMINAL (terminal), NULL);
+
+  search = g_object_new (TERMINAL_TYPE_SEARCH, NULL);
+  search->terminal = terminal;
+  search->columns = vte_terminal_get_column_count (terminal);
+  g_object_add_weak_pointer (G_OBJECT (terminal), (gpointer *) &search->terminal);
+
+  g_signal_connect_object (G_OBJECT (terminal), "contents-changed",
+                           G_CALLBACK (terminal_search_contents_changed), search, G_CONNECT_SWAPPED);
+  g_signal_connect_object (G_OBJECT (terminal), "notify::scrollback-lines",
+                           G_CALLBACK (terminal_search_index_update), search, G_CONNECT_SWAPPED);
+  g_signal_connect_object (G_OBJECT (terminal), "draw",
+                           G_CALLBACK (terminal_search_draw), search, G_CONNECT_AFTER);
+
+  return search;
+}
+
+
+
+/**
+ * terminal_search_set_pattern:
+ * @search  : A #TerminalSearch.
+ * @pattern : The pcre2 pattern to highlight, or %NULL to stop.
+ * @flags   : Compile options for @pattern.
+ * @literal : The text @pattern matches literally, or %NULL.
+ * @error   : Return location for errors or %NULL.
+ *
+ * Starts looking for @pattern in the scrollback and screen of the
+ * terminal. The lines are scanned in slices from an idle source, so a
+ * large scrollback never blocks the main loop for long, and the
+ * ::changed signal is emitted as matches are found. With an index and
+ * a @literal of at least three bytes, only the indexed lines containing
+ * all trigrams of @literal are scanned. Nothing changes if @pattern and
+ * @flags are those of the search already.
+ *
+ * Return value: %FALSE if @pattern does not compile.
+ **/
+gboolean
+terminal_search_set_pattern (TerminalSearch *search,
+                             const gchar *pattern,
+                             guint32 flags,
+                             const gchar *literal,
+                             GError **error)
+{
+  GtkAdjustment *adjustment;
+  PCRE2_UCHAR8 message[256];
+  PCRE2_SIZE error_offset;
+  gint error_number;
+
+  g_return_val_if_fail (TERMINAL_IS_SEARCH (search), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (search->code != NULL && g_strcmp0 (pattern, search->pattern) == 0 && flags == search->flags)
+    return TRUE;
+
+  terminal_search_clear (search);
+
+  if (pattern != NULL && search->terminal != NULL)
+    {
+      search->code = pcre2_compile_8 ((PCRE2_SPTR8) pattern, PCRE2_ZERO_TERMINATED, flags,
+                                      &error_number, &error_offset, NULL);
+      if (G_UNLIKELY (search->code == NULL))
+        {
+          pcre2_get_error_message_8 (error_number, message, sizeof (message));
+          g_set_error_literal (error, G_REGEX_ERROR, G_REGEX_ERROR_COMPILE, (const gchar *) message);
+          g_signal_emit (G_OBJECT (search), search_signals[CHANGED], 0);
+          return FALSE;
+        }
+
+      /* the interpreter is used if jit is not available */
+      pcre2_jit_compile_8 (search->code, PCRE2_JIT_COMPLETE);
+      search->match_data = pcre2_match_data_create_from_pattern_8 (search->code, NULL);
+      search->pattern = g_strdup (pattern);
+      search->flags = flags;
+
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+      search->next_row = gtk_adjustment_get_lower (adjustment);
+
+      /* the index covers everything above indexed_row */
+      search->candidates = terminal_search_index_lookup (search, literal, flags);
+      search->next_candidate = 0;
+      if (search->candidates != NULL)
+        search->next_row = MAX (search->next_row, search->indexed_row);
+
+      search->scan_id = g_idle_add (terminal_search_scan, search);
+    }
+
+  if (search->terminal != NULL)
+    gtk_widget_queue_draw (GTK_WIDGET (search->terminal));
+
+  g_signal_emit (G_OBJECT (search), search_signals[CHANGED], 0);
+
+  return TRUE;
+}
+
+
+
+/**
+ * terminal_search_get_n_matches:
+ * @search : A #TerminalSearch.
+ *
+ * Return value: The number of matches found so far.
+ **/
+guint
+terminal_search_get_n_matches (TerminalSearch *search)
+{
+  g_return_val_if_fail (TERMINAL_IS_SEARCH (search), 0);
+  return search->matches->len;
+}
+
+
+
+/**
+ * terminal_search_get_current:
+ * @search : A #TerminalSearch.
+ *
+ * Return value: The index of the current match, or -1 if there is none.
+ **/
+gint
+terminal_search_get_current (TerminalSearch *search)
+{
+  g_return_val_if_fail (TERMINAL_IS_SEARCH (search), -1);
+  return search->current;
+}
+
+
+
+/**
+ * terminal_search_find:
+ * @search      : A #TerminalSearch.
+ * @backwards   : %TRUE to find the previous match instead of the next.
+ * @wrap_around : Whether to continue at the other end of the terminal.
+ *
+ * Makes the match after or before the current one current and scrolls
+ * it into view. Without a current match, the first one below the top of
+ * the view is found, or the last one above its bottom. If the scan has
+ * not got that far yet, the match is found once it did.
+ **/
+void
+terminal_search_find (TerminalSearch *search,
+                      gboolean backwards,
+                      gboolean wrap_around)
+{
+  const TerminalSearchMatch *match;
+  GtkAdjustment *adjustment;
+  glong n_matches;
+  glong top;
+  glong bottom;
+  glong n;
+
+  g_return_if_fail (TERMINAL_IS_SEARCH (search));
+
+  search->find_pending = FALSE;
+
+  if (search->terminal == NULL || search->code == NULL)
+    return;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  top = gtk_adjustment_get_value (adjustment);
+  bottom = top + vte_terminal_get_row_count (search->terminal);
+  n_matches = search->matches->len;
+
+  if (search->current >= 0)
+    n = search->current + (backwards ? -1 : 1);
+  else if (backwards)
+    n = terminal_search_find_row (search, bottom) - 1;
+  else
+    n = terminal_search_find_row (search, top);
+
+  /* the matches are found from the top down, so only those above
+   * next_row are known to be all there are */
+  if (n < 0 || n >= n_matches
+      || (backwards && search->current < 0 && search->next_row < bottom))
+    {
+      if (!terminal_search_is_done (search))
+        {
+          search->find_pending = TRUE;
+          search->find_backwards = backwards;
+          search->find_wrap_around = wrap_around;
+          return;
+        }
+
+      if (n < 0 || n >= n_matches)
+        {
+          if (!wrap_around || n_matches == 0)
+            return;
+          n = backwards ? n_matches - 1 : 0;
+        }
+    }
+
+  search->current = n;
+
+  match = &g_array_index (search->matches, TerminalSearchMatch, n);
+  if (match->row < top || match->row >= bottom)
+    terminal_search_scroll_to_row (search, match->row);
+
+  gtk_widget_queue_draw (GTK_WIDGET (search->terminal));
+  g_signal_emit (G_OBJECT (search), search_signals[CHANGED], 0);
+}
+
+
+
+/**
+ * terminal_search_is_done:
+ * @search : A #TerminalSearch.
+ *
+ * Return value: %TRUE if all rows have been scanned.
+ **/
+gboolean
+terminal_search_is_done (TerminalSearch *search)
+{
+  g_return_val_if_fail (TERMINAL_IS_SEARCH (search), TRUE);
+  return search->scan_id == 0;
+}
+
+
+
+/**
+ * terminal_search_get_text:
+ * @search    : A #TerminalSearch.
+ * @first_row : Return location for the row the text starts at.
+ * @columns   : Return location for the width the text is wrapped at.
+ * @length    : Return location for the length of the text.
+ *
+ * Takes a snapshot of the scrollback and screen of the terminal, with
+ * a newline at the end of each line, so it can be searched in a thread.
+ *
+ * Return value: The text of the terminal, or %NULL. Free with g_free().
+ **/
+gchar *
+terminal_search_get_text (TerminalSearch *search,
+                          glong *first_row,
+                          glong *columns,
+                          gsize *length)
+{
+  GtkAdjustment *adjustment;
+  gchar *text;
+  glong last_row;
+
+  g_return_val_if_fail (TERMINAL_IS_SEARCH (search), NULL);
+
+  if (search->terminal == NULL)
+    return NULL;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  *first_row = gtk_adjustment_get_lower (adjustment);
+  last_row = gtk_adjustment_get_upper (adjustment) - 1;
+  *columns = vte_terminal_get_column_count (search->terminal);
+
+#if VTE_CHECK_VERSION(0, 72, 0)
+  text = vte_terminal_get_text_range_format (search->terminal, VTE_FORMAT_TEXT,
+                                             *first_row, 0, last_row, *columns - 1,
+                                             length);
+#else
+  text = vte_terminal_get_text_range (search->terminal,
+                                      *first_row, 0, last_row, *columns - 1,
+                                      NULL, NULL, NULL);
+  *length = (text != NULL) ? strlen (text) : 0;
+#endif
+
+  return text;
+}
+
+
+
+/**
+ * terminal_search_scroll_to_row:
+ * @search : A #TerminalSearch.
+ * @row    : The row to show.
+ *
+ * Scrolls the terminal so @row is in the middle of the screen.
+ **/
+void
+terminal_search_scroll_to_row (TerminalSearch *search,
+                               glong row)
+{
+  GtkAdjustment *adjustment;
+
+  g_return_if_fail (TERMINAL_IS_SEARCH (search));
+
+  if (search->terminal == NULL)
+    return;
+
+  /* the adjustment clamps the value to the scrollback */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (search->terminal));
+  gtk_adjustment_set_value (adjustment, row - vte_terminal_get_row_count (search->terminal) / 2);
+}
@@ -0,0 +1,64 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SEARCH_H
+#define TERMINAL_SEARCH_H
+
+#include "terminal-private.h"
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_SEARCH (terminal_search_get_type ())
+G_DECLARE_FINAL_TYPE (TerminalSearch, terminal_search, TERMINAL, SEARCH, GObject)
+
+TerminalSearch *
+terminal_search_new (VteTerminal *terminal);
+
+gboolean
+terminal_search_set_pattern (TerminalSearch *search,
+                             const gchar *pattern,
+                             guint32 flags,
+                             const gchar *literal,
+                             GError **error);
+
+guint
+terminal_search_get_n_matches (TerminalSearch *search);
+
+gint
+terminal_search_get_current (TerminalSearch *search);
+
+void
+terminal_search_find (TerminalSearch *search,
+                      gboolean backwards,
+                      gboolean wrap_around);
+
+gboolean
+terminal_search_is_done (TerminalSearch *search);
+
+gchar *
+terminal_search_get_text (TerminalSearch *search,
+                          glong *first_row,
+                          glong *columns,
+                          gsize *length);
+
+void
+terminal_search_scroll_to_row (TerminalSearch *search,
+                               glong row);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SEARCH_H */
@@ -258,3 +258,17 @@ cleanup:
   return cwd;
 #endif
 }
+
+
+
+/**
+ * terminal_util_get_default_log_directory:
+ *
+ * Return value: The directory of the tab logs when the misc-log-directory
+ *               preference is empty.
+ **/
+gchar *
+terminal_util_get_default_log_directory (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "xfce4", "terminal", "logs", NULL);
+}
@@ -35,6 +35,9 @@ terminal_util_free_data (gpointer data,
 gchar *
 terminal_util_get_process_cwd (GPid pid);
 
+gchar *
+terminal_util_get_default_log_directory (void);
+
 G_END_DECLS
 
 #endif /* !TERMINAL_UTIL_H */
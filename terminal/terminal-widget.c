@@ -41,6 +41,9 @@
 
 #define MAILTO "mailto:"
 
+/* number of classified links remembered before starting over */
+#define MAX_CLASSIFIED_LINKS 256
+
 
 
 enum
@@ -70,6 +73,7 @@ enum
 typedef struct
 {
   const gchar *pattern;
+  const gchar *group;
   PatternType type;
 } TerminalRegexPattern;
 
@@ -79,12 +83,15 @@ typedef struct
   PatternType type;
 } TerminalHyperlink;
 
+typedef struct _TerminalRegexRegistry TerminalRegexRegistry;
+
+/* the alternatives of REGEX_URL_ANY with the names of their groups, in the same order */
 static const TerminalRegexPattern regex_patterns[] = {
-  { REGEX_URL_AS_IS, PATTERN_TYPE_FULL_HTTP },
-  { REGEX_URL_HTTP, PATTERN_TYPE_HTTP },
-  { REGEX_URL_FILE, PATTERN_TYPE_FILE },
-  { REGEX_EMAIL, PATTERN_TYPE_EMAIL },
-  { REGEX_NEWS_MAN, PATTERN_TYPE_FULL_HTTP },
+  { REGEX_URL_AS_IS, "URL_AS_IS", PATTERN_TYPE_FULL_HTTP },
+  { REGEX_URL_HTTP, "URL_HTTP", PATTERN_TYPE_HTTP },
+  { REGEX_URL_FILE, "URL_FILE", PATTERN_TYPE_FILE },
+  { REGEX_EMAIL, "EMAIL", PATTERN_TYPE_EMAIL },
+  { REGEX_NEWS_MAN, "NEWS_MAN", PATTERN_TYPE_FULL_HTTP },
 };
 
 
@@ -110,12 +117,24 @@ terminal_widget_drag_data_received (GtkWidget *widget,
 static gboolean
 terminal_widget_key_press_event (GtkWidget *widget,
                                  GdkEventKey *event);
+static gboolean
+terminal_widget_key_release_event (GtkWidget *widget,
+                                   GdkEventKey *event);
+static gboolean
+terminal_widget_focus_out_event (GtkWidget *widget,
+                                 GdkEventFocus *event);
+static gboolean
+terminal_widget_draw (GtkWidget *widget,
+                      cairo_t *cr);
 static void
 terminal_widget_open_uri (TerminalWidget *widget,
                           const gchar *wlink,
                           PatternType type);
 static void
 terminal_widget_update_highlight_urls (TerminalWidget *widget);
+static void
+terminal_widget_set_url_matcher (TerminalWidget *widget,
+                                 gboolean enabled);
 static gboolean
 terminal_widget_action_shift_scroll_up (TerminalWidget *widget);
 static gboolean
@@ -138,6 +157,26 @@ static void
 terminal_widget_hyperlink_hover_uri_changed (TerminalWidget *widget,
                                              const char *uri,
                                              const GdkRectangle *bbox G_GNUC_UNUSED);
+static void
+terminal_widget_regex_registry_ref (void);
+static void
+terminal_widget_regex_registry_unref (void);
+static VteRegex *
+terminal_widget_regex_new_match (const gchar *pattern);
+static VteRegex *
+terminal_widget_regex_get_match (void);
+static pcre2_code_8 *
+terminal_widget_regex_get_whole (void);
+static pcre2_code_8 *
+terminal_widget_regex_get_code (guint n);
+static void
+terminal_widget_regex_remember (GHashTable *table,
+                                const gchar *text,
+                                PatternType type);
+static PatternType
+terminal_widget_regex_resolve (const gchar *text);
+static PatternType
+terminal_widget_regex_classify (const gchar *text);
 
 
 
@@ -148,14 +187,59 @@ struct _TerminalWidget
   /*< private >*/
   TerminalPreferences *preferences;
   GtkAccelGroup *accel_group;
-  gint regex_tags[G_N_ELEMENTS (regex_patterns)];
-  pcre2_code_8 *regex_pcre[G_N_ELEMENTS (regex_patterns)];
+  gint regex_tag;
+
+  /* cached misc-highlight-urls settings */
+  guint highlight_urls : 1;
+  guint highlight_urls_on_demand : 1;
+
+  /* whether Ctrl is held, to detect urls on demand */
+  guint control_held : 1;
+
+  /* background image painted under vte, and the color shading it */
+  TerminalImageLoader *loader;
+  GdkRGBA background_color;
+};
+
+/* the compiled patterns are identical for all widgets, so they are
+ * built once on first use and shared while any widget is alive */
+struct _TerminalRegexRegistry
+{
+  guint ref_count;
+
+  /* jitted matcher handed to vte for highlighting */
+  VteRegex *match;
+  gboolean match_tried;
+
+  /* the matcher only matching all of a link, to resolve its type from the
+   * group that took part, and the numbers of those groups */
+  pcre2_code_8 *whole;
+  gboolean whole_tried;
+  gint whole_groups[G_N_ELEMENTS (regex_patterns)];
+  pcre2_match_data_8 *whole_match_data;
+
+  /* plain codes to classify OSC 8 hyperlinks */
+  pcre2_code_8 *code[G_N_ELEMENTS (regex_patterns)];
+  gboolean code_tried[G_N_ELEMENTS (regex_patterns)];
+  pcre2_match_data_8 *match_data;
+
+  /* bounds the matches of both, like REGEX_LIMITS does for vte's matcher,
+   * and gives the jitted codes more stack than the default 32 KiB */
+  pcre2_match_context_8 *match_context;
+  pcre2_jit_stack_8 *jit_stack;
+
+  /* types of highlighted links already resolved, and of OSC 8 hyperlinks
+   * already classified */
+  GHashTable *resolved;
+  GHashTable *classified;
 };
 
 
 
 static guint widget_signals[LAST_SIGNAL];
 
+static TerminalRegexRegistry *regex_registry = NULL;
+
 
 
 static const GtkTargetEntry targets[] = {
@@ -241,6 +325,9 @@ terminal_widget_class_init (TerminalWidgetClass *klass)
   gtkwidget_class->button_press_event = terminal_widget_button_press_event;
   gtkwidget_class->drag_data_received = terminal_widget_drag_data_received;
   gtkwidget_class->key_press_event = terminal_widget_key_press_event;
+  gtkwidget_class->key_release_event = terminal_widget_key_release_event;
+  gtkwidget_class->focus_out_event = terminal_widget_focus_out_event;
+  gtkwidget_class->draw = terminal_widget_draw;
 
   xfce_gtk_translate_action_entries (action_entries, G_N_ELEMENTS (action_entries));
 
@@ -295,8 +382,11 @@ terminal_widget_init (TerminalWidget *widget)
   /* query preferences connection */
   widget->preferences = terminal_preferences_get ();
 
-  /* unset tags */
-  memset (widget->regex_tags, -1, sizeof (widget->regex_tags));
+  /* unset tag */
+  widget->regex_tag = -1;
+
+  /* hold the shared regexes */
+  terminal_widget_regex_registry_ref ();
 
   /* setup Drag'n'Drop support */
   gtk_drag_dest_set (GTK_WIDGET (widget),
@@ -307,6 +397,8 @@ terminal_widget_init (TerminalWidget *widget)
   /* monitor the misc-highlight-urls setting */
   g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-highlight-urls",
                             G_CALLBACK (terminal_widget_update_highlight_urls), widget);
+  g_signal_connect_swapped (G_OBJECT (widget->preferences), "notify::misc-highlight-urls-on-demand",
+                            G_CALLBACK (terminal_widget_update_highlight_urls), widget);
 
   /* update tooltip when hovering over a hyperlink */
   g_signal_connect (G_OBJECT (widget), "hyperlink-hover-uri-changed",
@@ -321,16 +413,6 @@ terminal_widget_init (TerminalWidget *widget)
   terminal_widget_update_highlight_urls (widget);
 
   widget->accel_group = NULL;
-
-  for (guint i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
-    {
-      gint error_number;
-      PCRE2_SIZE error_offset;
-
-      widget->regex_pcre[i] = pcre2_compile_8 ((PCRE2_SPTR8) regex_patterns[i].pattern, PCRE2_ZERO_TERMINATED, 0, &error_number, &error_offset, NULL);
-      if (widget->regex_pcre[i] == NULL)
-        g_warning ("Failed to compile regex, error code \"%d\".", error_number);
-    }
 }
 
 
@@ -346,7 +428,7 @@ terminal_widget_finalize (GObject *object)
     utempter_remove_record (vte_pty_get_fd (pty));
 #endif
 
-  /* disconnect the misc-highlight-urls watch */
+  /* disconnect the misc-highlight-urls watches */
   g_signal_handlers_disconnect_by_func (G_OBJECT (widget->preferences), G_CALLBACK (terminal_widget_update_highlight_urls), widget);
 
   /* disconnect from the preferences */
@@ -355,13 +437,14 @@ terminal_widget_finalize (GObject *object)
   /* disconnect accelerators */
   terminal_widget_disconnect_accelerators (widget);
 
-  for (guint i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+  /* release the shared regexes */
+  terminal_widget_regex_registry_unref ();
+
+  /* release the background image */
+  if (widget->loader != NULL)
     {
-      if (widget->regex_pcre[i] != NULL)
-        {
-          pcre2_code_free_8 (widget->regex_pcre[i]);
-          widget->regex_pcre[i] = NULL;
-        }
+      g_signal_handlers_disconnect_by_func (widget->loader, gtk_widget_queue_draw, widget);
+      g_object_unref (widget->loader);
     }
 
   (*G_OBJECT_CLASS (terminal_widget_parent_class)->finalize) (object);
@@ -858,11 +941,104 @@ terminal_widget_key_press_event (GtkWidget *widget,
       return TRUE;
     }
 
+  /* detect urls while Ctrl is held, if only wanted on demand */
+  if (event->keyval == GDK_KEY_Control_L || event->keyval == GDK_KEY_Control_R)
+    {
+      TERMINAL_WIDGET (widget)->control_held = TRUE;
+      if (TERMINAL_WIDGET (widget)->highlight_urls_on_demand)
+        terminal_widget_update_highlight_urls (TERMINAL_WIDGET (widget));
+    }
+
   return (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->key_press_event) (widget, event);
 }
 
 
 
+static gboolean
+terminal_widget_key_release_event (GtkWidget *widget,
+                                   GdkEventKey *event)
+{
+  if (event->keyval == GDK_KEY_Control_L || event->keyval == GDK_KEY_Control_R)
+    {
+      TERMINAL_WIDGET (widget)->control_held = FALSE;
+      if (TERMINAL_WIDGET (widget)->highlight_urls_on_demand)
+        terminal_widget_update_highlight_urls (TERMINAL_WIDGET (widget));
+    }
+
+  return (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->key_release_event) (widget, event);
+}
+
+
+
+static gboolean
+terminal_widget_focus_out_event (GtkWidget *widget,
+                                 GdkEventFocus *event)
+{
+  /* the release of Ctrl is not seen once the focus is gone */
+  if (TERMINAL_WIDGET (widget)->control_held)
+    {
+      TERMINAL_WIDGET (widget)->control_held = FALSE;
+      if (TERMINAL_WIDGET (widget)->highlight_urls_on_demand)
+        terminal_widget_update_highlight_urls (TERMINAL_WIDGET (widget));
+    }
+
+  return (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->focus_out_event) (widget, event);
+}
+
+
+
+static gboolean
+terminal_widget_draw (GtkWidget *widget,
+                      cairo_t *cr)
+{
+  TerminalWidget *terminal = TERMINAL_WIDGET (widget);
+  GdkRGBA background;
+  gboolean result;
+  gint width, height;
+  gint scale_factor;
+
+  if (G_LIKELY (terminal->loader == NULL))
+    return (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->draw) (widget, cr);
+
+  scale_factor = gtk_widget_get_scale_factor (widget);
+  width = scale_factor * gtk_widget_get_allocated_width (widget);
+  height = scale_factor * gtk_widget_get_allocated_height (widget);
+
+  /* draw background image; cairo_set_operator() allows PNG transparency */
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  if (G_UNLIKELY (!terminal_image_loader_draw (terminal->loader, cr, width, height, scale_factor)))
+    {
+      /* the image is still loaded in the background, use the plain color
+       * until the loader emits "changed" */
+      background = terminal->background_color;
+      background.alpha = 1.0;
+      gdk_cairo_set_source_rgba (cr, &background);
+      cairo_paint (cr);
+    }
+  cairo_restore (cr);
+
+#if VTE_CHECK_VERSION(0, 52, 0)
+  /* vte does not clear its background, see terminal_widget_set_background(),
+   * so shade the image here and let vte draw the cells right on top */
+  gdk_cairo_set_source_rgba (cr, &terminal->background_color);
+  cairo_paint (cr);
+
+  result = (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->draw) (widget, cr);
+#else
+  /* vte clears its background with CAIRO_OPERATOR_SOURCE, so let it draw
+   * into a layer that is composited over the image */
+  cairo_push_group (cr);
+  result = (*GTK_WIDGET_CLASS (terminal_widget_parent_class)->draw) (widget, cr);
+  cairo_pop_group_to_source (cr);
+  cairo_paint (cr);
+#endif
+
+  return result;
+}
+
+
+
 static void
 terminal_widget_open_uri (TerminalWidget *widget,
                           const gchar *wlink,
@@ -909,69 +1085,329 @@ terminal_widget_open_uri (TerminalWidget *widget,
 
 
 static void
-terminal_widget_update_highlight_urls (TerminalWidget *widget)
+terminal_widget_regex_registry_ref (void)
+{
+  if (regex_registry == NULL)
+    {
+      regex_registry = g_slice_new0 (TerminalRegexRegistry);
+      regex_registry->resolved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      regex_registry->classified = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+      regex_registry->match_context = pcre2_match_context_create_8 (NULL);
+      pcre2_set_match_limit_8 (regex_registry->match_context, REGEX_MATCH_LIMIT);
+      pcre2_set_recursion_limit_8 (regex_registry->match_context, REGEX_RECURSION_LIMIT);
+      regex_registry->jit_stack = pcre2_jit_stack_create_8 (32 * 1024, 512 * 1024, NULL);
+      if (regex_registry->jit_stack != NULL)
+        pcre2_jit_stack_assign_8 (regex_registry->match_context, NULL, regex_registry->jit_stack);
+    }
+
+  regex_registry->ref_count++;
+}
+
+
+
+static void
+terminal_widget_regex_registry_unref (void)
 {
   guint i;
-  gboolean highlight_urls;
+
+  g_return_if_fail (regex_registry != NULL);
+
+  if (--regex_registry->ref_count > 0)
+    return;
+
+  /* vte holds its own reference on the matcher while still in use */
+  if (regex_registry->match != NULL)
+    vte_regex_unref (regex_registry->match);
+  if (regex_registry->whole != NULL)
+    pcre2_code_free_8 (regex_registry->whole);
+  if (regex_registry->whole_match_data != NULL)
+    pcre2_match_data_free_8 (regex_registry->whole_match_data);
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    if (regex_registry->code[i] != NULL)
+      pcre2_code_free_8 (regex_registry->code[i]);
+  if (regex_registry->match_data != NULL)
+    pcre2_match_data_free_8 (regex_registry->match_data);
+
+  pcre2_match_context_free_8 (regex_registry->match_context);
+  if (regex_registry->jit_stack != NULL)
+    pcre2_jit_stack_free_8 (regex_registry->jit_stack);
+
+  g_hash_table_destroy (regex_registry->resolved);
+  g_hash_table_destroy (regex_registry->classified);
+
+  g_slice_free (TerminalRegexRegistry, regex_registry);
+  regex_registry = NULL;
+}
+
+
+
+static VteRegex *
+terminal_widget_regex_new_match (const gchar *pattern)
+{
   VteRegex *regex;
-  const TerminalRegexPattern *pattern;
-  GError *error;
+  GError *error = NULL;
 
-  g_object_get (G_OBJECT (widget->preferences),
-                "misc-highlight-urls", &highlight_urls, NULL);
+  /* build the regex */
+  regex = vte_regex_new_for_match (pattern, -1,
+                                   PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE,
+                                   &error);
 
-  if (!highlight_urls)
+  if (error == NULL
+      && (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &error)
+          || !vte_regex_jit (regex, PCRE2_JIT_PARTIAL_SOFT, &error)))
     {
-      /* remove all our regex tags */
-      for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
-        if (widget->regex_tags[i] != -1)
-          {
-            vte_terminal_match_remove (VTE_TERMINAL (widget), widget->regex_tags[i]);
-            widget->regex_tags[i] = -1;
-          }
+      g_critical ("Failed to JIT regular expression '%s': %s\n", pattern, error->message);
+      g_clear_error (&error);
     }
-  else
+  if (G_UNLIKELY (error != NULL))
+    {
+      g_critical ("Failed to parse regular expression: %s", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  return regex;
+}
+
+
+
+static VteRegex *
+terminal_widget_regex_get_match (void)
+{
+  g_return_val_if_fail (regex_registry != NULL, NULL);
+
+  /* a broken pattern is only reported once */
+  if (G_LIKELY (regex_registry->match_tried))
+    return regex_registry->match;
+  regex_registry->match_tried = TRUE;
+
+  regex_registry->match = terminal_widget_regex_new_match (REGEX_LIMITS REGEX_URL_ANY);
+
+  return regex_registry->match;
+}
+
+
+
+static pcre2_code_8 *
+terminal_widget_regex_get_whole (void)
+{
+  gint error_number;
+  PCRE2_SIZE error_offset;
+  guint i;
+
+  g_return_val_if_fail (regex_registry != NULL, NULL);
+
+  if (G_LIKELY (regex_registry->whole_tried))
+    return regex_registry->whole;
+  regex_registry->whole_tried = TRUE;
+
+  /* same flags as the matcher handed to vte, so it reads links the same way */
+  regex_registry->whole = pcre2_compile_8 ((PCRE2_SPTR8) REGEX_URL_ANY_WHOLE, PCRE2_ZERO_TERMINATED,
+                                           PCRE2_ANCHORED | PCRE2_CASELESS | PCRE2_UTF | PCRE2_MULTILINE,
+                                           &error_number, &error_offset, NULL);
+  if (regex_registry->whole == NULL)
+    {
+      g_warning ("Failed to compile regex, error code \"%d\".", error_number);
+      return NULL;
+    }
+
+  pcre2_jit_compile_8 (regex_registry->whole, PCRE2_JIT_COMPLETE);
+
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    regex_registry->whole_groups[i] = pcre2_substring_number_from_name_8 (regex_registry->whole,
+                                                                         (PCRE2_SPTR8) regex_patterns[i].group);
+
+  regex_registry->whole_match_data = pcre2_match_data_create_from_pattern_8 (regex_registry->whole, NULL);
+
+  return regex_registry->whole;
+}
+
+
+
+static pcre2_code_8 *
+terminal_widget_regex_get_code (guint n)
+{
+  gint error_number;
+  PCRE2_SIZE error_offset;
+
+  g_return_val_if_fail (regex_registry != NULL, NULL);
+
+  if (G_LIKELY (regex_registry->code_tried[n]))
+    return regex_registry->code[n];
+  regex_registry->code_tried[n] = TRUE;
+
+  regex_registry->code[n] = pcre2_compile_8 ((PCRE2_SPTR8) regex_patterns[n].pattern, PCRE2_ZERO_TERMINATED, 0, &error_number, &error_offset, NULL);
+  if (regex_registry->code[n] == NULL)
+    {
+      g_warning ("Failed to compile regex, error code \"%d\".", error_number);
+      return NULL;
+    }
+
+  /* speeds up classifying long links, the interpreter is used if this fails */
+  pcre2_jit_compile_8 (regex_registry->code[n], PCRE2_JIT_COMPLETE);
+
+  /* only used from the main thread, and only the result matters, so
+   * a single match data will do for all patterns */
+  if (regex_registry->match_data == NULL)
+    regex_registry->match_data = pcre2_match_data_create_8 (1, NULL);
+
+  return regex_registry->code[n];
+}
+
+
+
+/* hovering and clicking resolve the same few links over and over */
+static void
+terminal_widget_regex_remember (GHashTable *table,
+                                const gchar *text,
+                                PatternType type)
+{
+  if (g_hash_table_size (table) >= MAX_CLASSIFIED_LINKS)
+    g_hash_table_remove_all (table);
+  g_hash_table_insert (table, g_strdup (text), GINT_TO_POINTER (type));
+}
+
+
+
+/* returns the type of the link @text highlighted by REGEX_URL_ANY, from the
+ * alternative that matches all of it, as vte only hands out the text */
+static PatternType
+terminal_widget_regex_resolve (const gchar *text)
+{
+  pcre2_code_8 *code;
+  PCRE2_SIZE *ovector;
+  gpointer value;
+  PatternType type = PATTERN_TYPE_NONE;
+  gint rc;
+  guint i;
+
+  if (g_hash_table_lookup_extended (regex_registry->resolved, text, NULL, &value))
+    return GPOINTER_TO_INT (value);
+
+  code = terminal_widget_regex_get_whole ();
+  if (code == NULL)
+    return PATTERN_TYPE_NONE;
+
+  rc = pcre2_match_8 (code, (PCRE2_SPTR8) text, strlen (text), 0, 0,
+                      regex_registry->whole_match_data, regex_registry->match_context);
+  if (rc >= 0)
     {
-      /* set all our patterns */
+      ovector = pcre2_get_ovector_pointer_8 (regex_registry->whole_match_data);
       for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
         {
-          /* continue if already set */
-          if (G_UNLIKELY (widget->regex_tags[i] != -1))
-            continue;
-
-          /* get the pattern */
-          pattern = &regex_patterns[i];
-
-          /* build the regex */
-          error = NULL;
-          regex = vte_regex_new_for_match (pattern->pattern, -1,
-                                           PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE,
-                                           &error);
-
-          if (error == NULL
-              && (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &error)
-                  || !vte_regex_jit (regex, PCRE2_JIT_PARTIAL_SOFT, &error)))
+          if (regex_registry->whole_groups[i] > 0
+              && ovector[2 * regex_registry->whole_groups[i]] != PCRE2_UNSET)
             {
-              g_critical ("Failed to JIT regular expression '%s': %s\n", pattern->pattern, error->message);
-              g_clear_error (&error);
-            }
-          if (G_UNLIKELY (error != NULL))
-            {
-              g_critical ("Failed to parse regular expression pattern %u: %s", i, error->message);
-              g_error_free (error);
-              continue;
+              type = regex_patterns[i].type;
+              break;
             }
+        }
+    }
+  else if (rc != PCRE2_ERROR_NOMATCH
+           && rc != PCRE2_ERROR_MATCHLIMIT
+           && rc != PCRE2_ERROR_RECURSIONLIMIT
+           && rc != PCRE2_ERROR_JIT_STACKLIMIT)
+    g_warning ("pcre2_match returned error code \"%d\".", rc);
+
+  terminal_widget_regex_remember (regex_registry->resolved, text, type);
+
+  return type;
+}
+
+
+
+/* returns the type of the first pattern that matches somewhere in @text */
+static PatternType
+terminal_widget_regex_classify (const gchar *text)
+{
+  pcre2_code_8 *code;
+  gpointer value;
+  PatternType type = PATTERN_TYPE_NONE;
+  gint rc;
+  guint i;
+
+  if (g_hash_table_lookup_extended (regex_registry->classified, text, NULL, &value))
+    return GPOINTER_TO_INT (value);
+
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    {
+      code = terminal_widget_regex_get_code (i);
+      if (code == NULL)
+        continue;
 
-          /* set the new regular expression */
-          widget->regex_tags[i] = vte_terminal_match_add_regex (VTE_TERMINAL (widget), regex, 0);
+      rc = pcre2_match_8 (code, (PCRE2_SPTR8) text, strlen (text), 0, 0,
+                          regex_registry->match_data, regex_registry->match_context);
+
+      /* running into the limits, or out of JIT stack, just means there is no link */
+      if (rc >= 0)
+        {
+          type = regex_patterns[i].type;
+          break;
+        }
+      else if (rc != PCRE2_ERROR_NOMATCH
+               && rc != PCRE2_ERROR_MATCHLIMIT
+               && rc != PCRE2_ERROR_RECURSIONLIMIT
+               && rc != PCRE2_ERROR_JIT_STACKLIMIT)
+        g_warning ("pcre2_match returned error code \"%d\".", rc);
+    }
+
+  terminal_widget_regex_remember (regex_registry->classified, text, type);
+
+  return type;
+}
+
+
+
+static void
+terminal_widget_update_highlight_urls (TerminalWidget *widget)
+{
+  gboolean highlight_urls;
+  gboolean highlight_urls_on_demand;
+
+  g_object_get (G_OBJECT (widget->preferences),
+                "misc-highlight-urls", &highlight_urls,
+                "misc-highlight-urls-on-demand", &highlight_urls_on_demand,
+                NULL);
+
+  widget->highlight_urls = highlight_urls;
+  widget->highlight_urls_on_demand = highlight_urls_on_demand;
+
+  /* on demand, vte only matches urls on pointer motion while Ctrl is held */
+  terminal_widget_set_url_matcher (widget, highlight_urls && (!highlight_urls_on_demand || widget->control_held));
+}
+
+
+
+static void
+terminal_widget_set_url_matcher (TerminalWidget *widget,
+                                 gboolean enabled)
+{
+  VteRegex *regex;
+
+  if (!enabled)
+    {
+      /* remove our regex tag */
+      if (widget->regex_tag != -1)
+        {
+          vte_terminal_match_remove (VTE_TERMINAL (widget), widget->regex_tag);
+          widget->regex_tag = -1;
+        }
+    }
+  else if (widget->regex_tag == -1)
+    {
+      /* get the shared regex, compiled on first use */
+      regex = terminal_widget_regex_get_match ();
+      if (G_UNLIKELY (regex == NULL))
+        return;
+
+      /* set the new regular expression */
+      widget->regex_tag = vte_terminal_match_add_regex (VTE_TERMINAL (widget), regex, 0);
 #if VTE_CHECK_VERSION(0, 53, 0)
-          vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), widget->regex_tags[i], "hand2");
+      vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), widget->regex_tag, "hand2");
 #else
-          vte_terminal_match_set_cursor_type (VTE_TERMINAL (widget), widget->regex_tags[i], GDK_HAND2);
+      vte_terminal_match_set_cursor_type (VTE_TERMINAL (widget), widget->regex_tag, GDK_HAND2);
 #endif
-          /* release the regex owned by vte now */
-          vte_regex_unref (regex);
-        }
     }
 }
 
@@ -1067,61 +1503,96 @@ terminal_widget_get_action_entries (void)
 
 
 
+/**
+ * terminal_widget_set_background:
+ * @widget : A #TerminalWidget.
+ * @loader : (nullable): The #TerminalImageLoader of the background image.
+ * @color  : The background color, with the alpha of the image shading.
+ *
+ * Paints the image of @loader under the terminal, shaded with @color, or
+ * only the background color of vte if @loader is %NULL.
+ **/
+void
+terminal_widget_set_background (TerminalWidget *widget,
+                                TerminalImageLoader *loader,
+                                const GdkRGBA *color)
+{
+  g_return_if_fail (TERMINAL_IS_WIDGET (widget));
+  g_return_if_fail (loader == NULL || TERMINAL_IS_IMAGE_LOADER (loader));
+  g_return_if_fail (color != NULL);
+
+  widget->background_color = *color;
+
+  if (widget->loader != loader)
+    {
+      if (widget->loader != NULL)
+        {
+          g_signal_handlers_disconnect_by_func (widget->loader, gtk_widget_queue_draw, widget);
+          g_object_unref (widget->loader);
+        }
+
+      widget->loader = loader;
+
+      if (loader != NULL)
+        {
+          g_object_ref (loader);
+          g_signal_connect_swapped (G_OBJECT (loader), "changed", G_CALLBACK (gtk_widget_queue_draw), widget);
+        }
+
+#if VTE_CHECK_VERSION(0, 52, 0)
+      /* vte clears its background with CAIRO_OPERATOR_SOURCE, which would
+       * wipe out the image painted in terminal_widget_draw() */
+      vte_terminal_set_clear_background (VTE_TERMINAL (widget), loader == NULL);
+#endif
+    }
+
+  gtk_widget_queue_draw (GTK_WIDGET (widget));
+}
+
+
+
 static TerminalHyperlink
 terminal_widget_get_link (TerminalWidget *widget,
                           GdkEvent *event)
 {
-  guint i;
   gint tag;
   gchar *uri;
-  pcre2_match_data_8 *match_data;
+  gboolean on_demand;
   TerminalHyperlink result = { NULL, PATTERN_TYPE_NONE };
-  gboolean hyperlinks_enabled;
-
-  g_object_get (G_OBJECT (TERMINAL_WIDGET (widget)->preferences), "misc-hyperlinks-enabled", &hyperlinks_enabled, NULL);
 
-  /* check if we have an OSC 8 uri */
-  if (hyperlinks_enabled && (uri = vte_terminal_hyperlink_check_event (VTE_TERMINAL (widget), (GdkEvent *) event)) != NULL)
+  /* check if we have an OSC 8 uri, "allow-hyperlink" follows misc-hyperlinks-enabled */
+  if (vte_terminal_get_allow_hyperlink (VTE_TERMINAL (widget))
+      && (uri = vte_terminal_hyperlink_check_event (VTE_TERMINAL (widget), (GdkEvent *) event)) != NULL)
     {
-      gint rc;
-
-      for (i = 0; i < G_N_ELEMENTS (widget->regex_pcre); i++)
+      result.type = terminal_widget_regex_classify (uri);
+      if (result.type != PATTERN_TYPE_NONE)
         {
-          if (widget->regex_pcre[i] == NULL)
-            continue;
-
-          match_data = pcre2_match_data_create_from_pattern_8 (widget->regex_pcre[i], NULL);
-          rc = pcre2_match_8 (widget->regex_pcre[i], (PCRE2_SPTR8) uri, strlen (uri), 0, 0, match_data, NULL);
-          pcre2_match_data_free_8 (match_data);
-
-          if (rc >= 0)
-            {
-              result.uri = uri;
-              result.type = regex_patterns[i].type;
-              return result;
-            }
-          else if (rc != PCRE2_ERROR_NOMATCH)
-            g_warning ("pcre2_match returned error code \"%d\".", rc);
+          result.uri = uri;
+          return result;
         }
       g_free (uri);
     }
 
+  /* urls detected on demand can still be clicked or copied without Ctrl */
+  on_demand = (widget->regex_tag == -1 && widget->highlight_urls);
+  if (on_demand)
+    terminal_widget_set_url_matcher (widget, TRUE);
+
   /* check if we have a regex match */
   if ((uri = vte_terminal_match_check_event (VTE_TERMINAL (widget), event, &tag)) != NULL)
     {
-      for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
-        {
-          /* lookup the tag in our tags */
-          if (widget->regex_tags[i] == tag)
-            {
-              result.uri = uri;
-              result.type = regex_patterns[i].type;
-              return result;
-            }
-        }
-      g_free (uri);
+      /* the highlighted link itself, with the type of the alternative that found it */
+      if (tag == widget->regex_tag)
+        result.type = terminal_widget_regex_resolve (uri);
+      if (result.type != PATTERN_TYPE_NONE)
+        result.uri = uri;
+      else
+        g_free (uri);
     }
 
+  if (on_demand)
+    terminal_widget_set_url_matcher (widget, FALSE);
+
   return result;
 }
 
@@ -23,6 +23,8 @@
 #include <libxfce4ui/libxfce4ui.h>
 #include <vte/vte.h>
 
+#include "terminal-image-loader.h"
+
 G_BEGIN_DECLS
 
 #define TERMINAL_TYPE_WIDGET (terminal_widget_get_type ())
@@ -53,6 +55,11 @@ typedef enum
 XfceGtkActionEntry *
 terminal_widget_get_action_entries (void);
 
+void
+terminal_widget_set_background (TerminalWidget *widget,
+                                TerminalImageLoader *loader,
+                                const GdkRGBA *color);
+
 G_END_DECLS
 
 #endif /* !TERMINAL_WIDGET_H */
@@ -97,6 +97,31 @@ typedef struct
   gint signal;
 } SendSignalData;
 
+typedef struct
+{
+  TerminalWindow *window;
+  TerminalScreen *screen;
+  GFile *file;
+  GOutputStream *stream;
+  TerminalExportFormat format;
+  gboolean compress;
+  GCancellable *cancellable;
+
+  /* destroyed with the window, which cancels the save */
+  GtkWidget *dialog;
+  GtkWidget *progress;
+} SaveContentsData;
+
+typedef struct
+{
+  TerminalWindow *window;
+  GSubprocess *subprocess;
+  gchar *command;
+
+  /* shared by both tabs, closing either one stops the pipe */
+  GCancellable *cancellable;
+} PipeContentsData;
+
 
 
 static void
@@ -270,8 +295,63 @@ static gboolean
 terminal_window_action_search_next (TerminalWindow *window);
 static gboolean
 terminal_window_action_search_prev (TerminalWindow *window);
+static void
+terminal_window_search_changed (TerminalWindow *window);
+static void
+terminal_window_search_pattern_changed (TerminalWindow *window);
+static void
+terminal_window_search_hidden (TerminalWindow *window);
+static void
+terminal_window_search_update_status (TerminalSearch *search,
+                                      TerminalWindow *window);
+static void
+terminal_window_search_all (TerminalWindow *window);
+static void
+terminal_window_search_all_clear (TerminalWindow *window);
+static void
+terminal_window_search_all_ready (GObject *object,
+                                  GAsyncResult *result,
+                                  gpointer user_data);
+static void
+terminal_window_search_result_activated (TerminalWindow *window,
+                                         TerminalScreen *screen,
+                                         glong row);
 static gboolean
 terminal_window_action_save_contents (TerminalWindow *window);
+static void
+terminal_window_save_contents_replaced (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data);
+static void
+terminal_window_save_contents_progress (goffset current_rows,
+                                        goffset total_rows,
+                                        gpointer user_data);
+static void
+terminal_window_save_contents_saved (GObject *object,
+                                     GAsyncResult *result,
+                                     gpointer user_data);
+static void
+terminal_window_save_contents_finish (SaveContentsData *save,
+                                      GError *error);
+static gboolean
+terminal_window_action_replay_contents (TerminalWindow *window);
+static void
+terminal_window_replay_contents_opened (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data);
+static void
+terminal_window_replay_contents_done (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data);
+static void
+terminal_window_replay_contents_error (TerminalScreen *screen,
+                                       GError *error);
+static gboolean
+terminal_window_action_pipe_contents (TerminalWindow *window);
+static void
+terminal_window_pipe_contents_saved (GObject *object,
+                                     GAsyncResult *result,
+                                     gpointer user_data);
 static gboolean
 terminal_window_action_reset (TerminalWindow *window);
 static gboolean
@@ -354,6 +434,12 @@ struct _TerminalWindowPrivate
   GtkWidget *search_dialog;
   GtkWidget *title_popover;
 
+  /* running search of all tabs */
+  GCancellable *search_all_cancellable;
+
+  /* last command of pipe contents */
+  gchar *pipe_command;
+
   /* pushed size of screen */
   glong grid_width;
   glong grid_height;
@@ -724,6 +810,26 @@ static XfceGtkActionEntry action_entries[] = {
     "document-save-as",
     G_CALLBACK (terminal_window_action_save_contents),
   },
+  {
+    TERMINAL_WINDOW_ACTION_REPLAY_CONTENTS,
+    "<Actions>/terminal-window/replay-contents",
+    "",
+    XFCE_GTK_IMAGE_MENU_ITEM,
+    N_ ("Re_play Contents..."),
+    N_ ("Show saved contents in a new tab"),
+    "document-open",
+    G_CALLBACK (terminal_window_action_replay_contents),
+  },
+  {
+    TERMINAL_WINDOW_ACTION_PIPE_CONTENTS,
+    "<Actions>/terminal-window/pipe-contents",
+    "",
+    XFCE_GTK_IMAGE_MENU_ITEM,
+    N_ ("P_ipe Contents..."),
+    N_ ("Send the contents to the input of a command"),
+    "system-run",
+    G_CALLBACK (terminal_window_action_pipe_contents),
+  },
   {
     TERMINAL_WINDOW_ACTION_RESET,
     "<Actions>/terminal-window/reset",
@@ -1254,8 +1360,15 @@ terminal_window_finalize (GObject *object)
 
   g_slist_free (window->priv->tabs_menu_actions);
   g_free (window->priv->font);
+  g_free (window->priv->pipe_command);
   g_queue_free_full (window->priv->closed_tabs_list, (GDestroyNotify) terminal_tab_attr_free);
 
+  if (window->priv->search_all_cancellable != NULL)
+    {
+      g_cancellable_cancel (window->priv->search_all_cancellable);
+      g_object_unref (window->priv->search_all_cancellable);
+    }
+
   (*G_OBJECT_CLASS (terminal_window_parent_class)->finalize) (object);
 }
 
@@ -1695,6 +1808,14 @@ terminal_window_notebook_page_switched (GtkNotebook *notebook,
       encoding = terminal_screen_get_encoding (window->priv->active);
       terminal_encoding_action_set_charset (window->priv->encoding_action, encoding);
       terminal_screen_widget_append_accels (active, window->priv->accel_group);
+
+      /* move the highlighted matches to the new tab */
+      if (window->priv->search_dialog != NULL && gtk_widget_get_visible (window->priv->search_dialog))
+        {
+          if (window->priv->last_active != NULL)
+            terminal_search_set_pattern (terminal_screen_get_search (window->priv->last_active), NULL, 0, NULL, NULL);
+          terminal_window_search_changed (window);
+        }
     }
 }
 
@@ -1733,6 +1854,8 @@ terminal_window_notebook_page_added (GtkNotebook *notebook,
                     G_CALLBACK (terminal_window_close_tab_request), window);
   g_signal_connect (G_OBJECT (screen), "drag-data-received",
                     G_CALLBACK (terminal_window_notebook_drag_data_received), window);
+  g_signal_connect (G_OBJECT (terminal_screen_get_search (screen)), "changed",
+                    G_CALLBACK (terminal_window_search_update_status), window);
 
   /* release to the grid size applies */
   gtk_widget_realize (GTK_WIDGET (screen));
@@ -1791,6 +1914,8 @@ terminal_window_notebook_page_removed (GtkNotebook *notebook,
                                         terminal_window_close_tab_request, window);
   g_signal_handlers_disconnect_by_func (G_OBJECT (child),
                                         terminal_window_notebook_drag_data_received, window);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (terminal_screen_get_search (TERMINAL_SCREEN (child))),
+                                        terminal_window_search_update_status, window);
 
   /* set tab visibility */
   npages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook));
@@ -2128,6 +2253,7 @@ terminal_window_get_context_menu (TerminalScreen *screen,
   terminal_window_menu_add_section (window, context_menu, MENU_SECTION_ZOOM | MENU_SECTION_SIGNAL, TRUE);
 
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SAVE_CONTENTS), G_OBJECT (window), GTK_MENU_SHELL (context_menu));
+  xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_PIPE_CONTENTS), G_OBJECT (window), GTK_MENU_SHELL (context_menu));
   xfce_gtk_menu_append_separator (GTK_MENU_SHELL (context_menu));
 
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_PREFERENCES), G_OBJECT (window), GTK_MENU_SHELL (context_menu));
@@ -2913,6 +3039,8 @@ terminal_window_action_search_response (GtkWidget *dialog,
     terminal_window_action_search_next (window);
   else if (response_id == TERMINAL_RESPONSE_SEARCH_PREV)
     terminal_window_action_search_prev (window);
+  else if (response_id == TERMINAL_RESPONSE_SEARCH_ALL)
+    terminal_window_search_all (window);
   else
     {
       /* need for hiding on focus */
@@ -2937,6 +3065,12 @@ terminal_window_action_search (TerminalWindow *window)
                         G_CALLBACK (terminal_window_action_search_response), window);
       g_signal_connect (G_OBJECT (window->priv->search_dialog), "delete-event",
                         G_CALLBACK (gtk_widget_hide_on_delete), NULL);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "search-changed",
+                                G_CALLBACK (terminal_window_search_pattern_changed), window);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "hide",
+                                G_CALLBACK (terminal_window_search_hidden), window);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "result-activated",
+                                G_CALLBACK (terminal_window_search_result_activated), window);
     }
 
   /* increase child counter */
@@ -2945,6 +3079,9 @@ terminal_window_action_search (TerminalWindow *window)
 
   terminal_search_dialog_present (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog));
 
+  /* highlight what is still typed from last time */
+  terminal_window_search_changed (window);
+
   return TRUE;
 }
 
@@ -2953,30 +3090,202 @@ terminal_window_action_search (TerminalWindow *window)
 static gboolean
 prepare_regex (TerminalWindow *window)
 {
-  VteRegex *regex;
+  TerminalSearch *search;
   GError *error = NULL;
-  gboolean wrap_around;
+  guint32 flags;
+  gchar *pattern;
+  gboolean result;
 
   /* may occur if next/prev actions are activated by keyboard shortcut */
   if (window->priv->search_dialog == NULL)
     return FALSE;
 
-  regex = terminal_search_dialog_get_regex (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), &error);
-  if (G_LIKELY (error == NULL))
+  pattern = terminal_search_dialog_get_pattern (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), &flags);
+  if (pattern == NULL)
+    return FALSE;
+
+  /* usually set while typing already, which keeps the matches, but not
+   * right after a key press, nor with the error of a broken pattern */
+  search = terminal_screen_get_search (window->priv->active);
+  result = terminal_search_set_pattern (search, pattern, flags,
+                                        terminal_search_dialog_get_literal (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog)),
+                                        &error);
+  g_free (pattern);
+
+  if (G_UNLIKELY (!result))
     {
-      wrap_around = terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog));
-      terminal_screen_search_set_gregex (window->priv->active, regex, wrap_around);
-      if (regex != NULL)
-        vte_regex_unref (regex);
+      xfce_dialog_show_error (GTK_WINDOW (window->priv->search_dialog), error,
+                              _("Failed to create the regular expression"));
+      g_error_free (error);
+    }
 
-      return TRUE;
+  return result;
+}
+
+
+
+static void
+terminal_window_search_changed (TerminalWindow *window)
+{
+  TerminalSearch *search;
+  guint32 flags;
+  gchar *pattern;
+
+  if (window->priv->active == NULL)
+    return;
+
+  /* highlight all matches in the active tab while typing; a broken
+   * pattern only shows no matches, the error is reported on search */
+  search = terminal_screen_get_search (window->priv->active);
+  pattern = terminal_search_dialog_get_pattern (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), &flags);
+  terminal_search_set_pattern (search, pattern, flags,
+                               terminal_search_dialog_get_literal (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog)),
+                               NULL);
+  g_free (pattern);
+}
+
+
+
+static void
+terminal_window_search_pattern_changed (TerminalWindow *window)
+{
+  /* the results of all tabs are of the previous pattern */
+  terminal_window_search_all_clear (window);
+  terminal_window_search_changed (window);
+}
+
+
+
+static void
+terminal_window_search_hidden (TerminalWindow *window)
+{
+  /* drop the results, they keep the screens of closed tabs alive */
+  terminal_window_search_all_clear (window);
+
+  if (window->priv->active != NULL)
+    terminal_search_set_pattern (terminal_screen_get_search (window->priv->active), NULL, 0, NULL, NULL);
+}
+
+
+
+static void
+terminal_window_search_update_status (TerminalSearch *search,
+                                      TerminalWindow *window)
+{
+  if (window->priv->search_dialog == NULL
+      || window->priv->active == NULL
+      || terminal_screen_get_search (window->priv->active) != search)
+    return;
+
+  terminal_search_dialog_set_status (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog),
+                                     terminal_search_get_current (search),
+                                     terminal_search_get_n_matches (search),
+                                     terminal_search_is_done (search));
+}
+
+
+
+static void
+terminal_window_search_all (TerminalWindow *window)
+{
+  GList *toplevels;
+  GList *screens = NULL;
+  GList *lp;
+  guint32 flags;
+  gchar *pattern;
+
+  pattern = terminal_search_dialog_get_pattern (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), &flags);
+  if (pattern == NULL)
+    return;
+
+  /* the tabs of all windows of this process, in window order */
+  toplevels = gtk_window_list_toplevels ();
+  for (lp = toplevels; lp != NULL; lp = lp->next)
+    if (TERMINAL_IS_WINDOW (lp->data))
+      screens = g_list_concat (screens, gtk_container_get_children (GTK_CONTAINER (terminal_window_get_notebook (lp->data))));
+  g_list_free (toplevels);
+
+  /* only the last search is of interest */
+  if (window->priv->search_all_cancellable != NULL)
+    {
+      g_cancellable_cancel (window->priv->search_all_cancellable);
+      g_object_unref (window->priv->search_all_cancellable);
     }
+  window->priv->search_all_cancellable = g_cancellable_new ();
 
-  xfce_dialog_show_error (GTK_WINDOW (window->priv->search_dialog), error,
-                          _("Failed to create the regular expression"));
-  g_error_free (error);
+  terminal_search_all (screens, pattern, flags, window->priv->search_all_cancellable,
+                       terminal_window_search_all_ready, window);
 
-  return FALSE;
+  g_list_free (screens);
+  g_free (pattern);
+}
+
+
+
+static void
+terminal_window_search_all_clear (TerminalWindow *window)
+{
+  if (window->priv->search_all_cancellable != NULL)
+    {
+      g_cancellable_cancel (window->priv->search_all_cancellable);
+      g_object_unref (window->priv->search_all_cancellable);
+      window->priv->search_all_cancellable = NULL;
+    }
+
+  terminal_search_dialog_set_results (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), NULL);
+}
+
+
+
+static void
+terminal_window_search_all_ready (GObject *object,
+                                  GAsyncResult *result,
+                                  gpointer user_data)
+{
+  TerminalWindow *window;
+  GPtrArray *matches;
+  GError *error = NULL;
+
+  /* the window may be gone when the search is cancelled */
+  matches = terminal_search_all_finish (result, &error);
+  if (G_UNLIKELY (matches == NULL))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          window = TERMINAL_WINDOW (user_data);
+          xfce_dialog_show_error (GTK_WINDOW (window->priv->search_dialog), error,
+                                  _("Failed to create the regular expression"));
+        }
+      g_error_free (error);
+      return;
+    }
+
+  window = TERMINAL_WINDOW (user_data);
+  terminal_search_dialog_set_results (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog), matches);
+  g_ptr_array_unref (matches);
+}
+
+
+
+static void
+terminal_window_search_result_activated (TerminalWindow *window,
+                                         TerminalScreen *screen,
+                                         glong row)
+{
+  GtkWidget *toplevel;
+  GtkNotebook *notebook;
+
+  /* ignore results of closed tabs */
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+  if (!TERMINAL_IS_WINDOW (toplevel))
+    return;
+
+  notebook = GTK_NOTEBOOK (terminal_window_get_notebook (TERMINAL_WINDOW (toplevel)));
+  gtk_notebook_set_current_page (notebook, gtk_notebook_page_num (notebook, GTK_WIDGET (screen)));
+  terminal_search_scroll_to_row (terminal_screen_get_search (screen), row);
+
+  if (toplevel != GTK_WIDGET (window))
+    gtk_window_present (GTK_WINDOW (toplevel));
 }
 
 
@@ -2985,7 +3294,8 @@ static gboolean
 terminal_window_action_search_next (TerminalWindow *window)
 {
   if (prepare_regex (window))
-    terminal_screen_search_find_next (window->priv->active);
+    terminal_search_find (terminal_screen_get_search (window->priv->active), FALSE,
+                          terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog)));
   return TRUE;
 }
 
@@ -2995,7 +3305,8 @@ static gboolean
 terminal_window_action_search_prev (TerminalWindow *window)
 {
   if (prepare_regex (window))
-    terminal_screen_search_find_previous (window->priv->active);
+    terminal_search_find (terminal_screen_get_search (window->priv->active), TRUE,
+                          terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog)));
   return TRUE;
 }
 
@@ -3004,10 +3315,11 @@ terminal_window_action_search_prev (TerminalWindow *window)
 static gboolean
 terminal_window_action_save_contents (TerminalWindow *window)
 {
+  SaveContentsData *save;
   GtkWidget *dialog;
-  GFile *file;
-  GOutputStream *stream;
-  GError *error = NULL;
+  GtkWidget *hbox;
+  GtkWidget *format;
+  GtkWidget *compress;
   gchar *filename_uri;
   gint response;
 
@@ -3021,6 +3333,20 @@ terminal_window_action_save_contents (TerminalWindow *window)
                                         NULL);
   gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog), TRUE);
 
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_file_chooser_set_extra_widget (GTK_FILE_CHOOSER (dialog), hbox);
+
+  /* same order as TerminalExportFormat */
+  format = gtk_combo_box_text_new ();
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (format), _("Plain text"));
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (format), _("Text with colors (ANSI)"));
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (format), _("Cell runs with colors (binary)"));
+  gtk_combo_box_set_active (GTK_COMBO_BOX (format), TERMINAL_EXPORT_FORMAT_TEXT);
+  gtk_box_pack_start (GTK_BOX (hbox), format, FALSE, FALSE, 0);
+
+  compress = gtk_check_button_new_with_mnemonic (_("Compress with _gzip"));
+  gtk_box_pack_start (GTK_BOX (hbox), compress, FALSE, FALSE, 0);
+
   /* save to current working directory */
   gtk_file_chooser_set_current_folder (GTK_FILE_CHOOSER (dialog),
                                        terminal_screen_get_working_directory (TERMINAL_SCREEN (window->priv->active)));
@@ -3039,32 +3365,413 @@ terminal_window_action_save_contents (TerminalWindow *window)
     }
 
   filename_uri = gtk_file_chooser_get_uri (GTK_FILE_CHOOSER (dialog));
+  if (filename_uri == NULL)
+    {
+      gtk_widget_destroy (dialog);
+      return TRUE;
+    }
+
+  save = g_slice_new0 (SaveContentsData);
+  save->window = g_object_ref (window);
+  save->screen = g_object_ref (window->priv->active);
+  save->file = g_file_new_for_uri (filename_uri);
+  save->format = gtk_combo_box_get_active (GTK_COMBO_BOX (format));
+  save->compress = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (compress));
+  save->cancellable = g_cancellable_new ();
+
   gtk_widget_destroy (dialog);
+  g_free (filename_uri);
 
-  if (filename_uri == NULL)
-    return TRUE;
+  /* the save runs in the background, the progress can be cancelled */
+  save->dialog = gtk_dialog_new_with_buttons (_("Saving contents..."),
+                                              GTK_WINDOW (window),
+                                              GTK_DIALOG_DESTROY_WITH_PARENT,
+                                              _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                              NULL);
+  gtk_window_set_default_size (GTK_WINDOW (save->dialog), 300, -1);
+  g_signal_connect_swapped (G_OBJECT (save->dialog), "response",
+                            G_CALLBACK (g_cancellable_cancel), save->cancellable);
+  g_signal_connect_swapped (G_OBJECT (save->dialog), "destroy",
+                            G_CALLBACK (g_cancellable_cancel), save->cancellable);
+  g_signal_connect (G_OBJECT (save->dialog), "destroy",
+                    G_CALLBACK (gtk_widget_destroyed), &save->dialog);
+
+  save->progress = gtk_progress_bar_new ();
+  gtk_container_set_border_width (GTK_CONTAINER (save->progress), 12);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (save->dialog))), save->progress, TRUE, TRUE, 0);
+  gtk_widget_show_all (save->dialog);
+
+  g_file_replace_async (save->file, NULL, FALSE, G_FILE_CREATE_NONE, G_PRIORITY_DEFAULT,
+                        save->cancellable, terminal_window_save_contents_replaced, save);
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_window_save_contents_replaced (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data)
+{
+  SaveContentsData *save = user_data;
+  GFileOutputStream *stream;
+  GConverter *compressor;
+  GError *error = NULL;
+
+  stream = g_file_replace_finish (G_FILE (object), result, &error);
+  if (G_UNLIKELY (stream == NULL))
+    {
+      terminal_window_save_contents_finish (save, error);
+      return;
+    }
 
-  file = g_file_new_for_uri (filename_uri);
-  stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error));
-  if (stream)
+  if (save->compress)
     {
-      terminal_screen_save_contents (TERMINAL_SCREEN (window->priv->active), stream, error);
+      compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+      save->stream = g_converter_output_stream_new (G_OUTPUT_STREAM (stream), compressor);
+      g_object_unref (compressor);
       g_object_unref (stream);
     }
+  else
+    save->stream = G_OUTPUT_STREAM (stream);
+
+  terminal_screen_save_contents_async (save->screen, save->stream, save->format,
+                                       TERMINAL_CONTENTS_RANGE_ALL, save->cancellable,
+                                       terminal_window_save_contents_progress, save,
+                                       terminal_window_save_contents_saved, save);
+}
+
+
+
+static void
+terminal_window_save_contents_progress (goffset current_rows,
+                                        goffset total_rows,
+                                        gpointer user_data)
+{
+  SaveContentsData *save = user_data;
+
+  if (save->dialog != NULL && total_rows > 0)
+    gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (save->progress), (gdouble) current_rows / total_rows);
+}
+
+
+
+static void
+terminal_window_save_contents_saved (GObject *object,
+                                     GAsyncResult *result,
+                                     gpointer user_data)
+{
+  GError *error = NULL;
+
+  terminal_screen_save_contents_finish (TERMINAL_SCREEN (object), result, &error);
+  terminal_window_save_contents_finish (user_data, error);
+}
+
+
 
-  if (error)
+static void
+terminal_window_save_contents_finish (SaveContentsData *save,
+                                      GError *error)
+{
+  if (error != NULL)
     {
-      xfce_dialog_show_error (GTK_WINDOW (window), error, _("Failed to save terminal contents"));
+      /* closing a replaced file while cancelled keeps the old file */
+      if (save->stream != NULL)
+        {
+          g_cancellable_cancel (save->cancellable);
+          g_output_stream_close (save->stream, save->cancellable, NULL);
+        }
+
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        xfce_dialog_show_error (GTK_WINDOW (save->window), error, _("Failed to save terminal contents"));
       g_error_free (error);
     }
 
+  if (save->dialog != NULL)
+    gtk_widget_destroy (save->dialog);
+
+  if (save->stream != NULL)
+    g_object_unref (save->stream);
+  g_object_unref (save->cancellable);
+  g_object_unref (save->file);
+  g_object_unref (save->screen);
+  g_object_unref (save->window);
+  g_slice_free (SaveContentsData, save);
+}
+
+
+
+static gboolean
+terminal_window_action_replay_contents (TerminalWindow *window)
+{
+  TerminalScreen *screen;
+  GtkWidget *dialog;
+  GFile *file;
+  gchar *title;
+
+  dialog = gtk_file_chooser_dialog_new (_("Replay contents..."),
+                                        GTK_WINDOW (window),
+                                        GTK_FILE_CHOOSER_ACTION_OPEN, _("_Cancel"),
+                                        GTK_RESPONSE_CANCEL, _("_Open"),
+                                        GTK_RESPONSE_ACCEPT,
+                                        NULL);
+
+  if (window->priv->active != NULL)
+    gtk_file_chooser_set_current_folder (GTK_FILE_CHOOSER (dialog),
+                                         terminal_screen_get_working_directory (window->priv->active));
+
+  gtk_window_set_modal (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_destroy_with_parent (GTK_WINDOW (dialog), TRUE);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) != GTK_RESPONSE_ACCEPT)
+    {
+      gtk_widget_destroy (dialog);
+      return TRUE;
+    }
+
+  file = gtk_file_chooser_get_file (GTK_FILE_CHOOSER (dialog));
+  gtk_widget_destroy (dialog);
+
+  if (file == NULL)
+    return TRUE;
+
+  /* a tab without child process, named after the file */
+  screen = TERMINAL_SCREEN (g_object_new (TERMINAL_TYPE_SCREEN, NULL));
+  title = g_file_get_basename (file);
+  terminal_screen_set_custom_title (screen, title);
+  g_free (title);
+  terminal_window_add (window, screen);
+
+  g_file_read_async (file, G_PRIORITY_DEFAULT, NULL, terminal_window_replay_contents_opened, g_object_ref (screen));
   g_object_unref (file);
-  g_free (filename_uri);
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_window_replay_contents_opened (GObject *object,
+                                        GAsyncResult *result,
+                                        gpointer user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  GFileInputStream *stream;
+  GError *error = NULL;
+
+  stream = g_file_read_finish (G_FILE (object), result, &error);
+  if (G_UNLIKELY (stream == NULL))
+    {
+      terminal_window_replay_contents_error (screen, error);
+      g_object_unref (screen);
+      return;
+    }
+
+  terminal_screen_replay_contents_async (screen, G_INPUT_STREAM (stream), NULL,
+                                         terminal_window_replay_contents_done, NULL);
+  g_object_unref (stream);
+  g_object_unref (screen);
+}
+
+
+
+static void
+terminal_window_replay_contents_done (GObject *object,
+                                      GAsyncResult *result,
+                                      gpointer user_data)
+{
+  GError *error = NULL;
+
+  /* closing the tab cancels the replay */
+  if (!terminal_screen_replay_contents_finish (TERMINAL_SCREEN (object), result, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_error_free (error);
+      else
+        terminal_window_replay_contents_error (TERMINAL_SCREEN (object), error);
+    }
+}
+
+
+
+static void
+terminal_window_replay_contents_error (TerminalScreen *screen,
+                                       GError *error)
+{
+  GtkWidget *toplevel;
+
+  /* the tab may have been moved or closed in the meantime */
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+  xfce_dialog_show_error (TERMINAL_IS_WINDOW (toplevel) ? GTK_WINDOW (toplevel) : NULL,
+                          error, _("Failed to replay terminal contents"));
+  g_error_free (error);
+}
+
+
+
+static gboolean
+terminal_window_action_pipe_contents (TerminalWindow *window)
+{
+  PipeContentsData *pipe_data;
+  GSubprocessLauncher *launcher;
+  GSubprocessFlags flags = G_SUBPROCESS_FLAGS_STDIN_PIPE;
+  GSubprocess *subprocess;
+  TerminalScreen *source;
+  TerminalScreen *screen;
+  GtkWidget *dialog;
+  GtkWidget *grid;
+  GtkWidget *label;
+  GtkWidget *entry;
+  GtkWidget *range;
+  GtkWidget *new_tab;
+  GError *error = NULL;
+
+  g_return_val_if_fail (window->priv->active != NULL, FALSE);
+
+  dialog = gtk_dialog_new_with_buttons (_("Pipe Contents"),
+                                        GTK_WINDOW (window),
+                                        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                        _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                        _("_Run"), GTK_RESPONSE_ACCEPT,
+                                        NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_ACCEPT);
+
+  grid = gtk_grid_new ();
+  gtk_grid_set_row_spacing (GTK_GRID (grid), 6);
+  gtk_grid_set_column_spacing (GTK_GRID (grid), 12);
+  gtk_container_set_border_width (GTK_CONTAINER (grid), 6);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), grid, TRUE, TRUE, 0);
+
+  label = gtk_label_new_with_mnemonic (_("C_ommand:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_grid_attach (GTK_GRID (grid), label, 0, 0, 1, 1);
+
+  /* run by the shell, so pipelines and redirections work */
+  entry = gtk_entry_new ();
+  gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
+  gtk_entry_set_placeholder_text (GTK_ENTRY (entry), _("e.g. grep error | sort"));
+  if (window->priv->pipe_command != NULL)
+    gtk_entry_set_text (GTK_ENTRY (entry), window->priv->pipe_command);
+  gtk_widget_set_hexpand (entry, TRUE);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), entry);
+  gtk_grid_attach (GTK_GRID (grid), entry, 1, 0, 1, 1);
+
+  label = gtk_label_new_with_mnemonic (_("_Contents:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_grid_attach (GTK_GRID (grid), label, 0, 1, 1, 1);
+
+  /* same order as TerminalContentsRange */
+  range = gtk_combo_box_text_new ();
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (range), _("Scrollback and screen"));
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (range), _("Visible screen"));
+#if VTE_CHECK_VERSION(0, 72, 0)
+  if (terminal_screen_has_selection (window->priv->active))
+    {
+      gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (range), _("Selection"));
+      gtk_combo_box_set_active (GTK_COMBO_BOX (range), TERMINAL_CONTENTS_RANGE_SELECTION);
+    }
+  else
+#endif
+    gtk_combo_box_set_active (GTK_COMBO_BOX (range), TERMINAL_CONTENTS_RANGE_ALL);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), range);
+  gtk_grid_attach (GTK_GRID (grid), range, 1, 1, 1, 1);
+
+  new_tab = gtk_check_button_new_with_mnemonic (_("Show the output in a new _tab"));
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (new_tab), TRUE);
+  gtk_grid_attach (GTK_GRID (grid), new_tab, 0, 2, 2, 1);
+
+  gtk_widget_show_all (dialog);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) != GTK_RESPONSE_ACCEPT
+      || !IS_STRING (gtk_entry_get_text (GTK_ENTRY (entry))))
+    {
+      gtk_widget_destroy (dialog);
+      return TRUE;
+    }
+
+  g_free (window->priv->pipe_command);
+  window->priv->pipe_command = g_strdup (gtk_entry_get_text (GTK_ENTRY (entry)));
+
+  /* stderr goes to the tab as well, otherwise both are inherited */
+  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (new_tab)))
+    flags |= G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_MERGE;
+
+  source = window->priv->active;
+
+  launcher = g_subprocess_launcher_new (flags);
+  g_subprocess_launcher_set_cwd (launcher, terminal_screen_get_working_directory (source));
+  subprocess = g_subprocess_launcher_spawn (launcher, &error, "/bin/sh", "-c", window->priv->pipe_command, NULL);
+  g_object_unref (launcher);
+
+  if (G_UNLIKELY (subprocess == NULL))
+    {
+      xfce_dialog_show_error (GTK_WINDOW (window), error, _("Failed to run \"%s\""), window->priv->pipe_command);
+      g_error_free (error);
+      gtk_widget_destroy (dialog);
+      return TRUE;
+    }
+
+  pipe_data = g_slice_new0 (PipeContentsData);
+  pipe_data->window = g_object_ref (window);
+  pipe_data->subprocess = subprocess;
+  pipe_data->command = g_strdup (window->priv->pipe_command);
+  pipe_data->cancellable = g_cancellable_new ();
+
+  if ((flags & G_SUBPROCESS_FLAGS_STDOUT_PIPE) != 0)
+    {
+      /* a tab without child process, showing the output while it is written */
+      screen = TERMINAL_SCREEN (g_object_new (TERMINAL_TYPE_SCREEN, NULL));
+      terminal_screen_set_custom_title (screen, pipe_data->command);
+      terminal_window_add (window, screen);
+
+      terminal_screen_replay_contents_async (screen, g_subprocess_get_stdout_pipe (subprocess),
+                                             pipe_data->cancellable,
+                                             terminal_window_replay_contents_done, NULL);
+    }
+
+  /* the contents are streamed in chunks of rows, as fast as the command reads them */
+  terminal_screen_save_contents_async (source, g_subprocess_get_stdin_pipe (subprocess),
+                                       TERMINAL_EXPORT_FORMAT_TEXT,
+                                       gtk_combo_box_get_active (GTK_COMBO_BOX (range)),
+                                       pipe_data->cancellable, NULL, NULL,
+                                       terminal_window_pipe_contents_saved, pipe_data);
+
+  gtk_widget_destroy (dialog);
+
   return TRUE;
 }
 
 
 
+static void
+terminal_window_pipe_contents_saved (GObject *object,
+                                     GAsyncResult *result,
+                                     gpointer user_data)
+{
+  PipeContentsData *pipe_data = user_data;
+  GError *error = NULL;
+
+  /* a command that exits before reading everything, like head, is
+   * fine, and so is closing one of the tabs */
+  if (!terminal_screen_save_contents_finish (TERMINAL_SCREEN (object), result, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE)
+          && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        xfce_dialog_show_error (GTK_WINDOW (pipe_data->window), error,
+                                _("Failed to pipe terminal contents to \"%s\""), pipe_data->command);
+      g_error_free (error);
+    }
+
+  g_object_unref (pipe_data->cancellable);
+  g_object_unref (pipe_data->subprocess);
+  g_object_unref (pipe_data->window);
+  g_free (pipe_data->command);
+  g_slice_free (PipeContentsData, pipe_data);
+}
+
+
+
 static gboolean
 terminal_window_action_reset (TerminalWindow *window)
 {
@@ -3976,7 +4683,7 @@ terminal_window_update_terminal_menu (TerminalWindow *window,
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SET_TITLE), G_OBJECT (window), GTK_MENU_SHELL (menu));
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SET_TITLE_COLOR), G_OBJECT (window), GTK_MENU_SHELL (menu));
   xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
-  can_search = terminal_screen_search_has_gregex (window->priv->active);
+  can_search = terminal_search_get_n_matches (terminal_screen_get_search (window->priv->active)) > 0;
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SEARCH), G_OBJECT (window), GTK_MENU_SHELL (menu));
   item = xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SEARCH_NEXT), G_OBJECT (window), GTK_MENU_SHELL (menu));
   gtk_widget_set_sensitive (item, can_search);
@@ -3993,6 +4700,8 @@ terminal_window_update_terminal_menu (TerminalWindow *window,
   xfce_gtk_toggle_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SCROLL_ON_OUTPUT), G_OBJECT (window), terminal_screen_get_scroll_on_output (window->priv->active), GTK_MENU_SHELL (menu));
   xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_SAVE_CONTENTS), G_OBJECT (window), GTK_MENU_SHELL (menu));
+  xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_REPLAY_CONTENTS), G_OBJECT (window), GTK_MENU_SHELL (menu));
+  xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_PIPE_CONTENTS), G_OBJECT (window), GTK_MENU_SHELL (menu));
   xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
   terminal_window_menu_add_section (window, menu, MENU_SECTION_SIGNAL, TRUE);
   xfce_gtk_menu_item_new_from_action_entry (get_action_entry (TERMINAL_WINDOW_ACTION_RESET), G_OBJECT (window), GTK_MENU_SHELL (menu));
@@ -74,6 +74,8 @@ typedef enum
   TERMINAL_WINDOW_ACTION_SEARCH_NEXT,
   TERMINAL_WINDOW_ACTION_SEARCH_PREV,
   TERMINAL_WINDOW_ACTION_SAVE_CONTENTS,
+  TERMINAL_WINDOW_ACTION_REPLAY_CONTENTS,
+  TERMINAL_WINDOW_ACTION_PIPE_CONTENTS,
   TERMINAL_WINDOW_ACTION_RESET,
   TERMINAL_WINDOW_ACTION_RESET_AND_CLEAR,
   TERMINAL_WINDOW_ACTION_TABS_MENU,
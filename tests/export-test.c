@@ -0,0 +1,280 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks the encoders of terminal-export.c:
+ *
+ *   export-test
+ *
+ * Html as vte writes it is encoded as ANSI, and as cell runs that are
+ * replayed, and compared with the expected output. With a display, the
+ * html vte produces for colored output is encoded as well, so a change in
+ * the html of vte that the encoder depends on fails here.
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <vte/vte.h>
+
+#include "terminal/terminal-export.h"
+
+/* output buffer of the converters, small so output is split a lot */
+#define BUFFER_SIZE 7
+
+
+
+typedef struct _TestCase TestCase;
+
+struct _TestCase
+{
+  const gchar *name;
+  const gchar *html;
+  const gchar *ansi;
+};
+
+
+
+static const TestCase cases[] = {
+  { "attributes",
+    "<pre><b><i><u>a</u></i></b><strike>b</strike><blink>c</blink></pre>",
+    "\033[0;1;3;4ma\033[0;9mb\033[0;5mc\033[0m" },
+  { "colors",
+    "<pre><font color=\"#ff0000\">r<span style=\"background-color:#0000FF\">b</span></font>d</pre>",
+    "\033[0;38;2;255;0;0mr\033[0;38;2;255;0;0;48;2;0;0;255mb\033[0md" },
+  { "background over line ends",
+    "<pre><span style=\"background-color:#0000ff\">ab<br>\ncd<br>\n</span>e</pre>",
+    "\033[0;48;2;0;0;255mab\033[0m\r\n\033[0;48;2;0;0;255mcd\033[0m\r\ne" },
+  { "entities",
+    "<pre>a&lt;b&gt;&amp;&quot;&#x263a;&#9731;&bogus;</pre>",
+    "a<b>&\"\342\230\272\342\230\203" },
+};
+
+
+
+/* returns the output of @converter for all of @input, which may hold nul
+ * bytes, as do cell runs */
+static GBytes *
+test_convert (GConverter *converter,
+              const gchar *input,
+              gsize length)
+{
+  GByteArray *output = g_byte_array_new ();
+  GConverterResult result;
+  GError *error = NULL;
+  guchar buffer[BUFFER_SIZE];
+  gsize bytes_read;
+  gsize bytes_written;
+  gsize offset = 0;
+
+  do
+    {
+      result = g_converter_convert (converter, input + offset, length - offset,
+                                    buffer, sizeof (buffer), G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written, &error);
+      if (result == G_CONVERTER_ERROR)
+        g_error ("Failed to convert: %s", error->message);
+
+      offset += bytes_read;
+      g_byte_array_append (output, buffer, bytes_written);
+    }
+  while (result != G_CONVERTER_FINISHED);
+
+  return g_byte_array_free_to_bytes (output);
+}
+
+
+
+static gchar *
+test_encode (TerminalExportFormat format,
+             const gchar *html)
+{
+  GConverter *converter;
+  GBytes *encoded;
+  GBytes *replayed;
+  gchar *output;
+  gsize length;
+
+  converter = terminal_export_encoder_new (format, TRUE);
+  encoded = test_convert (converter, html, strlen (html));
+  g_object_unref (converter);
+
+  /* cell runs are compared by what they replay as */
+  if (format == TERMINAL_EXPORT_FORMAT_CELL_RUNS)
+    {
+      converter = terminal_export_replayer_new ();
+      replayed = test_convert (converter, g_bytes_get_data (encoded, &length), length);
+      g_object_unref (converter);
+      g_bytes_unref (encoded);
+      encoded = replayed;
+    }
+
+  output = g_strndup (g_bytes_get_data (encoded, NULL), g_bytes_get_size (encoded));
+  g_bytes_unref (encoded);
+
+  return output;
+}
+
+
+
+static gboolean
+test_expect (const gchar *name,
+             const gchar *kind,
+             const gchar *output,
+             const gchar *expected)
+{
+  gchar *escaped_output;
+  gchar *escaped_expected;
+
+  if (strcmp (output, expected) == 0)
+    return TRUE;
+
+  escaped_output = g_strescape (output, NULL);
+  escaped_expected = g_strescape (expected, NULL);
+  g_printerr ("%s, %s: got \"%s\", expected \"%s\"\n", name, kind, escaped_output, escaped_expected);
+  g_free (escaped_output);
+  g_free (escaped_expected);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+test_cases (void)
+{
+  const TestCase *test;
+  gboolean succeed = TRUE;
+  gchar *output;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      test = &cases[i];
+
+      output = test_encode (TERMINAL_EXPORT_FORMAT_ANSI, test->html);
+      succeed &= test_expect (test->name, "ansi", output, test->ansi);
+      g_free (output);
+
+      output = test_encode (TERMINAL_EXPORT_FORMAT_CELL_RUNS, test->html);
+      succeed &= test_expect (test->name, "cell runs", output, test->ansi);
+      g_free (output);
+    }
+
+  return succeed;
+}
+
+
+
+#if VTE_CHECK_VERSION(0, 72, 0)
+/* vte handles fed output from the main loop */
+static void
+test_vte_wait_for_output (VteTerminal *terminal,
+                          const gchar *last)
+{
+  gint64 deadline = g_get_monotonic_time () + 2 * G_USEC_PER_SEC;
+  gchar *text;
+  gboolean found = FALSE;
+
+  while (!found && g_get_monotonic_time () < deadline)
+    {
+      while (g_main_context_pending (NULL))
+        g_main_context_iteration (NULL, FALSE);
+
+      text = vte_terminal_get_text_range_format (terminal, VTE_FORMAT_TEXT, 0, 0, 1, 39, NULL);
+      found = text != NULL && strstr (text, last) != NULL;
+      g_free (text);
+    }
+}
+#endif
+
+
+
+/* encodes the html of colored output in a terminal, the exact colors
+ * depend on the palette, so only the attributes are looked for */
+static gboolean
+test_vte (void)
+{
+#if VTE_CHECK_VERSION(0, 72, 0)
+  static const gchar *expected[] = {
+    "\033[0;1;38;2;", "red",
+    "\033[0;48;2;", "blue",
+    "\033[0m\r\n", "plain",
+  };
+  VteTerminal *terminal;
+  const gchar *output;
+  gboolean succeed = TRUE;
+  gchar *html;
+  gchar *escaped;
+  gchar *encoded;
+  guint i;
+
+  terminal = VTE_TERMINAL (g_object_ref_sink (vte_terminal_new ()));
+  vte_terminal_set_size (terminal, 40, 5);
+  vte_terminal_feed (terminal, "\033[1;31mred\033[0m \033[44mblue\r\n\033[0mplain\r\n", -1);
+
+  test_vte_wait_for_output (terminal, "plain");
+
+  html = vte_terminal_get_text_range_format (terminal, VTE_FORMAT_HTML, 0, 0, 1, 39, NULL);
+  encoded = test_encode (TERMINAL_EXPORT_FORMAT_ANSI, html != NULL ? html : "");
+
+  /* in order */
+  output = encoded;
+  for (i = 0; i < G_N_ELEMENTS (expected) && succeed; i++)
+    {
+      output = strstr (output, expected[i]);
+      if (output == NULL)
+        {
+          escaped = g_strescape (expected[i], NULL);
+          g_printerr ("html of vte: \"%s\" not found in the output, the html was:\n%s\n", escaped, html);
+          g_free (escaped);
+          succeed = FALSE;
+        }
+      else
+        output += strlen (expected[i]);
+    }
+
+  g_free (encoded);
+  g_free (html);
+  g_object_unref (terminal);
+
+  return succeed;
+#else
+  g_print ("vte is older than 0.72, its html is not checked\n");
+  return TRUE;
+#endif
+}
+
+
+
+int
+main (int argc,
+      char **argv)
+{
+  gboolean succeed;
+
+  succeed = test_cases ();
+
+  if (gtk_init_check (&argc, &argv))
+    succeed &= test_vte ();
+  else
+    g_print ("no display, the html of vte is not checked\n");
+
+  return succeed ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times how fast output reaches the terminal pty through the relay of
+ * TerminalLog, against output written straight to the terminal pty:
+ *
+ *   log-bench [MEGABYTES]
+ *
+ * A thread writes the output into the pty a child would run on, the main
+ * thread reads it from the master of the terminal pty like vte does. The
+ * logged cases pass it through the second pty and copy it into a log file
+ * in a temporary directory, plain and gzip compressed.
+ */
+
+/* for ptsname () */
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "terminal/terminal-log.h"
+
+/* output written by default, in MiB */
+#define DEFAULT_MEGABYTES 256
+
+/* bytes written and read at once */
+#define CHUNK_SIZE (64 * 1024)
+
+
+
+typedef struct _BenchWriter BenchWriter;
+
+struct _BenchWriter
+{
+  gint fd;
+  gsize length;
+};
+
+
+
+/* the pty a child would write into, passing bytes unchanged */
+static gint
+bench_open_slave (VtePty *pty)
+{
+  struct termios tios;
+  const gchar *name;
+  gint fd;
+
+  name = ptsname (vte_pty_get_fd (pty));
+  if (name == NULL || (fd = open (name, O_RDWR | O_NOCTTY | O_CLOEXEC)) == -1)
+    g_error ("Failed to open the slave of a pty: %s", g_strerror (errno));
+
+  if (tcgetattr (fd, &tios) == 0)
+    {
+      cfmakeraw (&tios);
+      tcsetattr (fd, TCSANOW, &tios);
+    }
+
+  return fd;
+}
+
+
+
+/* lines of build output, so that compressing the log does real work */
+static gpointer
+bench_writer (gpointer data)
+{
+  BenchWriter *writer = data;
+  GString *chunk = g_string_new (NULL);
+  gsize written = 0;
+  gsize n;
+  gssize result;
+  guint line;
+  guint percent;
+
+  for (line = 0; chunk->len < CHUNK_SIZE; line++)
+    {
+      percent = line % 101;
+      g_string_append_printf (chunk, "  CC       terminal/terminal-%05u.o  [%3u%%] \033[32mok\033[0m\r\n",
+                              line, percent);
+    }
+
+  while (written < writer->length)
+    {
+      n = MIN (CHUNK_SIZE, writer->length - written);
+      result = write (writer->fd, chunk->str, n);
+      if (result < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          g_error ("Failed to write the output: %s", g_strerror (errno));
+        }
+      written += result;
+    }
+
+  g_string_free (chunk, TRUE);
+
+  return NULL;
+}
+
+
+
+/* returns the time the output takes to reach @pty, in seconds */
+static gdouble
+bench_read (VtePty *pty,
+            gint write_fd,
+            gsize length)
+{
+  BenchWriter writer = { write_fd, length };
+  struct pollfd fds;
+  GThread *thread;
+  guint8 *buffer;
+  gsize received = 0;
+  gssize n;
+  gint64 start;
+  gdouble seconds;
+
+  buffer = g_malloc (CHUNK_SIZE);
+  fds.fd = vte_pty_get_fd (pty);
+  fds.events = POLLIN;
+
+  start = g_get_monotonic_time ();
+  thread = g_thread_new ("bench-writer", bench_writer, &writer);
+
+  while (received < length)
+    {
+      n = read (fds.fd, buffer, CHUNK_SIZE);
+      if (n > 0)
+        received += n;
+      else if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        poll (&fds, 1, -1);
+      else
+        g_error ("Failed to read the output: %s", n < 0 ? g_strerror (errno) : "end of file");
+    }
+
+  seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  g_thread_join (thread);
+  g_free (buffer);
+
+  return seconds;
+}
+
+
+
+static gdouble
+bench_direct (gsize length)
+{
+  GError *error = NULL;
+  VtePty *pty;
+  gdouble seconds;
+  gint fd;
+
+  pty = vte_pty_new_sync (VTE_PTY_DEFAULT, NULL, &error);
+  if (pty == NULL)
+    g_error ("Failed to create a pty: %s", error->message);
+
+  fd = bench_open_slave (pty);
+  seconds = bench_read (pty, fd, length);
+
+  close (fd);
+  g_object_unref (pty);
+
+  return seconds;
+}
+
+
+
+static gdouble
+bench_logged (gsize length,
+              const gchar *filename,
+              gboolean compress)
+{
+  GError *error = NULL;
+  TerminalLog *log;
+  VtePty *pty;
+  VtePty *child_pty;
+  gdouble seconds;
+  gint fd;
+
+  log = terminal_log_new (filename, 0, compress, &error);
+  if (log == NULL)
+    g_error ("Failed to open the log: %s", error->message);
+
+  pty = vte_pty_new_sync (VTE_PTY_DEFAULT, NULL, &error);
+  if (pty == NULL)
+    g_error ("Failed to create a pty: %s", error->message);
+
+  child_pty = terminal_log_create_pty (log, pty, &error);
+  if (child_pty == NULL)
+    g_error ("Failed to create the child pty: %s", error->message);
+
+  /* like a spawned child, the slave has to be open before starting */
+  fd = bench_open_slave (child_pty);
+  terminal_log_start (log);
+
+  seconds = bench_read (pty, fd, length);
+
+  /* hangs up the child pty, which ends the relay and the writer */
+  close (fd);
+  g_object_unref (child_pty);
+  g_object_unref (log);
+  g_object_unref (pty);
+
+  return seconds;
+}
+
+
+
+int
+main (int argc,
+      char **argv)
+{
+  GError *error = NULL;
+  gchar *directory;
+  gchar *filename;
+  gsize megabytes = DEFAULT_MEGABYTES;
+  gsize length;
+  gdouble seconds;
+
+  if (argc > 1)
+    megabytes = MAX (1, g_ascii_strtoll (argv[1], NULL, 10));
+  length = megabytes * 1024 * 1024;
+
+  directory = g_dir_make_tmp ("log-bench-XXXXXX", &error);
+  if (directory == NULL)
+    g_error ("Failed to create a directory: %s", error->message);
+
+  g_print ("%" G_GSIZE_FORMAT " MiB of output\n", megabytes);
+
+  seconds = bench_direct (length);
+  g_print ("%-14s %9.1f MiB/s\n", "direct", megabytes / seconds);
+
+  filename = g_build_filename (directory, "plain.log", NULL);
+  seconds = bench_logged (length, filename, FALSE);
+  g_print ("%-14s %9.1f MiB/s\n", "logged", megabytes / seconds);
+  g_unlink (filename);
+  g_free (filename);
+
+  filename = g_build_filename (directory, "compressed.log.gz", NULL);
+  seconds = bench_logged (length, filename, TRUE);
+  g_print ("%-14s %9.1f MiB/s\n", "logged, gzip", megabytes / seconds);
+  g_unlink (filename);
+  g_free (filename);
+
+  /* the writer threads may still finish their logs, which is not timed */
+  g_rmdir (directory);
+  g_free (directory);
+
+  return 0;
+}
@@ -0,0 +1,698 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs the url patterns of terminal-widget.c over generated terminal output.
+ *
+ *   regex-bench          reports MB/s and the slowest line of each corpus, for
+ *                        the combined pattern and for the separate patterns
+ *   regex-bench --check  fails when the combined pattern misses a link one of
+ *                        the separate patterns finds, when the kind of a link
+ *                        read from its text differs from the one found in the
+ *                        line, when REGEX_LIMITS cut off a link, or when a
+ *                        pathological line takes too long
+ */
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#define PCRE2_CODE_UNIT_WIDTH 0
+#include <glib.h>
+#include <pcre2.h>
+
+#include "terminal/terminal-regex.h"
+
+/* same flags as the matchers handed to vte */
+#define MATCH_FLAGS (PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE)
+
+/* lines of the generated realistic corpus */
+#define N_REALISTIC_LINES 20000
+
+/* size of the long lines, and the pathological lines are repeated up to, about
+ * a wrapped paragraph */
+#define LONG_LINE_SIZE (8 * 1024)
+
+/* a single line must never stall the UI for this long, in microseconds; the
+ * slowest line takes a few milliseconds, this leaves room for slow machines */
+#define MAX_LINE_TIME (50 * 1000)
+
+
+
+typedef struct _BenchPattern BenchPattern;
+typedef struct _BenchMatcher BenchMatcher;
+typedef struct _BenchResult BenchResult;
+
+struct _BenchPattern
+{
+  const gchar *name;
+  const gchar *pattern;
+};
+
+struct _BenchMatcher
+{
+  pcre2_code_8 *code;
+  pcre2_match_data_8 *match_data;
+};
+
+struct _BenchResult
+{
+  gint64 time;
+  gint64 slowest_time;
+  guint slowest_line;
+  guint n_links;
+  guint n_limits;
+  guint n_errors;
+};
+
+
+
+/* keep in sync with regex_patterns of terminal-widget.c, in the same order;
+ * the names are those of the groups in REGEX_URL_ANY */
+static const BenchPattern patterns[] = {
+  { "URL_AS_IS", REGEX_LIMITS REGEX_URL_AS_IS },
+  { "URL_HTTP", REGEX_LIMITS REGEX_URL_HTTP },
+  { "URL_FILE", REGEX_LIMITS REGEX_URL_FILE },
+  { "EMAIL", REGEX_LIMITS REGEX_EMAIL },
+  { "NEWS_MAN", REGEX_LIMITS REGEX_NEWS_MAN },
+};
+
+/* %s is replaced by a random word, so that the lines are not all equal */
+static const gchar *realistic_lines[] = {
+  "drwxr-xr-x  2 joe users     4096 Oct 18 05:50 %s",
+  "-rw-r--r--  1 joe users   123456 Oct 18 05:50 %s.tar.gz",
+  "joe@build-host:~/src/%s$ make -j8",
+  "Author: Jane Doe <jane.doe@example.org>",
+  "    Reviewed-by: %s <%s@lists.example.net>",
+  "See https://docs.xfce.org/apps/terminal/%s for details.",
+  "Cloning into '%s'... from git@gitlab.xfce.org:apps/xfce4-terminal.git",
+  "../terminal/terminal-%s.c:1234:5: warning: unused variable '%s' [-Wunused-variable]",
+  "2026-10-18T05:50:17 192.168.1.23 - GET /%s/index.html?q=1&lang=en HTTP/1.1 200",
+  "[%s](http://example.com/wiki/Foo_(bar)) and www.example.com/%s",
+  "mail joe@www.example.com or try ftp.example.org:2121/pub/%s",
+  "file:///home/joe/%s.txt  news:comp.os.linux.misc  man:bash(1)",
+  "inet6 fe80::1ff:fe23:4567:890a/64 scope link, see http://[::1]:8080/%s",
+  "'http://example.com/%s' and sips:alice@atlanta.example.com;transport=tcp",
+  "  %s = g_strdup_printf (\"%%s/%%s\", dir, name);",
+  "E: Unable to fetch some archives, try apt-get update or https://deb.example.org/%s/",
+  "magnet:?xt=urn:btih:%s&dn=image.iso  telnet://towel.blinkenlights.nl",
+  "%s",
+};
+
+static const gchar *words[] = {
+  "terminal", "widget", "README", "screen", "x86_64", "config.status", "ChangeLog",
+  "build-aux", "v1.2.0", "foo.bar.baz", "Ünïcödé", "路径", "with'quote", "a(b)c",
+};
+
+/* repeated up to LONG_LINE_SIZE, each makes some pattern backtrack a lot */
+static const gchar *pathological_units[] = {
+  "a.",
+  "a-",
+  "www.a",
+  "1.",
+  "1:",
+  "a:",
+  "a@",
+  "joe:",
+  "((",
+  "([",
+  "http://",
+  "http://example.com/(",
+  "http://example.com/a(",
+  "file:/",
+  "news:",
+  "a",
+};
+
+
+
+static BenchMatcher *
+bench_matcher_new (const gchar *pattern,
+                   guint32 flags,
+                   gboolean jit)
+{
+  BenchMatcher *matcher;
+  gint error_number;
+  PCRE2_SIZE error_offset;
+  PCRE2_UCHAR8 message[256];
+
+  matcher = g_slice_new0 (BenchMatcher);
+  matcher->code = pcre2_compile_8 ((PCRE2_SPTR8) pattern, PCRE2_ZERO_TERMINATED, flags,
+                                   &error_number, &error_offset, NULL);
+  if (matcher->code == NULL)
+    {
+      pcre2_get_error_message_8 (error_number, message, sizeof (message));
+      g_error ("Failed to compile regex at offset %" G_GSIZE_FORMAT ": %s", (gsize) error_offset, message);
+    }
+
+  if (jit && pcre2_jit_compile_8 (matcher->code, PCRE2_JIT_COMPLETE) != 0)
+    g_printerr ("Failed to JIT regex, using the interpreter\n");
+
+  matcher->match_data = pcre2_match_data_create_from_pattern_8 (matcher->code, NULL);
+
+  return matcher;
+}
+
+
+
+static void
+bench_matcher_free (BenchMatcher *matcher)
+{
+  pcre2_match_data_free_8 (matcher->match_data);
+  pcre2_code_free_8 (matcher->code);
+  g_slice_free (BenchMatcher, matcher);
+}
+
+
+
+/* finds the links of @line like vte does, one match after the other, and
+ * marks the bytes they cover with @mark in @marks, unless already marked */
+static void
+bench_scan_line (BenchMatcher *matcher,
+                 const gchar *line,
+                 gsize length,
+                 guchar *marks,
+                 guchar mark,
+                 BenchResult *result)
+{
+  PCRE2_SIZE *ovector;
+  PCRE2_SIZE offset = 0;
+  PCRE2_SIZE n;
+  gint rc;
+
+  while (offset < length)
+    {
+      rc = pcre2_match_8 (matcher->code, (PCRE2_SPTR8) line, length, offset,
+                          PCRE2_NO_UTF_CHECK, matcher->match_data, NULL);
+      if (rc == PCRE2_ERROR_NOMATCH)
+        break;
+
+      if (rc < 0)
+        {
+          /* vte gives up on the rest of the line as well */
+          if (rc == PCRE2_ERROR_MATCHLIMIT
+              || rc == PCRE2_ERROR_RECURSIONLIMIT
+              || rc == PCRE2_ERROR_JIT_STACKLIMIT)
+            result->n_limits++;
+          else
+            result->n_errors++;
+          break;
+        }
+
+      ovector = pcre2_get_ovector_pointer_8 (matcher->match_data);
+      if (ovector[1] == ovector[0])
+        {
+          offset = ovector[1] + 1;
+          continue;
+        }
+
+      result->n_links++;
+      if (marks != NULL)
+        for (n = ovector[0]; n < ovector[1]; n++)
+          if (marks[n] == 0)
+            marks[n] = mark;
+
+      offset = ovector[1];
+    }
+}
+
+
+
+/* returns the index in patterns of the group that took part in the last match of @matcher */
+static gint
+bench_matcher_get_kind (BenchMatcher *matcher)
+{
+  PCRE2_SIZE *ovector = pcre2_get_ovector_pointer_8 (matcher->match_data);
+  gint number;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+    {
+      number = pcre2_substring_number_from_name_8 (matcher->code, (PCRE2_SPTR8) patterns[i].name);
+      if (number > 0
+          && (guint) number < pcre2_get_ovector_count_8 (matcher->match_data)
+          && ovector[2 * number] != PCRE2_UNSET)
+        return i;
+    }
+
+  return -1;
+}
+
+
+
+/* scans all of @lines with each of @matchers in turn, like one vte match tag each */
+static void
+bench_scan (BenchMatcher **matchers,
+            guint n_matchers,
+            GPtrArray *lines,
+            BenchResult *result)
+{
+  const gchar *line;
+  gint64 start;
+  gint64 line_time;
+  guint i, j;
+
+  memset (result, 0, sizeof (*result));
+
+  for (i = 0; i < lines->len; i++)
+    {
+      line = g_ptr_array_index (lines, i);
+
+      start = g_get_monotonic_time ();
+      for (j = 0; j < n_matchers; j++)
+        bench_scan_line (matchers[j], line, strlen (line), NULL, 0, result);
+      line_time = g_get_monotonic_time () - start;
+
+      result->time += line_time;
+      if (line_time > result->slowest_time)
+        {
+          result->slowest_time = line_time;
+          result->slowest_line = i;
+        }
+    }
+}
+
+
+
+static gsize
+bench_corpus_size (GPtrArray *lines)
+{
+  gsize size = 0;
+  guint i;
+
+  for (i = 0; i < lines->len; i++)
+    size += strlen (g_ptr_array_index (lines, i)) + 1;
+
+  return size;
+}
+
+
+
+static GPtrArray *
+bench_corpus_realistic (void)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+  GRand *rand = g_rand_new_with_seed (1);
+  GString *line = g_string_new (NULL);
+  const gchar *template;
+  const gchar *p;
+  guint i;
+
+  for (i = 0; i < N_REALISTIC_LINES; i++)
+    {
+      template = realistic_lines[g_rand_int_range (rand, 0, G_N_ELEMENTS (realistic_lines))];
+
+      g_string_truncate (line, 0);
+      for (p = template; *p != '\0'; p++)
+        {
+          if (p[0] == '%' && p[1] == 's')
+            {
+              g_string_append (line, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+              p++;
+            }
+          else if (p[0] == '%' && p[1] == '%')
+            {
+              g_string_append_c (line, '%');
+              p++;
+            }
+          else
+            g_string_append_c (line, *p);
+        }
+
+      g_ptr_array_add (lines, g_strdup (line->str));
+    }
+
+  g_string_free (line, TRUE);
+  g_rand_free (rand);
+
+  return lines;
+}
+
+
+
+/* the realistic lines joined into paragraphs, with links far from the start */
+static GPtrArray *
+bench_corpus_long (GPtrArray *realistic)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+  GString *line = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < realistic->len; i++)
+    {
+      g_string_append (line, g_ptr_array_index (realistic, i));
+      if (line->len >= LONG_LINE_SIZE || i == realistic->len - 1)
+        {
+          g_ptr_array_add (lines, g_strdup (line->str));
+          g_string_truncate (line, 0);
+        }
+      else
+        g_string_append_c (line, ' ');
+    }
+
+  g_string_free (line, TRUE);
+
+  return lines;
+}
+
+
+
+static GPtrArray *
+bench_corpus_pathological (void)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+  GString *line;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (pathological_units); i++)
+    {
+      line = g_string_new (NULL);
+      while (line->len < LONG_LINE_SIZE)
+        g_string_append (line, pathological_units[i]);
+      g_ptr_array_add (lines, g_string_free (line, FALSE));
+    }
+
+  return lines;
+}
+
+
+
+static void
+bench_report (const gchar *corpus,
+              const gchar *matcher,
+              GPtrArray *lines,
+              const BenchResult *result)
+{
+  gdouble megabytes = bench_corpus_size (lines) / (1024.0 * 1024.0);
+  gdouble seconds = MAX (result->time, 1) / (gdouble) G_USEC_PER_SEC;
+
+  /* the start of a pathological line shows which unit it repeats */
+  g_print ("%-12s %-21s %9.2f MB/s  slowest line %7" G_GINT64_FORMAT " us (\"%.20s\")  links %u  limits hit %u\n",
+           corpus, matcher, megabytes / seconds, result->slowest_time,
+           (const gchar *) g_ptr_array_index (lines, result->slowest_line),
+           result->n_links, result->n_limits);
+}
+
+
+
+/* the combined pattern only finds the links, so every byte a separate
+ * pattern marks as a link must be found by it too */
+static gboolean
+bench_check_links (BenchMatcher *combined,
+                   BenchMatcher **separate,
+                   GPtrArray *lines)
+{
+  BenchResult result;
+  const gchar *line;
+  gsize length;
+  guchar *old_marks;
+  guchar *new_marks;
+  gsize n;
+  guint lost = 0, extra = 0, resolved[G_N_ELEMENTS (patterns)] = { 0 };
+  guint line_lost;
+  guint n_reported = 0;
+  guint i, j;
+
+  memset (&result, 0, sizeof (result));
+
+  for (i = 0; i < lines->len; i++)
+    {
+      line = g_ptr_array_index (lines, i);
+      length = strlen (line);
+      old_marks = g_malloc0 (length);
+      new_marks = g_malloc0 (length);
+
+      /* the first pattern in order wins, as with one vte tag each */
+      for (j = 0; j < G_N_ELEMENTS (patterns); j++)
+        bench_scan_line (separate[j], line, length, old_marks, j + 1, &result);
+      bench_scan_line (combined, line, length, new_marks, 1, &result);
+
+      line_lost = 0;
+      for (n = 0; n < length; n++)
+        {
+          if (old_marks[n] != 0 && new_marks[n] == 0)
+            line_lost++;
+          else if (old_marks[n] == 0 && new_marks[n] != 0)
+            extra++;
+          else if (old_marks[n] != 0)
+            resolved[old_marks[n] - 1]++;
+        }
+
+      lost += line_lost;
+      if (line_lost > 0 && n_reported++ < 5)
+        g_printerr ("link missed by the combined pattern in line #%u: %s\n", i, line);
+
+      g_free (old_marks);
+      g_free (new_marks);
+    }
+
+  g_print ("bytes of links resolved by");
+  for (j = 0; j < G_N_ELEMENTS (patterns); j++)
+    g_print (" %s %u", patterns[j].name, resolved[j]);
+  g_print (", only found by the combined pattern %u, missed %u\n", extra, lost);
+
+  return lost == 0 && result.n_errors == 0;
+}
+
+
+
+/* the widget only gets the text of a highlighted link from vte, and reads
+ * its kind from that with @whole. That has to be the kind the combined
+ * pattern found in the line, or the link opens as something else than
+ * what was highlighted */
+static gboolean
+bench_check_kinds (BenchMatcher *combined,
+                   BenchMatcher *whole,
+                   GPtrArray *lines)
+{
+  PCRE2_SIZE *ovector;
+  PCRE2_SIZE offset;
+  const gchar *line;
+  gsize length;
+  gint kind;
+  gint rc;
+  guint n_links = 0, n_differ = 0;
+  guint i;
+
+  for (i = 0; i < lines->len; i++)
+    {
+      line = g_ptr_array_index (lines, i);
+      length = strlen (line);
+
+      for (offset = 0; offset < length; offset = MAX (ovector[1], ovector[0] + 1))
+        {
+          rc = pcre2_match_8 (combined->code, (PCRE2_SPTR8) line, length, offset,
+                              PCRE2_NO_UTF_CHECK, combined->match_data, NULL);
+          if (rc < 0)
+            break;
+
+          ovector = pcre2_get_ovector_pointer_8 (combined->match_data);
+          if (ovector[1] == ovector[0])
+            continue;
+
+          n_links++;
+          kind = bench_matcher_get_kind (combined);
+
+          rc = pcre2_match_8 (whole->code, (PCRE2_SPTR8) line + ovector[0], ovector[1] - ovector[0], 0,
+                              PCRE2_NO_UTF_CHECK, whole->match_data, NULL);
+          if (rc < 0 || bench_matcher_get_kind (whole) != kind)
+            {
+              if (n_differ++ < 5)
+                g_printerr ("kind of link \"%.*s\" differs from the one in line #%u: %s\n",
+                            (gint) (ovector[1] - ovector[0]), line + ovector[0], i, line);
+            }
+        }
+    }
+
+  g_print ("links %u, read as another kind from their text %u\n", n_links, n_differ);
+
+  return n_differ == 0;
+}
+
+
+
+/* REGEX_LIMITS must only stop runaway backtracking, so @combined has to find
+ * every byte of a link @unlimited, the same pattern without them, finds */
+static gboolean
+bench_check_unlimited (BenchMatcher *combined,
+                       BenchMatcher *unlimited,
+                       GPtrArray *lines,
+                       const gchar *corpus)
+{
+  BenchResult result;
+  const gchar *line;
+  gsize length;
+  guchar *limited_marks;
+  guchar *unlimited_marks;
+  gsize n;
+  guint lost = 0;
+  guint i;
+
+  memset (&result, 0, sizeof (result));
+
+  for (i = 0; i < lines->len; i++)
+    {
+      line = g_ptr_array_index (lines, i);
+      length = strlen (line);
+      limited_marks = g_malloc0 (length);
+      unlimited_marks = g_malloc0 (length);
+
+      bench_scan_line (combined, line, length, limited_marks, 1, &result);
+      bench_scan_line (unlimited, line, length, unlimited_marks, 1, &result);
+
+      for (n = 0; n < length; n++)
+        if (unlimited_marks[n] != 0 && limited_marks[n] == 0)
+          lost++;
+
+      g_free (limited_marks);
+      g_free (unlimited_marks);
+    }
+
+  g_print ("%s: bytes of links cut off by REGEX_LIMITS %u, limits hit %u\n", corpus, lost, result.n_limits);
+
+  return lost == 0 && result.n_limits == 0 && result.n_errors == 0;
+}
+
+
+
+/* every pathological line must be done quickly, either because it has no
+ * links or because a limit stops the search, and not with other errors.
+ * Some line also has to run into REGEX_LIMITS, to show they are still in
+ * force */
+static gboolean
+bench_check_limits (BenchMatcher **matchers,
+                    guint n_matchers,
+                    GPtrArray *lines,
+                    const gchar *name)
+{
+  BenchResult result;
+  GPtrArray *line;
+  gboolean succeed = TRUE;
+  guint n_limits = 0;
+  guint i;
+
+  for (i = 0; i < lines->len; i++)
+    {
+      line = g_ptr_array_new ();
+      g_ptr_array_add (line, g_ptr_array_index (lines, i));
+      bench_scan (matchers, n_matchers, line, &result);
+      g_ptr_array_unref (line);
+
+      n_limits += result.n_limits;
+      if (result.n_errors > 0 || result.slowest_time > MAX_LINE_TIME)
+        {
+          g_printerr ("%s: pathological line of \"%s\" took %" G_GINT64_FORMAT " us, %u errors\n",
+                      name, pathological_units[i], result.slowest_time, result.n_errors);
+          succeed = FALSE;
+        }
+    }
+
+  if (n_limits == 0)
+    {
+      g_printerr ("%s: no pathological line ran into REGEX_LIMITS\n", name);
+      succeed = FALSE;
+    }
+
+  return succeed;
+}
+
+
+
+int
+main (int argc,
+      char **argv)
+{
+  GPtrArray *realistic;
+  GPtrArray *long_lines;
+  GPtrArray *pathological;
+  BenchMatcher *combined;
+  BenchMatcher *combined_interpreted;
+  BenchMatcher *unlimited;
+  BenchMatcher *whole;
+  BenchMatcher *separate[G_N_ELEMENTS (patterns)];
+  BenchMatcher *separate_interpreted[G_N_ELEMENTS (patterns)];
+  BenchResult result;
+  gboolean check;
+  gboolean succeed = TRUE;
+  guint i;
+
+  check = argc > 1 && g_strcmp0 (argv[1], "--check") == 0;
+
+  realistic = bench_corpus_realistic ();
+  long_lines = bench_corpus_long (realistic);
+  pathological = bench_corpus_pathological ();
+
+  /* vte jits its matchers, the recursion limit only holds for the interpreter */
+  combined = bench_matcher_new (REGEX_LIMITS REGEX_URL_ANY, MATCH_FLAGS, TRUE);
+  combined_interpreted = bench_matcher_new (REGEX_LIMITS REGEX_URL_ANY, MATCH_FLAGS, FALSE);
+  unlimited = bench_matcher_new (REGEX_URL_ANY, MATCH_FLAGS, TRUE);
+  whole = bench_matcher_new (REGEX_URL_ANY_WHOLE, MATCH_FLAGS | PCRE2_ANCHORED, TRUE);
+  for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+    {
+      separate[i] = bench_matcher_new (patterns[i].pattern, MATCH_FLAGS, TRUE);
+      separate_interpreted[i] = bench_matcher_new (patterns[i].pattern, MATCH_FLAGS, FALSE);
+    }
+
+  if (check)
+    {
+      succeed &= bench_check_links (combined, separate, realistic);
+      succeed &= bench_check_kinds (combined, whole, realistic);
+      succeed &= bench_check_unlimited (combined, unlimited, realistic, "realistic");
+      succeed &= bench_check_unlimited (combined, unlimited, long_lines, "long");
+      succeed &= bench_check_limits (&combined, 1, pathological, "combined");
+      succeed &= bench_check_limits (&combined_interpreted, 1, pathological, "combined, interpreted");
+      succeed &= bench_check_limits (separate, G_N_ELEMENTS (patterns), pathological, "separate");
+      succeed &= bench_check_limits (separate_interpreted, G_N_ELEMENTS (patterns), pathological, "separate, interpreted");
+    }
+  else
+    {
+      bench_scan (&combined, 1, realistic, &result);
+      bench_report ("realistic", "combined", realistic, &result);
+      bench_scan (separate, G_N_ELEMENTS (patterns), realistic, &result);
+      bench_report ("realistic", "separate", realistic, &result);
+
+      bench_scan (&combined, 1, long_lines, &result);
+      bench_report ("long", "combined", long_lines, &result);
+      bench_scan (separate, G_N_ELEMENTS (patterns), long_lines, &result);
+      bench_report ("long", "separate", long_lines, &result);
+
+      bench_scan (&combined, 1, pathological, &result);
+      bench_report ("pathological", "combined", pathological, &result);
+      bench_scan (separate, G_N_ELEMENTS (patterns), pathological, &result);
+      bench_report ("pathological", "separate", pathological, &result);
+      bench_scan (&combined_interpreted, 1, pathological, &result);
+      bench_report ("pathological", "combined, interpreted", pathological, &result);
+      bench_scan (separate_interpreted, G_N_ELEMENTS (patterns), pathological, &result);
+      bench_report ("pathological", "separate, interpreted", pathological, &result);
+    }
+
+  bench_matcher_free (combined);
+  bench_matcher_free (combined_interpreted);
+  bench_matcher_free (unlimited);
+  bench_matcher_free (whole);
+  for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+    {
+      bench_matcher_free (separate[i]);
+      bench_matcher_free (separate_interpreted[i]);
+    }
+
+  g_ptr_array_unref (realistic);
+  g_ptr_array_unref (long_lines);
+  g_ptr_array_unref (pathological);
+
+  return succeed ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times terminal_image_resample() against single threaded resampling of the
+ * same background, on the sizes of large displays:
+ *
+ *   resample-bench [ITERATIONS]
+ *
+ * For each case it reports the best time of terminal_image_resample(), of
+ * cairo with CAIRO_FILTER_GOOD as the image loader used before, and of
+ * gdk_pixbuf_scale() with GDK_INTERP_BILINEAR, and how far the result is
+ * from the one of gdk-pixbuf, in levels of a color channel.
+ */
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "terminal/terminal-image-resampler.h"
+
+/* runs of each path, the best one is reported */
+#define DEFAULT_ITERATIONS 10
+
+
+
+typedef struct _BenchCase BenchCase;
+typedef struct _BenchData BenchData;
+
+typedef void (*BenchFunc) (BenchData *data);
+
+struct _BenchCase
+{
+  const gchar *name;
+  gint source_width;
+  gint source_height;
+  gint target_width;
+  gint target_height;
+  gboolean fill;
+};
+
+struct _BenchData
+{
+  const BenchCase *bench;
+  gdouble x_offset;
+  gdouble y_offset;
+  gdouble x_scale;
+  gdouble y_scale;
+
+  cairo_surface_t *source;
+  cairo_surface_t *target;
+  GdkPixbuf *source_pixbuf;
+  GdkPixbuf *target_pixbuf;
+};
+
+
+
+/* stretched unless filled, like the background styles */
+static const BenchCase cases[] = {
+  { "stretch 1080p to 5K", 1920, 1080, 5120, 2880, FALSE },
+  { "stretch 4K to 5K", 3840, 2160, 5120, 2880, FALSE },
+  { "stretch 8K to 1440p", 7680, 4320, 2560, 1440, FALSE },
+  { "fill 1920x1200 to 5K", 1920, 1200, 5120, 2880, TRUE },
+};
+
+
+
+/* a gradient with a fine checkerboard on top, so that both smooth areas
+ * and sharp edges go through the filters */
+static cairo_surface_t *
+bench_source_new (gint width,
+                  gint height)
+{
+  cairo_surface_t *surface;
+  guint32 *row;
+  guchar *data;
+  gint stride;
+  guint32 r, g, b;
+  gint x, y;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < height; ++y)
+    {
+      row = (guint32 *) (data + (gsize) y * stride);
+      for (x = 0; x < width; ++x)
+        {
+          r = x * 255 / width;
+          g = y * 255 / height;
+          b = ((x / 4 + y / 4) % 2 == 0) ? 0xff : 0x00;
+          row[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+        }
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+
+
+static GdkPixbuf *
+bench_pixbuf_new_from_surface (cairo_surface_t *surface)
+{
+  GdkPixbuf *pixbuf;
+  const guint32 *row;
+  const guchar *data;
+  guchar *pixels;
+  guchar *p;
+  gint width = cairo_image_surface_get_width (surface);
+  gint height = cairo_image_surface_get_height (surface);
+  gint stride = cairo_image_surface_get_stride (surface);
+  gint rowstride;
+  gint x, y;
+
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  /* opaque, so there is nothing to unpremultiply */
+  for (y = 0; y < height; ++y)
+    {
+      row = (const guint32 *) (data + (gsize) y * stride);
+      p = pixels + (gsize) y * rowstride;
+      for (x = 0; x < width; ++x, p += 3)
+        {
+          p[0] = (row[x] >> 16) & 0xff;
+          p[1] = (row[x] >> 8) & 0xff;
+          p[2] = row[x] & 0xff;
+        }
+    }
+
+  return pixbuf;
+}
+
+
+
+static void
+bench_resample (BenchData *data)
+{
+  cairo_rectangle_int_t area = { 0, 0, data->bench->target_width, data->bench->target_height };
+
+  terminal_image_resample (data->source, data->target, &area,
+                           data->x_offset, data->y_offset,
+                           data->x_scale, data->y_scale);
+}
+
+
+
+static void
+bench_cairo (BenchData *data)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (data->target);
+  cairo_translate (cr, data->x_offset, data->y_offset);
+  cairo_scale (cr, data->x_scale, data->y_scale);
+  cairo_set_source_surface (cr, data->source, 0, 0);
+  cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+  cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_GOOD);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  cairo_surface_flush (data->target);
+}
+
+
+
+static void
+bench_pixbuf (BenchData *data)
+{
+  gdk_pixbuf_scale (data->source_pixbuf, data->target_pixbuf,
+                    0, 0, data->bench->target_width, data->bench->target_height,
+                    data->x_offset, data->y_offset,
+                    data->x_scale, data->y_scale,
+                    GDK_INTERP_BILINEAR);
+}
+
+
+
+/* returns the best time of @iterations runs of @func, in milliseconds */
+static gdouble
+bench_time (BenchFunc func,
+            BenchData *data,
+            gint iterations)
+{
+  gint64 best = G_MAXINT64;
+  gint64 start;
+  gint n;
+
+  for (n = 0; n < iterations; ++n)
+    {
+      start = g_get_monotonic_time ();
+      func (data);
+      best = MIN (best, g_get_monotonic_time () - start);
+    }
+
+  return best / 1000.0;
+}
+
+
+
+/* compares the color channels of the resampled target with gdk-pixbuf */
+static void
+bench_compare (BenchData *data,
+               gdouble *mean,
+               guint *max)
+{
+  const guint32 *row;
+  const guchar *target;
+  const guchar *pixels;
+  const guchar *p;
+  gint width = data->bench->target_width;
+  gint height = data->bench->target_height;
+  gint stride;
+  gint rowstride;
+  guint64 total = 0;
+  guint difference;
+  gint x, y, c;
+
+  cairo_surface_flush (data->target);
+  target = cairo_image_surface_get_data (data->target);
+  stride = cairo_image_surface_get_stride (data->target);
+  pixels = gdk_pixbuf_get_pixels (data->target_pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (data->target_pixbuf);
+
+  *max = 0;
+  for (y = 0; y < height; ++y)
+    {
+      row = (const guint32 *) (target + (gsize) y * stride);
+      p = pixels + (gsize) y * rowstride;
+      for (x = 0; x < width; ++x, p += 3)
+        for (c = 0; c < 3; ++c)
+          {
+            difference = ABS ((gint) ((row[x] >> (16 - 8 * c)) & 0xff) - (gint) p[c]);
+            total += difference;
+            *max = MAX (*max, difference);
+          }
+    }
+
+  *mean = (gdouble) total / ((gdouble) width * height * 3);
+}
+
+
+
+int
+main (int argc,
+      char **argv)
+{
+  const BenchCase *bench;
+  BenchData data;
+  gdouble resample_time;
+  gdouble cairo_time;
+  gdouble pixbuf_time;
+  gdouble mean;
+  guint max;
+  gint iterations = DEFAULT_ITERATIONS;
+  guint i;
+
+  if (argc > 1)
+    iterations = MAX (1, (gint) g_ascii_strtoll (argv[1], NULL, 10));
+
+  g_print ("%u threads, best of %d runs\n", g_get_num_processors (), iterations);
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      bench = &cases[i];
+      data.bench = bench;
+
+      data.x_scale = (gdouble) bench->target_width / bench->source_width;
+      data.y_scale = (gdouble) bench->target_height / bench->source_height;
+      data.x_offset = 0.0;
+      data.y_offset = 0.0;
+      if (bench->fill)
+        {
+          /* the larger scale for both directions, centered */
+          data.x_scale = data.y_scale = MAX (data.x_scale, data.y_scale);
+          data.x_offset = (bench->target_width - bench->source_width * data.x_scale) * 0.5;
+          data.y_offset = (bench->target_height - bench->source_height * data.y_scale) * 0.5;
+        }
+
+      data.source = bench_source_new (bench->source_width, bench->source_height);
+      data.target = cairo_image_surface_create (CAIRO_FORMAT_RGB24, bench->target_width, bench->target_height);
+      data.source_pixbuf = bench_pixbuf_new_from_surface (data.source);
+      data.target_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, bench->target_width, bench->target_height);
+
+      cairo_time = bench_time (bench_cairo, &data, iterations);
+      pixbuf_time = bench_time (bench_pixbuf, &data, iterations);
+
+      /* last, so that the target holds its result for the comparison */
+      resample_time = bench_time (bench_resample, &data, iterations);
+      bench_compare (&data, &mean, &max);
+
+      g_print ("%-22s resample %8.2f ms  cairo %8.2f ms  gdk-pixbuf %8.2f ms  "
+               "difference to gdk-pixbuf: mean %.2f, max %u\n",
+               bench->name, resample_time, cairo_time, pixbuf_time, mean, max);
+
+      cairo_surface_destroy (data.source);
+      cairo_surface_destroy (data.target);
+      g_object_unref (data.source_pixbuf);
+      g_object_unref (data.target_pixbuf);
+    }
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+/*-
+ * Copyright (c) 2026 The Xfce Development Team
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times terminal_search_all() over tabs with a full scrollback:
+ *
+ *   search-all-bench          reports the time until the results are there,
+ *                             and the longest the main loop was held up
+ *   search-all-bench --check  fails when the search takes a second or more
+ *
+ * The tabs are terminals in an offscreen window, so a display is needed,
+ * without one the benchmark is skipped.
+ */
+
+#include "terminal/terminal-search-all.h"
+
+/* tabs searched, and the lines in the scrollback of each */
+#define N_TABS 40
+#define N_LINES 10000
+
+/* the time the search of all tabs may take, in microseconds */
+#define CHECK_BUDGET G_USEC_PER_SEC
+
+/* interval of the timeout measuring the main loop, in milliseconds */
+#define TICK_INTERVAL 1
+
+/* exit status meson reports as a skipped test */
+#define EXIT_SKIP 77
+
+
+
+typedef struct _BenchData BenchData;
+
+struct _BenchData
+{
+  GPtrArray *matches;
+  gint64 last_tick;
+  gint64 longest_stall;
+};
+
+
+
+/* the screens are plain terminals here, their search is kept on them */
+TerminalSearch *
+terminal_screen_get_search (TerminalScreen *screen)
+{
+  return g_object_get_data (G_OBJECT (screen), "bench-search");
+}
+
+
+
+/* lines of build output, with a warning every hundred lines */
+static VteTerminal *
+bench_terminal_new (guint tab)
+{
+  VteTerminal *terminal;
+  GString *output = g_string_new (NULL);
+  guint line;
+
+  terminal = VTE_TERMINAL (vte_terminal_new ());
+  vte_terminal_set_size (terminal, 120, 40);
+  vte_terminal_set_scrollback_lines (terminal, N_LINES);
+
+  for (line = 0; line < N_LINES; line++)
+    {
+      if (line % 100 == 0)
+        g_string_append_printf (output, "terminal-%02u.c:%u: warning: unused variable 'n'\r\n", tab, line);
+      else
+        g_string_append_printf (output, "  CC       terminal/terminal-%05u.o  [%3u%%]\r\n", line, line % 101);
+    }
+
+  vte_terminal_feed (terminal, output->str, output->len);
+  g_string_free (output, TRUE);
+
+  g_object_set_data_full (G_OBJECT (terminal), "bench-search",
+                          terminal_search_new (terminal), g_object_unref);
+
+  return terminal;
+}
+
+
+
+/* vte handles fed output from the main loop */
+static void
+bench_wait_for_output (GList *terminals)
+{
+  GtkAdjustment *adjustment;
+  GList *lp;
+
+  for (lp = terminals; lp != NULL; lp = lp->next)
+    {
+      adjustment = gtk_scrollable_get_vadjustment (lp->data);
+      while (gtk_adjustment_get_upper (adjustment) < N_LINES)
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+}
+
+
+
+static gboolean
+bench_tick (gpointer user_data)
+{
+  BenchData *data = user_data;
+  gint64 now = g_get_monotonic_time ();
+
+  data->longest_stall = MAX (data->longest_stall, now - data->last_tick);
+  data->last_tick = now;
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static void
+bench_ready (GObject *object,
+             GAsyncResult *result,
+             gpointer user_data)
+{
+  BenchData *data = user_data;
+  GError *error = NULL;
+
+  data->matches = terminal_search_all_finish (result, &error);
+  if (data->matches == NULL)
+    g_error ("Failed to search the tabs: %s", error->message);
+}
+
+
+
+int
+main (int argc,
+      char **argv)
+{
+  BenchData data = { NULL, 0, 0 };
+  GtkWidget *window;
+  GtkWidget *box;
+  GList *terminals = NULL;
+  VteTerminal *terminal;
+  gboolean check;
+  gint64 start;
+  gint64 elapsed;
+  guint tick_id;
+  guint tab;
+
+  check = argc > 1 && g_strcmp0 (argv[1], "--check") == 0;
+
+  if (!gtk_init_check (&argc, &argv))
+    {
+      g_print ("no display, skipped\n");
+      return EXIT_SKIP;
+    }
+
+  window = gtk_offscreen_window_new ();
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), box);
+
+  for (tab = 0; tab < N_TABS; tab++)
+    {
+      terminal = bench_terminal_new (tab);
+      gtk_box_pack_start (GTK_BOX (box), GTK_WIDGET (terminal), FALSE, FALSE, 0);
+      terminals = g_list_append (terminals, terminal);
+    }
+
+  gtk_widget_show_all (window);
+  bench_wait_for_output (terminals);
+
+  g_print ("%u tabs of %u lines\n", N_TABS, N_LINES);
+
+  start = data.last_tick = g_get_monotonic_time ();
+  tick_id = g_timeout_add (TICK_INTERVAL, bench_tick, &data);
+
+  terminal_search_all (terminals, "warning: unused", 0, NULL, bench_ready, &data);
+  while (data.matches == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  elapsed = g_get_monotonic_time () - start;
+  g_source_remove (tick_id);
+
+  g_print ("%-16s %9.1f ms\n", "search", elapsed / 1000.0);
+  g_print ("%-16s %9.1f ms\n", "longest stall", data.longest_stall / 1000.0);
+  g_print ("%-16s %9u\n", "matches", data.matches->len);
+
+  g_ptr_array_unref (data.matches);
+  g_list_free (terminals);
+  gtk_widget_destroy (window);
+
+  if (check && elapsed >= CHECK_BUDGET)
+    {
+      g_printerr ("searching %u tabs took %.1f ms, more than %.1f ms\n",
+                  N_TABS, elapsed / 1000.0, CHECK_BUDGET / 1000.0);
+      return 1;
+    }
+
+  return 0;
+}